@@ -0,0 +1,273 @@
+#include "anneal.h"
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "edgecache.h"
+#include "prefilter.h"
+#include "rand.h"
+#include "results.h"
+#include "telemetry.h"
+
+//best over all chains, and when it was found
+typedef struct AnnealBest {
+    pthread_mutex_t lock;
+    struct timespec startTime;
+    uint score;
+    uint uniqueSides;
+    uint uniqueIndexes;
+    char connections[40];
+} AnnealBest;
+
+typedef struct AnnealChain {
+    const AnnealConfig* config;
+    AnnealBest* best;
+    uint index;
+    unsigned int seed;
+
+    Puzzle puzzle;
+    uint score;
+    //EdgeSolutions of puzzle's edge ring, only filled in once a center move needs them
+    EdgeSet edgeSet;
+    bool edgeSetValid;
+
+    uint64_t numAccepted;
+    uint64_t numCenterEvaluations;
+    uint64_t numFullEvaluations;
+    uint bestScore;
+    double seconds;
+    PrefilterStats prefilter;
+} AnnealChain;
+
+static double secondsSince( const struct timespec* const start ) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( now.tv_sec - start->tv_sec ) + ( now.tv_nsec - start->tv_nsec ) / 1e9;
+}
+
+static float temperatureAt( const AnnealConfig* const config, const uint move ) {
+    const float progress = config->numMoves > 1 ? move * 1.0f / ( config->numMoves - 1 ) : 1.0f;
+    if ( config->cooling == ANNEAL_LINEAR ) {
+        return config->startTemperature +
+               ( config->endTemperature - config->startTemperature ) * progress;
+    }
+    return config->startTemperature *
+           powf( config->endTemperature / config->startTemperature, progress );
+}
+
+/*
+ * Score puzzle the same way the GA does. If the edge ring is the same as the
+ * chain's current Puzzle, only the center stage is run against the chain's
+ * EdgeSet.
+*/
+static uint chain_evaluate( AnnealChain* const chain, const Puzzle* const puzzle,
+                            const bool ringChanged, const uint move,
+                            uint* const uniqueSides, uint* const uniqueIndexes ) {
+    const uint maxOtherSolutions = 100;
+    PuzzleSolution solutions[maxOtherSolutions];
+    uint numOtherSolutions = 0;
+    *uniqueSides = 0;
+    *uniqueIndexes = 0;
+    telemetry_add( TELEMETRY_EVALUATIONS, 1 );
+    if ( !prefilter_mayHaveOtherSolution( puzzle, &chain->prefilter ) ) {
+        telemetry_add( TELEMETRY_PREFILTER_REJECTED, 1 );
+        telemetry_countSolve( 0, false );
+        return 0;
+    }
+    const AnnealConfig* const config = chain->config;
+    if ( ringChanged ) {
+        //the chain's own EdgeSolutions are of no use, the shared cache can still have them
+        telemetry_add( TELEMETRY_CACHE_MISSES, 1 );
+        bool reused = false;
+        if ( config->edgeCache ) {
+            reused = edgeRingCache_findValidSolutions( config->edgeCache, puzzle, solutions,
+                                                       &numOtherSolutions, maxOtherSolutions,
+                                                       uniqueIndexes, uniqueSides );
+            telemetry_add( reused ? TELEMETRY_EDGE_CACHE_HITS : TELEMETRY_EDGE_CACHE_MISSES, 1 );
+        } else {
+            puzzle_findValidSolutions( puzzle, solutions, &numOtherSolutions,
+                                       maxOtherSolutions, uniqueIndexes, uniqueSides );
+        }
+        if ( reused ) {
+            ++chain->numCenterEvaluations;
+        } else {
+            ++chain->numFullEvaluations;
+        }
+    } else {
+        telemetry_add( TELEMETRY_CACHE_HITS, 1 );
+        if ( !chain->edgeSetValid ) {
+            puzzle_findValidEdges( puzzle, &chain->edgeSet );
+            chain->edgeSetValid = true;
+        }
+        puzzle_findValidSolutions2( puzzle, &chain->edgeSet, solutions, &numOtherSolutions,
+                                    maxOtherSolutions, uniqueIndexes, uniqueSides );
+        ++chain->numCenterEvaluations;
+    }
+    telemetry_countSolve( numOtherSolutions, false );
+    if ( numOtherSolutions != 1 ) {
+        return 0;
+    }
+    telemetry_offerBest( *uniqueSides + *uniqueIndexes );
+    if ( config->resultLog || config->hallOfFame ) {
+        const ResultRecord record = result_create( puzzle, &solutions[0], *uniqueSides,
+                                                   *uniqueIndexes, RESULT_ANNEAL, chain->index,
+                                                   move );
+        if ( config->resultLog ) {
+            resultLog_append( config->resultLog, &record );
+        }
+        if ( config->hallOfFame ) {
+            hallOfFame_offer( config->hallOfFame, &record );
+        }
+    }
+    return *uniqueSides + *uniqueIndexes;
+}
+
+static void chain_reportBest( AnnealChain* const chain, const uint uniqueSides,
+                              const uint uniqueIndexes ) {
+    AnnealBest* const best = chain->best;
+    pthread_mutex_lock( &best->lock );
+    if ( chain->score > best->score ) {
+        best->score = chain->score;
+        best->uniqueSides = uniqueSides;
+        best->uniqueIndexes = uniqueIndexes;
+        memcpy( best->connections, chain->puzzle.connections, sizeof( best->connections ) );
+        printf( "%.3fs chain %u: best %u (%u sides + %u indexes)\n",
+                secondsSince( &best->startTime ), chain->index, chain->score, uniqueSides,
+                uniqueIndexes );
+    }
+    pthread_mutex_unlock( &best->lock );
+}
+
+static void* chain_run( void* arg ) {
+    AnnealChain* const chain = arg;
+    const AnnealConfig* const config = chain->config;
+    struct timespec startTime;
+    clock_gettime( CLOCK_MONOTONIC, &startTime );
+
+    uint uniqueSides;
+    uint uniqueIndexes;
+    chain->score = chain_evaluate( chain, &chain->puzzle, true, 0, &uniqueSides,
+                                   &uniqueIndexes );
+    chain->bestScore = chain->score;
+    chain_reportBest( chain, uniqueSides, uniqueIndexes );
+
+    Puzzle candidate;
+    for ( uint move = 0; move < config->numMoves; ++move ) {
+        uint first = 0;
+        uint second = 0;
+        while ( chain->puzzle.connections[first] == chain->puzzle.connections[second] ) {
+            first = rand_indexR( &chain->seed, 40 );
+            second = rand_indexR( &chain->seed, 40 );
+        }
+        candidate = chain->puzzle;
+        candidate.dirtyConnections = 0;
+        puzzle_swapConnections( &candidate, first, second );
+
+        const bool ringChanged = candidate.dirtyConnections & PUZZLE_EDGE_RING_CONNECTIONS;
+        const uint score = chain_evaluate( chain, &candidate, ringChanged, move, &uniqueSides,
+                                           &uniqueIndexes );
+        if ( score < chain->score &&
+             rand_floatR( &chain->seed ) >= expf( ( ( float ) score - chain->score ) /
+                                                  temperatureAt( config, move ) ) ) {
+            continue;
+        }
+
+        chain->puzzle = candidate;
+        chain->score = score;
+        ++chain->numAccepted;
+        if ( ringChanged ) {
+            chain->edgeSetValid = false;
+        }
+        if ( score > chain->bestScore ) {
+            chain->bestScore = score;
+            chain_reportBest( chain, uniqueSides, uniqueIndexes );
+        }
+    }
+
+    chain->seconds = secondsSince( &startTime );
+    return NULL;
+}
+
+void anneal_run( const AnnealConfig* const config ) {
+    //with a single connector value no swap changes the Puzzle, and the move picker
+    //never finds two different connections
+    if ( config->numChains == 0 || config->numUniqueConnectors < 2 ||
+         config->startTemperature <= 0 || config->endTemperature <= 0 ) {
+        fprintf( stderr, "Invalid anneal settings: %u chains, %u connectors, "
+                 "temperature %f to %f\n", config->numChains, config->numUniqueConnectors,
+                 config->startTemperature, config->endTemperature );
+        exit( 1 );
+    }
+
+    AnnealBest best = { .score = 0 };
+    pthread_mutex_init( &best.lock, NULL );
+    AnnealChain* chains = calloc( config->numChains, sizeof( AnnealChain ) );
+    if ( !chains ) {
+        fprintf( stderr, "Could not allocate anneal chains\n" );
+        exit( 1 );
+    }
+    //starting Puzzles come from rand(), so they are made before any thread starts
+    srand( config->seed );
+    for ( uint i = 0; i < config->numChains; ++i ) {
+        AnnealChain* const chain = &chains[i];
+        chain->config = config;
+        chain->best = &best;
+        chain->index = i;
+        chain->seed = config->seed * 2654435761u + i + 1;
+        chain->puzzle.numUniqueConnectors = config->numUniqueConnectors;
+        config->generate( &chain->puzzle );
+        edgeSet_init( &chain->edgeSet, 1024 );
+    }
+
+    printf( "--------Annealing %u chains, %u moves each, temperature %.2f to %.2f (%s)--------\n",
+            config->numChains, config->numMoves, config->startTemperature,
+            config->endTemperature, config->cooling == ANNEAL_LINEAR ? "linear" : "geometric" );
+    const clock_t startClock = clock();
+    clock_gettime( CLOCK_MONOTONIC, &best.startTime );
+    pthread_t threads[config->numChains];
+    for ( uint i = 0; i < config->numChains; ++i ) {
+        pthread_create( &threads[i], NULL, chain_run, &chains[i] );
+    }
+    for ( uint i = 0; i < config->numChains; ++i ) {
+        pthread_join( threads[i], NULL );
+    }
+    const double cpuSeconds = ( clock() - startClock ) * 1.0 / CLOCKS_PER_SEC;
+
+    uint64_t numAccepted = 0;
+    PrefilterStats prefilter = { 0 };
+    for ( uint i = 0; i < config->numChains; ++i ) {
+        const AnnealChain* const chain = &chains[i];
+        printf( "Chain %u: best %u, final %u, %" PRIu64 " accepted (%.1f/s), "
+                "%" PRIu64 " center only / %" PRIu64 " full evaluations\n",
+                i, chain->bestScore, chain->score, chain->numAccepted,
+                chain->numAccepted / chain->seconds, chain->numCenterEvaluations,
+                chain->numFullEvaluations );
+        numAccepted += chain->numAccepted;
+        prefilter.numChecked += chain->prefilter.numChecked;
+        prefilter.numRejected += chain->prefilter.numRejected;
+    }
+    prefilter_printStats( &prefilter );
+    if ( config->edgeCache ) {
+        edgeRingCache_printStats( config->edgeCache );
+    }
+    printf( "Best %u (%u sides + %u indexes), %.2f CPU seconds, %.1f accepted moves per CPU second\n",
+            best.score, best.uniqueSides, best.uniqueIndexes, cpuSeconds,
+            numAccepted / cpuSeconds );
+    for ( uint j = 0; j < 40; ++j ) {
+        if ( j ) {
+            printf( ", " );
+        }
+        printf( "%i", best.connections[j] );
+    }
+    printf( "\n" );
+
+    for ( uint i = 0; i < config->numChains; ++i ) {
+        edgeSet_free( &chains[i].edgeSet );
+    }
+    free( chains );
+    pthread_mutex_destroy( &best.lock );
+}
@@ -0,0 +1,48 @@
+#ifndef ANNEAL_H
+#define ANNEAL_H
+
+#include <stdlib.h>
+#include "puzzle.h"
+
+typedef enum AnnealCooling {
+    ANNEAL_GEOMETRIC, //temperature is multiplied by the same factor every move
+    ANNEAL_LINEAR
+} AnnealCooling;
+
+/*
+ * Settings for anneal_run. Every chain makes numMoves moves, going from
+ * startTemperature down to endTemperature.
+ *
+ * Scores are the same sum the GA uses (unique sides + unique indexes, 0 unless
+ * there is exactly one other solution), so a temperature of 1 takes a move that
+ * loses 1 about a third of the time.
+*/
+typedef struct AnnealConfig {
+    uint numUniqueConnectors;
+    uint numChains;
+    uint numMoves;
+    float startTemperature;
+    float endTemperature;
+    AnnealCooling cooling;
+    unsigned int seed;
+    PuzzleGenerator generate; //where each chain's starting Puzzle comes from
+    ResultLog* resultLog; //every scoring Puzzle evaluated goes here, can be NULL
+    HallOfFame* hallOfFame; //and is offered here, can be NULL
+    EdgeRingCache* edgeCache; //shared by every chain, can be NULL
+} AnnealConfig;
+
+/*
+ * Run numChains independent simulated annealing chains, one thread each
+ *
+ * A move swaps two connections with different values. Moves that only touch
+ * connections off the edge ring keep the chain's EdgeSolutions and only re-solve
+ * the centers, moves on the edge ring re-solve the whole Puzzle unless edgeCache
+ * already has the new ring's EdgeSolutions.
+ *
+ * Prints the best score (with the time it was found) whenever any chain beats
+ * it, and at the end the moves, accepted moves per second and evaluations of
+ * each kind for every chain.
+*/
+void anneal_run( const AnnealConfig* const config );
+
+#endif
@@ -0,0 +1,43 @@
+#include "arena.h"
+#include "error.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+Arena* arena_create( size_t size ) {
+    Arena* arena = malloc( sizeof( Arena ) );
+    if ( !arena ) {
+        error_raise( ERROR_OUT_OF_MEMORY, "Couldn't create Arena" );
+    }
+    arena->size = size;
+    arena->used = 0;
+    arena->contents = aligned_alloc( ARENA_ALIGNMENT,
+                                     ( size + ARENA_ALIGNMENT - 1 ) / ARENA_ALIGNMENT * ARENA_ALIGNMENT );
+    if ( !arena->contents ) {
+        free( arena );
+        error_raise( ERROR_OUT_OF_MEMORY, "Could not create Arena of %lu bytes", size );
+    }
+
+    return arena;
+}
+
+void* arena_alloc( Arena* arena, size_t size ) {
+    const size_t start = ( arena->used + ARENA_ALIGNMENT - 1 ) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    if ( start + size > arena->size ) {
+        error_raise( ERROR_OUT_OF_MEMORY, "Arena out of space: %lu of %lu bytes used, %lu requested",
+                     arena->used, arena->size, size );
+    }
+    arena->used = start + size;
+    return &arena->contents[start];
+}
+
+void arena_reset( Arena* arena ) {
+    arena->used = 0;
+}
+
+void arena_free( Arena* arena ) {
+    if ( !arena ) {
+        return;
+    }
+    free( arena->contents );
+    free( arena );
+}
@@ -0,0 +1,46 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+//every allocation is padded up to this, so size Arenas with up to
+//ARENA_ALIGNMENT - 1 extra bytes per allocation
+#define ARENA_ALIGNMENT _Alignof( max_align_t )
+
+/*
+ * Bump allocator over a single block of memory
+ *
+ * Allocations are carved off the front of the block and are never freed one at
+ * a time, the whole Arena is reset at once instead. Used for memory whose
+ * lifetime is tied to something with clear boundaries, like a GA generation.
+*/
+typedef struct Arena {
+    char* contents;
+    size_t size;
+    size_t used;
+} Arena;
+
+/*
+ * Create an Arena that can hand out size bytes in total (before alignment)
+ */
+Arena* arena_create( size_t size );
+
+/*
+ * Get size bytes from the Arena, aligned for any type
+ *
+ * The Arena does not grow, running out of space is a bug in the caller's sizing
+ */
+void* arena_alloc( Arena* arena, size_t size );
+
+/*
+ * Release every allocation made from the Arena, keeping the block
+ */
+void arena_reset( Arena* arena );
+
+/*
+ * Free the Arena and its block
+ */
+void arena_free( Arena* arena );
+
+#endif
@@ -0,0 +1,88 @@
+#include "bandit.h"
+#include <stdio.h>
+#include "rand.h"
+
+static const char* operatorNames[MUTATION_NUM_OPERATORS] = { [MUTATION_ALL] = "all",
+                                                             [MUTATION_CENTER] = "center" };
+
+void mutationBandit_init( MutationBandit* const bandit, const uint minMutations,
+                          const uint maxMutations ) {
+    const uint numCounts = maxMutations - minMutations + 1;
+    if ( minMutations == 0 || maxMutations < minMutations ||
+         numCounts * MUTATION_NUM_OPERATORS > MUTATION_BANDIT_MAX_ARMS ) {
+        fprintf( stderr, "Can't schedule mutations of %u to %u swaps\n", minMutations,
+                 maxMutations );
+        exit( 1 );
+    }
+    *bandit = ( MutationBandit ) { .numArms = numCounts * MUTATION_NUM_OPERATORS };
+    for ( uint i = 0; i < bandit->numArms; ++i ) {
+        bandit->arms[i] = ( MutationArm ) { .operator = i / numCounts,
+                                            .numMutations = minMutations + i % numCounts,
+                                            .share = 1.0 / bandit->numArms };
+    }
+}
+
+uint mutationBandit_choose( const MutationBandit* const bandit ) {
+    const double pick = rand_float();
+    double total = 0;
+    for ( uint i = 0; i < bandit->numArms; ++i ) {
+        total += bandit->arms[i].share;
+        if ( pick < total ) {
+            return i;
+        }
+    }
+    //shares can add up to a hair under 1
+    return bandit->numArms - 1;
+}
+
+void mutationBandit_mutate( const MutationBandit* const bandit, const uint arm,
+                            CompactPuzzle* const dest, const CompactPuzzle* const src ) {
+    const MutationArm* const chosen = &bandit->arms[arm];
+    if ( chosen->operator == MUTATION_CENTER ) {
+        compactPuzzle_mutateCenter( dest, src, chosen->numMutations, chosen->numMutations );
+    } else {
+        compactPuzzle_mutate( dest, src, chosen->numMutations, chosen->numMutations );
+    }
+}
+
+void mutationBandit_credit( MutationBandit* const bandit, const uint arm,
+                            const uint improvement, const double seconds ) {
+    MutationArm* const credited = &bandit->arms[arm];
+    credited->generationReward += improvement;
+    credited->generationSeconds += seconds;
+    ++credited->numChildren;
+    credited->numImproved += improvement > 0;
+    credited->totalSeconds += seconds;
+}
+
+void mutationBandit_endGeneration( MutationBandit* const bandit ) {
+    double totalRate = 0;
+    double rates[MUTATION_BANDIT_MAX_ARMS];
+    for ( uint i = 0; i < bandit->numArms; ++i ) {
+        MutationArm* const arm = &bandit->arms[i];
+        arm->reward = arm->reward * MUTATION_BANDIT_DECAY + arm->generationReward;
+        arm->seconds = arm->seconds * MUTATION_BANDIT_DECAY + arm->generationSeconds;
+        arm->generationReward = 0;
+        arm->generationSeconds = 0;
+        rates[i] = arm->seconds > 0 ? arm->reward / arm->seconds : 0;
+        totalRate += rates[i];
+    }
+    ++bandit->numGenerations;
+    //until something has improved, keep trying everything evenly
+    for ( uint i = 0; i < bandit->numArms; ++i ) {
+        bandit->arms[i].share = MUTATION_BANDIT_EXPLORE / bandit->numArms +
+                                ( 1 - MUTATION_BANDIT_EXPLORE ) *
+                                ( totalRate > 0 ? rates[i] / totalRate : 1.0 / bandit->numArms );
+    }
+}
+
+void mutationBandit_print( const MutationBandit* const bandit ) {
+    printf( "Mutation arms after %" PRIu64 " generations:\n", bandit->numGenerations );
+    for ( uint i = 0; i < bandit->numArms; ++i ) {
+        const MutationArm* const arm = &bandit->arms[i];
+        printf( "  %-6s x%u: share %5.1f%%, %" PRIu64 " children, %" PRIu64 " improved, "
+                "%.2f CPU seconds, %.1f reward per CPU second\n", operatorNames[arm->operator],
+                arm->numMutations, arm->share * 100, arm->numChildren, arm->numImproved,
+                arm->totalSeconds, arm->seconds > 0 ? arm->reward / arm->seconds : 0.0 );
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef BANDIT_H
+#define BANDIT_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "puzzle.h"
+
+/*
+ * Adaptive choice of how the GA mutates its children
+ *
+ * An arm is one mutation operator with one number of swaps in
+ * [minMutations, maxMutations]. Each child remembers the arm that made it. When
+ * the child is scored, that arm is credited with how far the child beat its
+ * parent's score (0 if it didn't) and the CPU time its solve took.
+ *
+ * At the end of a generation each arm's reward and seconds are decayed into
+ * running totals, so an arm that stopped helping loses its share within a few
+ * generations. The next children are split between arms in proportion to reward
+ * per CPU second (probability matching). Every arm keeps at least
+ * MUTATION_BANDIT_EXPLORE of the children between them, so an arm that starts
+ * helping again gets noticed.
+*/
+#define MUTATION_BANDIT_MAX_ARMS 32
+#define MUTATION_BANDIT_NO_ARM UINT32_MAX
+//how much of last generation's running totals carry over into the next
+#define MUTATION_BANDIT_DECAY 0.7
+//share of children spread evenly over every arm
+#define MUTATION_BANDIT_EXPLORE 0.2
+
+typedef enum MutationOperator {
+    MUTATION_ALL, //compactPuzzle_mutate
+    MUTATION_CENTER, //compactPuzzle_mutateCenter
+    MUTATION_NUM_OPERATORS
+} MutationOperator;
+
+typedef struct MutationArm {
+    MutationOperator operator;
+    uint numMutations;
+    double share; //of the next generation's children
+    double generationReward; //credited since the last mutationBandit_endGeneration
+    double generationSeconds;
+    double reward; //decayed over generations
+    double seconds;
+    uint64_t numChildren;
+    uint64_t numImproved;
+    double totalSeconds;
+} MutationArm;
+
+typedef struct MutationBandit {
+    MutationArm arms[MUTATION_BANDIT_MAX_ARMS];
+    uint numArms;
+    uint64_t numGenerations;
+} MutationBandit;
+
+/*
+ * An arm for both operators and every number of swaps in
+ * [minMutations, maxMutations], all with the same share to start with
+*/
+void mutationBandit_init( MutationBandit* const bandit, const uint minMutations,
+                          const uint maxMutations );
+
+//pick the arm for the next child by share, one rand_float
+uint mutationBandit_choose( const MutationBandit* const bandit );
+
+void mutationBandit_mutate( const MutationBandit* const bandit, const uint arm,
+                            CompactPuzzle* const dest, const CompactPuzzle* const src );
+
+//a child of arm was scored, improvement is how far it beat its parent (0 if not)
+void mutationBandit_credit( MutationBandit* const bandit, const uint arm,
+                            const uint improvement, const double seconds );
+
+//decay and work out the shares for the next generation's children
+void mutationBandit_endGeneration( MutationBandit* const bandit );
+
+void mutationBandit_print( const MutationBandit* const bandit );
+
+#endif
@@ -1,192 +1,291 @@
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 #include "benchmark.h"
+#include "engine.h"
+#include "prefilter.h"
 #include "puzzle.h"
-#include "rand.h"
-
-const uint numEdgeConnections = 16;
-const uint numTotalConnections = 40;
-const uint numCenterConnections = numTotalConnections - numEdgeConnections;
-
-
-static void generateCenter( const uint numUniqueConnections, const uint numUniqueEdgeConnections,
-                            const uint centerConnections[numCenterConnections],
-                            uint centerContains[numUniqueConnections][numCenterConnections], 
-                            uint centerContainsCounts[numUniqueConnections] ) {
-    static const int centerIndexes[24][2] = { { 6, -1 }, { 6, 7 }, { 7, 8 }, { 8, -1 },
-                                              { 11, -1 }, { 11, 12 }, { 12, 13 }, { 13, -1 },
-                                              { 16, -1 }, { 16, 17 }, { 17, 18 }, { 18, -1 },
-                                              { 6, -1 }, { 6, 11 }, { 11, 16 }, { 16, -1 },
-                                              { 7, -1 }, { 7, 12 }, { 12, 17 }, { 17, -1 },
-                                              { 8, -1 }, { 8, 13 }, { 13, 18 }, { 18, -1 } };
-
-    memset( centerContainsCounts, 0, sizeof( uint ) * numUniqueConnections );
-
-    for ( uint i = 0; i < numCenterConnections; ++i ) {
-        const uint connection = centerConnections[i];
-        for ( uint j = 0; j < 2; ++j ) {
-            const int index = centerIndexes[i][j];
-            if ( index == -1 ) {
-                break;
-            }
-            centerContains[connection][centerContainsCounts[connection]] = centerIndexes[i][j];
-            ++centerContainsCounts[connection];
-        }
-    }
-}
-
-static void generateEdge( const uint numUniqueConnections, const uint numUniqueEdgeConnections,
-                          const uint edgeConnections[numEdgeConnections],
-                          uint leftEdges[numUniqueEdgeConnections][numEdgeConnections],
-                          uint leftEdgesCounts[numUniqueEdgeConnections],
-                          uint rightEdges[numUniqueEdgeConnections][numEdgeConnections],
-                          uint rightEdgesCounts[numUniqueEdgeConnections] ) {
-    static const uint leftEdgeIndexes[16] = { 1, 2, 3, 4, 9, 14, 19, 24, 23, 22, 21, 20, 15, 10, 5, 0 };
-    static const uint rightEdgeIndexes[16] = { 0, 1, 2, 3, 4, 9, 14, 19, 24, 23, 22, 21, 20, 15, 10, 5 };
-    
-    memset( leftEdgesCounts, 0, sizeof( uint ) * numUniqueEdgeConnections );
-    memset( rightEdgesCounts, 0, sizeof( uint ) * numUniqueEdgeConnections );
-
-    for ( uint i = 0; i < numEdgeConnections; ++i ) {
-        const uint connection = edgeConnections[i];
-        leftEdges[connection][leftEdgesCounts[connection]] = leftEdgeIndexes[i];
-        ++leftEdgesCounts[connection];
-
-        rightEdges[connection][rightEdgesCounts[connection]] = rightEdgeIndexes[i];
-        ++rightEdgesCounts[connection];
-    }
-}
+#include "results.h"
+
+//how often puzzle_findValidSolutions ends on each number of other solutions
+typedef struct HitCounts {
+    uint numNone;
+    uint numOne;
+    uint numMore;
+    clock_t clocks;
+    PrefilterStats prefilter;
+} HitCounts;
+
+static HitCounts countHits( const PuzzleGenerator generate, const uint numPuzzles,
+                            const uint numUniqueConnectors ) {
+    srand( 0 );
+    Puzzle puzzle;
+    puzzle.numUniqueConnectors = numUniqueConnectors;
+    PuzzleSolution otherSolutions[100];
+    const uint maxOtherSolutions = 100;
+    uint maxUniqueIndexes;
+    uint maxUniqueSides;
+    HitCounts counts = { 0 };
 
-void generateSwappablePuzzle( const uint numUniqueConnections ) {
-    const uint maxTotal = numTotalConnections - ( numUniqueConnections * 2 ) + 2;
-    const uint maxUniqueConnectionsInEdge = numUniqueConnections > ( numEdgeConnections / 2 ) ? numEdgeConnections / 2 : numUniqueConnections;
-    const uint minUniqueConnectionsInEdge = numUniqueConnections <= ( numCenterConnections / 2 ) ? 
-                                            1 : numUniqueConnections - ( numCenterConnections / 2 );
-
-    const uint numUniqueEdgeConnections = rand_intBetween( minUniqueConnectionsInEdge,
-                                                           maxUniqueConnectionsInEdge + 1 );
-    uint edgeConnections[numEdgeConnections];
-    uint count = 0;
-
-    for ( uint i = 0; i < numUniqueEdgeConnections; ++i ) {
-        for ( uint j  = 0; j < 2; ++j ) {
-            edgeConnections[count] = i;
-            ++count;
+    const clock_t startTime = clock();
+    for ( uint i = 0; i < numPuzzles; ++i ) {
+        generate( &puzzle );
+        uint numOtherSolutions = 0;
+        if ( prefilter_mayHaveOtherSolution( &puzzle, &counts.prefilter ) ) {
+            puzzle_findValidSolutions( &puzzle, otherSolutions, &numOtherSolutions,
+                                       maxOtherSolutions, &maxUniqueIndexes, &maxUniqueSides );
         }
-    }
-
-    for ( uint i = count; i < numEdgeConnections; ++i ) {
-        edgeConnections[i] = rand_index( numUniqueEdgeConnections );
-    }
-
-    rand_shuffle( edgeConnections, numEdgeConnections, sizeof( uint ) );
-
-    uint centerConnections[numCenterConnections];
-    count = 0;
-    for ( uint i = numUniqueEdgeConnections; i < numUniqueConnections; ++i ) {
-        for ( uint j = 0; j < 2; ++j ) {
-            centerConnections[count] = i;
-            ++count;
+        if ( numOtherSolutions == 0 ) {
+            ++counts.numNone;
+        } else if ( numOtherSolutions == 1 ) {
+            ++counts.numOne;
+        } else {
+            ++counts.numMore;
         }
     }
+    counts.clocks = clock() - startTime;
 
-    for ( uint i = count; i < numCenterConnections; ++i ) {
-        centerConnections[i] = rand_index( numUniqueConnections );
-    }
-
-    rand_shuffle( centerConnections, numCenterConnections, sizeof( uint ) );
-
-    uint leftEdges[numUniqueEdgeConnections][numEdgeConnections];
-    uint leftEdgesCounts[numUniqueEdgeConnections];
-
-    uint rightEdges[numUniqueEdgeConnections][numEdgeConnections];
-    uint rightEdgesCounts[numUniqueEdgeConnections];
+    return counts;
+}
 
-    generateEdge( numUniqueConnections, numUniqueEdgeConnections, edgeConnections,
-                  leftEdges, leftEdgesCounts, rightEdges, rightEdgesCounts );
+static void printHits( const char* const name, const HitCounts* const counts,
+                       const uint numPuzzles ) {
+    const int milliSeconds = counts->clocks * 1000 / CLOCKS_PER_SEC;
+    printf( "%s: %u none (%.1f%%), %u exactly one (%.1f%%), %u more, %d.%03d seconds\n",
+            name, counts->numNone, counts->numNone * 100.0 / numPuzzles,
+            counts->numOne, counts->numOne * 100.0 / numPuzzles, counts->numMore,
+            milliSeconds / 1000, milliSeconds % 1000 );
+    prefilter_printStats( &counts->prefilter );
+}
 
-    uint centerContains[numUniqueConnections][numCenterConnections];
-    uint centerContainsCounts[numUniqueConnections];
+void benchmark_generatorHitRate( const uint numPuzzles, const uint numUniqueConnectors ) {
+    const HitCounts shuffled = countHits( puzzle_shuffle, numPuzzles, numUniqueConnectors );
+    const HitCounts swappable = countHits( puzzle_generateSwappable, numPuzzles,
+                                           numUniqueConnectors );
 
-    generateCenter( numUniqueConnections, numUniqueEdgeConnections,
-                    centerConnections, centerContains, centerContainsCounts );
+    printf( "--------Generator hit rate, %u puzzles, %u unique connectors--------\n",
+            numPuzzles, numUniqueConnectors );
+    printHits( "puzzle_shuffle", &shuffled, numPuzzles );
+    printHits( "puzzle_generateSwappable", &swappable, numPuzzles );
+}
 
+typedef void ( *UniqueEdgeGenerator )( Puzzle* const puzzle, EdgeSet* const edgeSet );
 
-    uint validEdges[1320][3];
-    uint numValidEdges = 0;
+static void timeUniqueEdge( const char* const name, const UniqueEdgeGenerator generate,
+                            const uint numRings, const uint numUniqueConnectors ) {
+    srand( 0 );
+    Puzzle puzzle;
+    puzzle.numUniqueConnectors = numUniqueConnectors;
+    EdgeSet edgeSet;
+    edgeSet_init( &edgeSet, 10000 );
+
+    const clock_t startTime = clock();
+    for ( uint i = 0; i < numRings; ++i ) {
+        generate( &puzzle, &edgeSet );
+    }
+    const int milliSeconds = ( clock() - startTime ) * 1000 / CLOCKS_PER_SEC;
+    printf( "%s: %d.%03d seconds, %.3f ms/ring\n", name, milliSeconds / 1000,
+            milliSeconds % 1000, ( double ) milliSeconds / numRings );
+    edgeSet_free( &edgeSet );
+}
 
-    static const uint cornerIndexes[4] = { 0, 4, 20, 24 };
-    static const uint edgeIndexes[12] = { 1, 2, 3, 5, 10, 15, 9, 14, 19, 21, 22, 23 };
+void benchmark_uniqueEdge( const uint numRings, const uint numUniqueConnectors ) {
+    printf( "--------Unique edge rings, %u rings, %u unique connectors--------\n", numRings,
+            numUniqueConnectors );
+    timeUniqueEdge( "puzzle_shuffleUntilUniqueEdge", puzzle_shuffleUntilUniqueEdge, numRings,
+                    numUniqueConnectors );
+    timeUniqueEdge( "puzzle_generateUniqueEdge", puzzle_generateUniqueEdge, numRings,
+                    numUniqueConnectors );
+}
 
-    //Right/Left refer to Right/Left of edge pieces
-/*
-    for ( uint i = 0; i < 12; ++i ) { //left
+static double secondsSince( const struct timespec* const start ) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( now.tv_sec - start->tv_sec ) + ( now.tv_nsec - start->tv_nsec ) / 1e9;
+}
 
-        const Piece first = puzzle->pieces[edgeIndexes[i]];
-        const char firstLeft = piece_getSide( first, LEFT );
+void benchmark_parallelSolve( const uint numPuzzles, const uint numUniqueConnectors,
+                              const uint numWorkers ) {
+    srand( 0 );
+    Puzzle puzzle;
+    puzzle.numUniqueConnectors = numUniqueConnectors;
+    StealPool* pool = stealPool_create( numWorkers );
+    PuzzleSolution otherSolutions[100];
+    const uint maxOtherSolutions = 100;
+    double serialSeconds = 0;
+    double parallelSeconds = 0;
+    double pipelinedSeconds = 0;
+    uint numMismatches = 0;
+    uint numOne = 0;
 
-        if ( !charArrayContains( validLefts, 4, firstLeft ) ) {
-            continue;
+    for ( uint i = 0; i < numPuzzles; ++i ) {
+        puzzle_shuffle( &puzzle );
+        struct timespec startTime;
+
+        uint serialOther = 0;
+        uint serialIndexes;
+        uint serialSides;
+        clock_gettime( CLOCK_MONOTONIC, &startTime );
+        puzzle_findValidSolutions( &puzzle, otherSolutions, &serialOther, maxOtherSolutions,
+                                   &serialIndexes, &serialSides );
+        serialSeconds += secondsSince( &startTime );
+
+        uint parallelOther = 0;
+        uint parallelIndexes;
+        uint parallelSides;
+        clock_gettime( CLOCK_MONOTONIC, &startTime );
+        puzzle_findValidSolutionsParallel( &puzzle, pool, NULL, otherSolutions, &parallelOther,
+                                           maxOtherSolutions, &parallelIndexes,
+                                           &parallelSides );
+        parallelSeconds += secondsSince( &startTime );
+
+        uint pipelinedOther = 0;
+        uint pipelinedIndexes;
+        uint pipelinedSides;
+        clock_gettime( CLOCK_MONOTONIC, &startTime );
+        //the calling thread is the edge stage, the other workers run centers
+        puzzle_findValidSolutionsPipelined( &puzzle, numWorkers > 1 ? numWorkers - 1 : 1, NULL,
+                                            otherSolutions, &pipelinedOther, maxOtherSolutions,
+                                            &pipelinedIndexes, &pipelinedSides );
+        pipelinedSeconds += secondsSince( &startTime );
+
+        //past one other solution only the count matters, and which ones were found first
+        //is up to the timing
+        if ( serialOther != parallelOther ||
+             ( serialOther == 1 && ( serialIndexes != parallelIndexes ||
+                                     serialSides != parallelSides ) ) ) {
+            ++numMismatches;
         }
+        if ( serialOther != pipelinedOther ||
+             ( serialOther == 1 && ( serialIndexes != pipelinedIndexes ||
+                                     serialSides != pipelinedSides ) ) ) {
+            ++numMismatches;
+        }
+        numOne += serialOther == 1;
+    }
+    stealPool_free( pool );
+
+    printf( "--------Parallel solve, %u puzzles, %u unique connectors, %u workers--------\n",
+            numPuzzles, numUniqueConnectors, numWorkers );
+    printf( "puzzle_findValidSolutions: %.3f seconds, %.3f ms/puzzle\n", serialSeconds,
+            serialSeconds * 1000 / numPuzzles );
+    printf( "puzzle_findValidSolutionsParallel: %.3f seconds, %.3f ms/puzzle\n",
+            parallelSeconds, parallelSeconds * 1000 / numPuzzles );
+    printf( "puzzle_findValidSolutionsPipelined: %.3f seconds, %.3f ms/puzzle\n",
+            pipelinedSeconds, pipelinedSeconds * 1000 / numPuzzles );
+    printf( "%u with exactly one other solution, %u mismatches\n", numOne, numMismatches );
+}
 
-        const char firstRight = piece_getSide( first, RIGHT );
-
-        for ( uint j = 0; j < 12; ++j ) {
-            if ( j == i ) {
-                continue;
-            }
-            const Piece second = puzzle->pieces[edgeIndexes[j]];
-            const char secondLeft = piece_getSide( second, LEFT );
-
-            if ( !piece_piecesConnect( secondLeft, firstRight ) ) {
-                continue;
-            }
-
-            const char secondRight = piece_getSide( second, RIGHT );
-
-            for ( uint k = 0; k < 12; ++k ) {
-                if ( i == k || j == k ) {
-                    continue;
-                }
-                const Piece third = puzzle->pieces[edgeIndexes[k]];
-                const char thirdLeft = piece_getSide( third, LEFT );
-
-                if ( !piece_piecesConnect( secondRight, thirdLeft ) ){ 
-                    continue;
-                }
-
-                const char thirdRight = piece_getSide( third, RIGHT );
-
-                if ( !charArrayContains( validRights, 4, thirdRight ) ) {
-                    continue; 
-                }
+void benchmark_engine( const uint numPuzzles, const uint numUniqueConnectors,
+                       const char* const engineName, const char* const calibrationFile ) {
+    const bool automatic = strcmp( engineName, ENGINE_AUTO ) == 0;
+    const SolveEngine* const named = automatic ? NULL : engine_find( engineName );
+    if ( !automatic && !named ) {
+        fprintf( stderr, "No engine called %s, there is %s or one of:\n", engineName,
+                 ENGINE_AUTO );
+        engine_printAll();
+        exit( 1 );
+    }
+    EngineCalibration calibration;
+    const bool calibrated = automatic && calibrationFile &&
+                            engineCalibration_read( &calibration, calibrationFile );
+    if ( automatic && !calibrated ) {
+        fprintf( stderr, "No engine calibration, auto always picks %s\n", ENGINE_DEFAULT );
+    }
 
-                TripleIndex tempTripleIndex;
+    srand( 0 );
+    Puzzle puzzle;
+    const uint maxOtherSolutions = 100;
+    PuzzleSolution otherSolutions[maxOtherSolutions];
+    uint numPicked[ENGINE_COUNT] = { 0 };
+    uint numHits = 0;
+    struct timespec start;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for ( uint i = 0; i < numPuzzles; ++i ) {
+        puzzle_init( &puzzle, numUniqueConnectors );
+        puzzle_shuffle( &puzzle );
+        const SolveEngine* const engine = automatic ?
+                                          engine_choose( calibrated ? &calibration : NULL,
+                                                         &puzzle ) : named;
+        ++numPicked[engine - engine_at( 0 )];
+        uint numOtherSolutions = 0;
+        uint maxUniqueIndexes = 0;
+        uint maxUniqueSides = 0;
+        engine_solve( engine, &puzzle, otherSolutions, &numOtherSolutions, maxOtherSolutions,
+                      &maxUniqueIndexes, &maxUniqueSides );
+        numHits += numOtherSolutions == 1;
+    }
+    const double seconds = secondsSince( &start );
+
+    printf( "--------Engine %s, %u puzzles, %u unique connectors--------\n", engineName,
+            numPuzzles, numUniqueConnectors );
+    printf( "%.3f seconds, %.3f ms/puzzle, %u with exactly one other solution\n", seconds,
+            seconds * 1000 / numPuzzles, numHits );
+    for ( uint i = 0; i < ENGINE_COUNT && automatic; ++i ) {
+        if ( numPicked[i] ) {
+            printf( "%s: %u puzzles\n", engine_at( i )->name, numPicked[i] );
+        }
+    }
+}
 
-                tempTripleIndex.indexes[0] = first.index;
-                tempTripleIndex.indexes[1] = second.index;
-                tempTripleIndex.indexes[2] = third.index;
-                
-                da_addElement( validEdges, &tempTripleIndex );
+void benchmark_crossover( const uint numRuns, const double secondsPerRun,
+                          const double* const rates, const uint numRates ) {
+    printf( "--------Crossover, %u runs of %.1f seconds per rate--------\n", numRuns,
+            secondsPerRun );
+    for ( uint i = 0; i < numRates; ++i ) {
+        uint totalBest = 0;
+        uint maxBest = 0;
+        clock_t clocks = 0;
+        const GaConfig config = { .numUniqueConnectors = 10,
+                                  .generationSize = 5000,
+                                  .numGenerations = UINT32_MAX,
+                                  .numSurvivors = 5,
+                                  .numChildren = 800,
+                                  .minMutations = 1,
+                                  .maxMutations = 6,
+                                  .crossoverRate = rates[i],
+                                  .generate = puzzle_generateSwappable,
+                                  .maxSeconds = secondsPerRun };
+        for ( uint run = 0; run < numRuns; ++run ) {
+            srand( run + 1 );
+            ResultRecord best;
+            //the GA prints every generation that improves
+            fflush( stdout );
+            const int savedStdout = dup( STDOUT_FILENO );
+            const int devNull = open( "/dev/null", O_WRONLY );
+            dup2( devNull, STDOUT_FILENO );
+            close( devNull );
+            const clock_t start = clock();
+            const bool found = puzzle_findMostUniqueSolution( &config, &best );
+            clocks += clock() - start;
+            fflush( stdout );
+            dup2( savedStdout, STDOUT_FILENO );
+            close( savedStdout );
+            const uint score = found ? result_score( &best ) : 0;
+            totalBest += score;
+            if ( score > maxBest ) {
+                maxBest = score;
             }
         }
+        const double cpuSeconds = clocks * 1.0 / CLOCKS_PER_SEC;
+        printf( "crossover rate %.2f: mean best %.2f, max best %u, %.1f CPU seconds per run\n",
+                rates[i], totalBest * 1.0 / numRuns, maxBest, cpuSeconds / numRuns );
     }
-*/
-     
 }
 
-
 void benchmark_puzzleSolve( const uint numPuzzles, const char* const description ) {
     srand( 0 );
     Puzzle* puzzle = puzzle_create( 7 );
     unsigned long total = 0;
     uint maxUniqueIndexes;
     uint maxUniqueSides;
-    PuzzleSolution otherSolutions[50000];
+    //puzzle_findValidSolutions stops after the second other solution
+    PuzzleSolution otherSolutions[100];
     uint numOtherSolutions;
-    const uint maxOtherSolutions = 50000;
+    const uint maxOtherSolutions = 100;
 
     clock_t startTime = clock();
 
@@ -3,7 +3,42 @@
 
 #include <stdlib.h>
 
-void generateSwappablePuzzle( const uint numUniqueConnections );
+/*
+ * Solve numPuzzles Puzzles from puzzle_shuffle and numPuzzles from
+ * puzzle_generateSwappable, print how many of each have no other solution, exactly
+ * one, or more
+*/
+void benchmark_generatorHitRate( const uint numPuzzles, const uint numUniqueConnectors );
+/*
+ * Time getting numRings Puzzles with an edge ring where no originally touching Pieces
+ * touch, from puzzle_shuffleUntilUniqueEdge and from puzzle_generateUniqueEdge
+*/
+void benchmark_uniqueEdge( const uint numRings, const uint numUniqueConnectors );
+/*
+ * Solve numPuzzles Puzzles from puzzle_shuffle with puzzle_findValidSolutions, with
+ * puzzle_findValidSolutionsParallel on numWorkers workers and with
+ * puzzle_findValidSolutionsPipelined on numWorkers threads, print the wall clock time
+ * of each and how many times the other two disagree with puzzle_findValidSolutions
+*/
+void benchmark_parallelSolve( const uint numPuzzles, const uint numUniqueConnectors,
+                              const uint numWorkers );
+/*
+ * Solve numPuzzles Puzzles from puzzle_shuffle with the engine called engineName
+ * (engine.h), print the wall clock time and how many have exactly one other
+ * solution. With ENGINE_AUTO each Puzzle gets the engine engine_choose picks from
+ * calibrationFile (can be NULL), and how many each engine got is printed too.
+*/
+void benchmark_engine( const uint numPuzzles, const uint numUniqueConnectors,
+                       const char* const engineName, const char* const calibrationFile );
+/*
+ * Run the GA (main's settings) numRuns times for each of the numRates crossover
+ * rates, each run stopping after secondsPerRun. Runs of a rate are seeded 1 to
+ * numRuns, the same for every rate. Prints the mean and max best score each rate
+ * reached, and its CPU seconds, so rates compare on best score for the same CPU
+ * time. The GA's own output is thrown away.
+*/
+void benchmark_crossover( const uint numRuns, const double secondsPerRun,
+                          const double* const rates, const uint numRates );
 void benchmark_puzzleSolve( const uint numPuzzles, const char* const description );
 
 #endif
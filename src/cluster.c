@@ -0,0 +1,447 @@
+#include "cluster.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "prefilter.h"
+
+#define CLUSTER_MAX_WORKERS 256
+#define CLUSTER_MAX_ATTEMPTS 3
+#define CLUSTER_MAX_OTHER_SOLUTIONS 100
+//a forked worker can get to connect before the coordinator is listening
+#define CLUSTER_CONNECT_TRIES 50
+#define CLUSTER_POLL_MS 100
+
+typedef enum ClusterMessageType {
+    CLUSTER_UNIT, //coordinator to worker, a ClusterUnit
+    CLUSTER_RESULT, //worker to coordinator, a ClusterResult
+    CLUSTER_DONE //coordinator to worker, no payload
+} ClusterMessageType;
+
+typedef struct ClusterHeader {
+    uint32_t type;
+    uint32_t size; //of the payload that follows
+} ClusterHeader;
+
+typedef struct ClusterUnit {
+    uint32_t index;
+    uint32_t seed;
+    uint32_t numPuzzles;
+    uint32_t numUniqueConnectors;
+} ClusterUnit;
+
+typedef struct ClusterResult {
+    uint32_t unitIndex;
+    uint32_t numEvaluated;
+    uint32_t numScoring; //Puzzles with exactly one other solution
+    uint32_t hasBest;
+    ResultRecord best;
+} ClusterResult;
+
+typedef enum ClusterUnitState {
+    UNIT_PENDING,
+    UNIT_ASSIGNED,
+    UNIT_DONE,
+    UNIT_FAILED
+} ClusterUnitState;
+
+typedef struct ClusterWorker {
+    int fd; //-1 for a free slot
+    int unit; //-1 while idle
+} ClusterWorker;
+
+static bool cluster_writeAll( const int fd, const void* const data, const size_t size ) {
+    const char* bytes = data;
+    size_t written = 0;
+    while ( written < size ) {
+        //a worker that died mid write gets an error here instead of a SIGPIPE
+        const ssize_t result = send( fd, bytes + written, size - written, MSG_NOSIGNAL );
+        if ( result < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( result <= 0 ) {
+            return false;
+        }
+        written += result;
+    }
+    return true;
+}
+
+static bool cluster_readAll( const int fd, void* const data, const size_t size ) {
+    char* bytes = data;
+    size_t numRead = 0;
+    while ( numRead < size ) {
+        const ssize_t result = read( fd, bytes + numRead, size - numRead );
+        if ( result < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( result <= 0 ) {
+            return false;
+        }
+        numRead += result;
+    }
+    return true;
+}
+
+static bool cluster_send( const int fd, const ClusterMessageType type, const void* const payload,
+                          const uint32_t size ) {
+    const ClusterHeader header = { .type = type, .size = size };
+    return cluster_writeAll( fd, &header, sizeof( header ) ) &&
+           cluster_writeAll( fd, payload, size );
+}
+
+//false if the connection is gone or the message isn't one of the expected size
+static bool cluster_receive( const int fd, ClusterMessageType* const type, void* const payload,
+                             const uint32_t size ) {
+    ClusterHeader header;
+    if ( !cluster_readAll( fd, &header, sizeof( header ) ) ) {
+        return false;
+    }
+    *type = header.type;
+    if ( header.size == 0 ) {
+        return true;
+    }
+    return header.size == size && cluster_readAll( fd, payload, size );
+}
+
+static void cluster_address( const char* const socketPath, struct sockaddr_un* const address ) {
+    memset( address, 0, sizeof( *address ) );
+    address->sun_family = AF_UNIX;
+    if ( strlen( socketPath ) >= sizeof( address->sun_path ) ) {
+        fprintf( stderr, "Socket path %s is too long\n", socketPath );
+        exit( 1 );
+    }
+    strcpy( address->sun_path, socketPath );
+}
+
+static int cluster_listen( const char* const socketPath ) {
+    struct sockaddr_un address;
+    cluster_address( socketPath, &address );
+    unlink( socketPath );
+    const int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd < 0 || bind( fd, ( struct sockaddr* ) &address, sizeof( address ) ) != 0 ||
+         listen( fd, CLUSTER_MAX_WORKERS ) != 0 ) {
+        fprintf( stderr, "Could not listen on %s: %s\n", socketPath, strerror( errno ) );
+        exit( 1 );
+    }
+    return fd;
+}
+
+static int cluster_connect( const char* const socketPath ) {
+    struct sockaddr_un address;
+    cluster_address( socketPath, &address );
+    for ( uint i = 0; i < CLUSTER_CONNECT_TRIES; ++i ) {
+        const int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+        if ( fd < 0 ) {
+            break;
+        }
+        if ( connect( fd, ( struct sockaddr* ) &address, sizeof( address ) ) == 0 ) {
+            return fd;
+        }
+        close( fd );
+        usleep( 100000 );
+    }
+    fprintf( stderr, "Could not connect to %s: %s\n", socketPath, strerror( errno ) );
+    exit( 1 );
+}
+
+static void cluster_runUnit( const ClusterUnit* const unit, ClusterResult* const result ) {
+    PuzzleSolution solutions[CLUSTER_MAX_OTHER_SOLUTIONS];
+    PrefilterStats prefilterStats = { 0 };
+    Puzzle puzzle;
+    puzzle.numUniqueConnectors = unit->numUniqueConnectors;
+    *result = ( ClusterResult ) { .unitIndex = unit->index };
+    srand( unit->seed );
+    for ( uint i = 0; i < unit->numPuzzles; ++i ) {
+        puzzle_generateSwappable( &puzzle );
+        uint maxUniqueIndexes = 0;
+        uint maxUniqueSides = 0;
+        uint numOtherSolutions = 0;
+        if ( prefilter_mayHaveOtherSolution( &puzzle, &prefilterStats ) ) {
+            puzzle_findValidSolutions( &puzzle, solutions, &numOtherSolutions,
+                                       CLUSTER_MAX_OTHER_SOLUTIONS, &maxUniqueIndexes,
+                                       &maxUniqueSides );
+        }
+        ++result->numEvaluated;
+        if ( numOtherSolutions != 1 ) {
+            continue;
+        }
+        ++result->numScoring;
+        if ( !result->hasBest || maxUniqueSides + maxUniqueIndexes > result_score( &result->best ) ) {
+            result->best = result_create( &puzzle, &solutions[0], maxUniqueSides,
+                                          maxUniqueIndexes, RESULT_CLUSTER, 0, unit->index );
+            result->hasBest = true;
+        }
+    }
+}
+
+void cluster_work( const char* const socketPath ) {
+    const int fd = cluster_connect( socketPath );
+    ClusterUnit unit;
+    ClusterMessageType type;
+    while ( cluster_receive( fd, &type, &unit, sizeof( unit ) ) && type == CLUSTER_UNIT ) {
+        ClusterResult result;
+        cluster_runUnit( &unit, &result );
+        if ( !cluster_send( fd, CLUSTER_RESULT, &result, sizeof( result ) ) ) {
+            break;
+        }
+    }
+    close( fd );
+}
+
+typedef struct Coordinator {
+    const ClusterConfig* config;
+    int listenFd;
+    ClusterWorker workers[CLUSTER_MAX_WORKERS];
+    ClusterUnitState* states;
+    uint* attempts;
+    uint* requeued; //units whose worker died, handed out before new ones
+    uint numRequeued;
+    uint nextUnit; //units from here on haven't been handed out yet
+    uint numFinished; //done or failed
+    uint numFailed;
+    uint numReassigned;
+    uint numAlive; //forked workers that haven't been reaped
+    uint numCrashed;
+    uint64_t numEvaluated;
+    uint64_t numScoring;
+    ResultRecord best;
+    bool hasBest;
+} Coordinator;
+
+static bool coordinator_nextUnit( Coordinator* const coordinator, uint* const unit ) {
+    if ( coordinator->numRequeued ) {
+        *unit = coordinator->requeued[--coordinator->numRequeued];
+        return true;
+    }
+    if ( coordinator->nextUnit < coordinator->config->numUnits ) {
+        *unit = coordinator->nextUnit++;
+        return true;
+    }
+    return false;
+}
+
+static bool coordinator_hasUnassigned( const Coordinator* const coordinator ) {
+    return coordinator->numRequeued || coordinator->nextUnit < coordinator->config->numUnits;
+}
+
+static void coordinator_dropWorker( Coordinator* const coordinator, ClusterWorker* const worker ) {
+    close( worker->fd );
+    worker->fd = -1;
+    if ( worker->unit < 0 ) {
+        return;
+    }
+    const uint unit = worker->unit;
+    worker->unit = -1;
+    if ( ++coordinator->attempts[unit] >= CLUSTER_MAX_ATTEMPTS ) {
+        fprintf( stderr, "Giving up on unit %u after %u workers died on it\n", unit,
+                 coordinator->attempts[unit] );
+        coordinator->states[unit] = UNIT_FAILED;
+        ++coordinator->numFailed;
+        ++coordinator->numFinished;
+        return;
+    }
+    coordinator->states[unit] = UNIT_PENDING;
+    coordinator->requeued[coordinator->numRequeued++] = unit;
+    ++coordinator->numReassigned;
+}
+
+//give an idle worker its next unit, if there is one
+static void coordinator_assign( Coordinator* const coordinator, ClusterWorker* const worker ) {
+    uint index;
+    if ( worker->fd < 0 || worker->unit >= 0 || !coordinator_nextUnit( coordinator, &index ) ) {
+        return;
+    }
+    const ClusterConfig* const config = coordinator->config;
+    const ClusterUnit unit = { .index = index,
+                               .seed = config->seed + index + 1,
+                               .numPuzzles = config->puzzlesPerUnit,
+                               .numUniqueConnectors = config->numUniqueConnectors };
+    coordinator->states[index] = UNIT_ASSIGNED;
+    worker->unit = index;
+    if ( !cluster_send( worker->fd, CLUSTER_UNIT, &unit, sizeof( unit ) ) ) {
+        coordinator_dropWorker( coordinator, worker );
+    }
+}
+
+static void coordinator_spawn( Coordinator* const coordinator ) {
+    //or the child prints whatever is still buffered again
+    fflush( stdout );
+    const pid_t pid = fork();
+    if ( pid < 0 ) {
+        fprintf( stderr, "Could not fork a worker: %s\n", strerror( errno ) );
+        exit( 1 );
+    }
+    if ( pid == 0 ) {
+        close( coordinator->listenFd );
+        for ( uint i = 0; i < CLUSTER_MAX_WORKERS; ++i ) {
+            if ( coordinator->workers[i].fd >= 0 ) {
+                close( coordinator->workers[i].fd );
+            }
+        }
+        cluster_work( coordinator->config->socketPath );
+        _exit( 0 );
+    }
+    ++coordinator->numAlive;
+}
+
+static void coordinator_reap( Coordinator* const coordinator ) {
+    int status;
+    pid_t pid;
+    while ( ( pid = waitpid( -1, &status, WNOHANG ) ) > 0 ) {
+        --coordinator->numAlive;
+        if ( !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+            fprintf( stderr, "Worker %d died\n", pid );
+            ++coordinator->numCrashed;
+        }
+    }
+}
+
+static void coordinator_accept( Coordinator* const coordinator ) {
+    const int fd = accept( coordinator->listenFd, NULL, NULL );
+    if ( fd < 0 ) {
+        return;
+    }
+    for ( uint i = 0; i < CLUSTER_MAX_WORKERS; ++i ) {
+        ClusterWorker* const worker = &coordinator->workers[i];
+        if ( worker->fd < 0 ) {
+            *worker = ( ClusterWorker ) { .fd = fd, .unit = -1 };
+            coordinator_assign( coordinator, worker );
+            return;
+        }
+    }
+    fprintf( stderr, "More than %u workers, turning one away\n", CLUSTER_MAX_WORKERS );
+    close( fd );
+}
+
+static void coordinator_receive( Coordinator* const coordinator, ClusterWorker* const worker,
+                                 const uint workerIndex ) {
+    ClusterResult result;
+    ClusterMessageType type;
+    if ( !cluster_receive( worker->fd, &type, &result, sizeof( result ) ) ||
+         type != CLUSTER_RESULT || ( int ) result.unitIndex != worker->unit ) {
+        coordinator_dropWorker( coordinator, worker );
+        return;
+    }
+    coordinator->states[result.unitIndex] = UNIT_DONE;
+    ++coordinator->numFinished;
+    worker->unit = -1;
+    coordinator->numEvaluated += result.numEvaluated;
+    coordinator->numScoring += result.numScoring;
+    if ( result.hasBest ) {
+        result.best.worker = workerIndex;
+        const ClusterConfig* const config = coordinator->config;
+        if ( config->resultLog ) {
+            resultLog_append( config->resultLog, &result.best );
+        }
+        if ( config->hallOfFame ) {
+            hallOfFame_offer( config->hallOfFame, &result.best );
+        }
+        if ( !coordinator->hasBest || result_score( &result.best ) > result_score( &coordinator->best ) ) {
+            coordinator->best = result.best;
+            coordinator->hasBest = true;
+            printf( "Unit %u: best %u (%u sides + %u indexes)\n", result.unitIndex,
+                    result_score( &result.best ), result.best.uniqueSides,
+                    result.best.uniqueIndexes );
+        }
+    }
+    coordinator_assign( coordinator, worker );
+}
+
+static double secondsSince( const struct timespec* const start ) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec - start->tv_sec + ( now.tv_nsec - start->tv_nsec ) / 1e9;
+}
+
+void cluster_coordinate( const ClusterConfig* const config ) {
+    Coordinator coordinator = { .config = config };
+    coordinator.states = calloc( config->numUnits, sizeof( ClusterUnitState ) );
+    coordinator.attempts = calloc( config->numUnits, sizeof( uint ) );
+    coordinator.requeued = malloc( sizeof( uint ) * config->numUnits );
+    if ( !coordinator.states || !coordinator.attempts || !coordinator.requeued ||
+         config->numWorkers > CLUSTER_MAX_WORKERS ) {
+        fprintf( stderr, "Could not coordinate %u units over %u workers\n", config->numUnits,
+                 config->numWorkers );
+        exit( 1 );
+    }
+    for ( uint i = 0; i < CLUSTER_MAX_WORKERS; ++i ) {
+        coordinator.workers[i] = ( ClusterWorker ) { .fd = -1, .unit = -1 };
+    }
+    coordinator.listenFd = cluster_listen( config->socketPath );
+
+    struct timespec startTime;
+    clock_gettime( CLOCK_MONOTONIC, &startTime );
+    struct pollfd fds[CLUSTER_MAX_WORKERS + 1];
+    uint fdWorkers[CLUSTER_MAX_WORKERS + 1];
+    while ( coordinator.numFinished < config->numUnits ) {
+        coordinator_reap( &coordinator );
+        while ( coordinator.numAlive < config->numWorkers &&
+                coordinator_hasUnassigned( &coordinator ) ) {
+            coordinator_spawn( &coordinator );
+        }
+
+        uint numFds = 0;
+        fds[numFds++] = ( struct pollfd ) { .fd = coordinator.listenFd, .events = POLLIN };
+        for ( uint i = 0; i < CLUSTER_MAX_WORKERS; ++i ) {
+            if ( coordinator.workers[i].fd >= 0 ) {
+                fdWorkers[numFds] = i;
+                fds[numFds++] = ( struct pollfd ) { .fd = coordinator.workers[i].fd,
+                                                    .events = POLLIN };
+            }
+        }
+        if ( poll( fds, numFds, CLUSTER_POLL_MS ) <= 0 ) {
+            continue;
+        }
+        if ( fds[0].revents & POLLIN ) {
+            coordinator_accept( &coordinator );
+        }
+        for ( uint i = 1; i < numFds; ++i ) {
+            if ( fds[i].revents ) {
+                coordinator_receive( &coordinator, &coordinator.workers[fdWorkers[i]],
+                                     fdWorkers[i] );
+            }
+        }
+        //units of workers that just died go to whoever is idle
+        for ( uint i = 0; i < CLUSTER_MAX_WORKERS && coordinator_hasUnassigned( &coordinator ); ++i ) {
+            coordinator_assign( &coordinator, &coordinator.workers[i] );
+        }
+    }
+
+    for ( uint i = 0; i < CLUSTER_MAX_WORKERS; ++i ) {
+        if ( coordinator.workers[i].fd >= 0 ) {
+            cluster_send( coordinator.workers[i].fd, CLUSTER_DONE, NULL, 0 );
+            close( coordinator.workers[i].fd );
+        }
+    }
+    close( coordinator.listenFd );
+    unlink( config->socketPath );
+    while ( coordinator.numAlive ) {
+        int status;
+        if ( wait( &status ) < 0 ) {
+            break;
+        }
+        --coordinator.numAlive;
+    }
+
+    const double seconds = secondsSince( &startTime );
+    printf( "%u units done, %u given up on, %u reassigned, %u workers died\n",
+            config->numUnits - coordinator.numFailed, coordinator.numFailed,
+            coordinator.numReassigned, coordinator.numCrashed );
+    printf( "%" PRIu64 " Puzzles evaluated, %" PRIu64 " with exactly one other solution, "
+            "%.2f seconds, %.1f Puzzles per second\n", coordinator.numEvaluated,
+            coordinator.numScoring, seconds, coordinator.numEvaluated / seconds );
+    if ( coordinator.hasBest ) {
+        printf( "Best %u (%u sides + %u indexes) from unit %u\n", result_score( &coordinator.best ),
+                coordinator.best.uniqueSides, coordinator.best.uniqueIndexes,
+                coordinator.best.iteration );
+    }
+    free( coordinator.states );
+    free( coordinator.attempts );
+    free( coordinator.requeued );
+}
@@ -0,0 +1,48 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <stdlib.h>
+#include "results.h"
+
+/*
+ * Random restart search spread over worker processes
+ *
+ * The coordinator splits the search into numUnits units of puzzlesPerUnit
+ * Puzzles each. Unit i seeds rand with seed + i + 1 (srand takes 0 to mean 1),
+ * so a unit gives the same Puzzles whichever worker runs it. Each worker gets one
+ * unit at a time over its socket, evaluates those Puzzles with
+ * puzzle_findValidSolutions and sends back how many it evaluated, how many scored
+ * and the best of them.
+ *
+ * A worker whose connection drops (it crashed or was killed) has its unit handed
+ * to the next idle worker, and a forked worker that died is replaced while units
+ * are left. A unit that takes down CLUSTER_MAX_ATTEMPTS workers is given up on.
+ *
+ * Messages are a ClusterHeader followed by a fixed size payload on a stream
+ * socket, so only cluster_listen/cluster_connect know it is a Unix domain
+ * socket. Payloads are in host byte order, which is fine on one machine.
+*/
+typedef struct ClusterConfig {
+    const char* socketPath; //created by the coordinator, replacing what was there
+    uint numWorkers; //forked by the coordinator, more can join with cluster_work
+    uint numUnits;
+    uint puzzlesPerUnit;
+    uint numUniqueConnectors;
+    unsigned int seed;
+    ResultLog* resultLog; //every unit's best goes here, can be NULL
+    HallOfFame* hallOfFame; //and is offered here, can be NULL
+} ClusterConfig;
+
+/*
+ * Run every unit of config on the workers, returns when each one is done or
+ * given up on. Prints the totals at the end.
+*/
+void cluster_coordinate( const ClusterConfig* const config );
+
+/*
+ * Connect to the coordinator at socketPath and run the units it hands out,
+ * returns once it says there are no more (or goes away)
+*/
+void cluster_work( const char* const socketPath );
+
+#endif
@@ -1,14 +1,13 @@
 #include "da.h"
+#include "error.h"
 #include <stdbool.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 DynamicArray* da_create( size_t startingSize, size_t elementSize ) {
     DynamicArray *da = malloc( sizeof( DynamicArray ) );
     if ( !da ) {
-        fprintf( stderr, "Couldn't create DynamicArray\n" );
-        exit( 1 );
+        error_raise( ERROR_OUT_OF_MEMORY, "Couldn't create DynamicArray" );
     }
     da->elementSize = elementSize;
     da->size = startingSize;
@@ -17,8 +16,9 @@ DynamicArray* da_create( size_t startingSize, size_t elementSize ) {
     da->multFactor = 2;
     da->contents = malloc( startingSize * elementSize );
     if ( !da->contents ) {
-        fprintf( stderr, "Could not create %lu elements of size %lu\n", startingSize, elementSize );
-        exit( 1 );
+        free( da );
+        error_raise( ERROR_OUT_OF_MEMORY, "Could not create %lu elements of size %lu",
+                     startingSize, elementSize );
     }
 
     return da;
@@ -27,11 +27,12 @@ DynamicArray* da_create( size_t startingSize, size_t elementSize ) {
 static void da_resizeBasedOnFactor( DynamicArray* da ) {
     da->size *= da->multFactor;
     da->size += da->addFactor;
-    da->contents = realloc( da->contents, da->size * da->elementSize );
-    if ( !da->contents ) {
-        fprintf( stderr, "Could not resize to %lu elements of size %lu\n", da->size, da->elementSize );
-        exit( 1 );
+    void* const contents = realloc( da->contents, da->size * da->elementSize );
+    if ( !contents ) {
+        error_raise( ERROR_OUT_OF_MEMORY, "Could not resize to %lu elements of size %lu",
+                     da->size, da->elementSize );
     }
+    da->contents = contents;
 }
 
 void da_addElement( DynamicArray* da, void* element ) {
@@ -0,0 +1,697 @@
+#include "daemon.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "prefilter.h"
+#include "puzzle.h"
+
+#define DAEMON_MAX_CLIENTS 64
+//a solve line is about 200 characters, a client can have a few of them buffered
+#define DAEMON_BUFFER_SIZE 4096
+#define DAEMON_MAX_OTHER_SOLUTIONS 100
+//per worker, direct mapped, a power of 2
+#define DAEMON_CACHE_SLOTS 4096
+#define DAEMON_LATENCY_SAMPLES 65536
+#define DAEMON_POLL_MS 100
+
+/*
+ * One solve on its way through the daemon. The main thread fills in the request,
+ * a worker the answer.
+*/
+typedef struct DaemonJob {
+    uint client;
+    uint64_t connection; //of the client it came from, so a closed slot's answers are dropped
+    uint64_t id;
+    uint64_t startNanoseconds;
+    char connections[40];
+    uint8_t numUniqueConnectors;
+    uint8_t numOtherSolutions;
+    uint8_t maxUniqueSides;
+    uint8_t maxUniqueIndexes;
+    bool cached;
+    ErrorCode error;
+} DaemonJob;
+
+typedef struct DaemonCacheEntry {
+    char connections[40];
+    uint8_t numUniqueConnectors; //0 for an empty slot
+    uint8_t numOtherSolutions;
+    uint8_t maxUniqueSides;
+    uint8_t maxUniqueIndexes;
+} DaemonCacheEntry;
+
+//ring of jobs, only touched with the daemon's lock held
+typedef struct JobQueue {
+    DaemonJob* jobs;
+    uint capacity;
+    uint head;
+    uint count;
+} JobQueue;
+
+typedef struct DaemonClient {
+    int fd; //-1 for a free slot
+    uint64_t connection;
+    uint numOutstanding; //its solves that haven't been answered yet
+    bool readClosed; //sent everything it is going to, closed once it has its answers
+    size_t length;
+    char buffer[DAEMON_BUFFER_SIZE];
+    //answers its socket hasn't taken yet, as many as it leaves unread. Kept for the
+    //next client in the slot
+    char* output;
+    size_t outputLength;
+    size_t outputCapacity;
+} DaemonClient;
+
+typedef struct Daemon Daemon;
+
+typedef struct DaemonWorker {
+    pthread_t thread;
+    Daemon* daemon;
+    SolveWorkspace workspace;
+    DaemonCacheEntry* cache;
+    PrefilterStats prefilterStats;
+} DaemonWorker;
+
+struct Daemon {
+    const DaemonConfig* config;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    JobQueue pending; //waiting for a worker, both hold up to queueSize
+    JobQueue done; //waiting to be answered by the main thread
+    bool stopping; //workers exit once pending is empty
+    int wake[2]; //workers write a byte when they finish a job
+    //everything from here on is only used by the main thread
+    int listenFd;
+    DaemonClient clients[DAEMON_MAX_CLIENTS];
+    uint64_t numConnections;
+    uint numOutstanding; //queued, being solved or waiting to be answered
+    bool shuttingDown;
+    bool full; //stopped reading because pending is full
+    uint queueHighWater;
+    uint64_t numRequests;
+    uint64_t numSolved;
+    uint64_t numErrors;
+    uint64_t numCacheHits;
+    uint64_t numQueueFull;
+    uint64_t* latencies; //nanoseconds, a ring of the last DAEMON_LATENCY_SAMPLES
+    uint64_t numLatencies;
+};
+
+static volatile sig_atomic_t daemonSignalled = 0;
+
+static void daemon_onSignal( int signal ) {
+    daemonSignalled = 1;
+}
+
+static uint64_t monotonicNanoseconds() {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static void jobQueue_init( JobQueue* const queue, const uint capacity ) {
+    *queue = ( JobQueue ) { .jobs = malloc( sizeof( DaemonJob ) * capacity ),
+                            .capacity = capacity };
+    if ( !queue->jobs ) {
+        fprintf( stderr, "Could not allocate a queue of %u jobs\n", capacity );
+        exit( 1 );
+    }
+}
+
+static void jobQueue_push( JobQueue* const queue, const DaemonJob* const job ) {
+    queue->jobs[( queue->head + queue->count++ ) % queue->capacity] = *job;
+}
+
+static DaemonJob jobQueue_pop( JobQueue* const queue ) {
+    const DaemonJob job = queue->jobs[queue->head];
+    queue->head = ( queue->head + 1 ) % queue->capacity;
+    --queue->count;
+    return job;
+}
+
+static uint64_t daemon_hash( const char connections[40], const uint numUniqueConnectors ) {
+    uint64_t hash = 14695981039346656037ull ^ numUniqueConnectors;
+    for ( uint i = 0; i < 40; ++i ) {
+        hash = ( hash ^ ( uint8_t ) connections[i] ) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static void daemon_solve( DaemonWorker* const worker, DaemonJob* const job ) {
+    DaemonCacheEntry* const entry =
+        &worker->cache[daemon_hash( job->connections, job->numUniqueConnectors ) &
+                       ( DAEMON_CACHE_SLOTS - 1 )];
+    if ( entry->numUniqueConnectors == job->numUniqueConnectors &&
+         memcmp( entry->connections, job->connections, 40 ) == 0 ) {
+        job->numOtherSolutions = entry->numOtherSolutions;
+        job->maxUniqueSides = entry->maxUniqueSides;
+        job->maxUniqueIndexes = entry->maxUniqueIndexes;
+        job->cached = true;
+        return;
+    }
+
+    Puzzle puzzle;
+    puzzle_initFromConnections( &puzzle, job->connections, job->numUniqueConnectors );
+    PuzzleSolution solutions[DAEMON_MAX_OTHER_SOLUTIONS];
+    uint numOtherSolutions = 0;
+    uint maxUniqueIndexes = 0;
+    uint maxUniqueSides = 0;
+    if ( prefilter_mayHaveOtherSolution( &puzzle, &worker->prefilterStats ) ) {
+        SolveVerdict verdict;
+        job->error = puzzle_solveInWorkspace( &worker->workspace, &puzzle, NULL, NULL, &verdict,
+                                              solutions, &numOtherSolutions,
+                                              DAEMON_MAX_OTHER_SOLUTIONS, &maxUniqueIndexes,
+                                              &maxUniqueSides );
+    }
+    if ( job->error != ERROR_NONE ) {
+        return;
+    }
+    job->numOtherSolutions = numOtherSolutions < 2 ? numOtherSolutions : 2;
+    job->maxUniqueSides = maxUniqueSides;
+    job->maxUniqueIndexes = maxUniqueIndexes;
+    *entry = ( DaemonCacheEntry ) { .numUniqueConnectors = job->numUniqueConnectors,
+                                    .numOtherSolutions = job->numOtherSolutions,
+                                    .maxUniqueSides = job->maxUniqueSides,
+                                    .maxUniqueIndexes = job->maxUniqueIndexes };
+    memcpy( entry->connections, job->connections, 40 );
+}
+
+static void* daemon_work( void* arg ) {
+    DaemonWorker* const worker = arg;
+    Daemon* const daemon = worker->daemon;
+    pthread_mutex_lock( &daemon->lock );
+    while ( true ) {
+        while ( !daemon->pending.count && !daemon->stopping ) {
+            pthread_cond_wait( &daemon->work, &daemon->lock );
+        }
+        if ( !daemon->pending.count ) {
+            break;
+        }
+        DaemonJob job = jobQueue_pop( &daemon->pending );
+        pthread_mutex_unlock( &daemon->lock );
+
+        daemon_solve( worker, &job );
+
+        pthread_mutex_lock( &daemon->lock );
+        //done has room for every outstanding job
+        jobQueue_push( &daemon->done, &job );
+        const char byte = 0;
+        //the pipe being full is fine, the main thread is already going to wake up
+        if ( write( daemon->wake[1], &byte, 1 ) < 0 && errno != EAGAIN ) {
+            perror( "Could not wake the daemon" );
+        }
+    }
+    pthread_mutex_unlock( &daemon->lock );
+    return NULL;
+}
+
+static int daemon_listen( const char* const socketPath ) {
+    struct sockaddr_un address;
+    memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    if ( strlen( socketPath ) >= sizeof( address.sun_path ) ) {
+        fprintf( stderr, "Socket path %s is too long\n", socketPath );
+        exit( 1 );
+    }
+    strcpy( address.sun_path, socketPath );
+    unlink( socketPath );
+    const int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd < 0 || bind( fd, ( struct sockaddr* ) &address, sizeof( address ) ) != 0 ||
+         listen( fd, DAEMON_MAX_CLIENTS ) != 0 ) {
+        fprintf( stderr, "Could not listen on %s: %s\n", socketPath, strerror( errno ) );
+        exit( 1 );
+    }
+    return fd;
+}
+
+static void daemon_closeClient( DaemonClient* const client ) {
+    close( client->fd );
+    client->fd = -1;
+    client->length = 0;
+    client->outputLength = 0;
+}
+
+//close a client that has stopped sending once everything it asked for is answered
+static void daemon_closeIfFinished( DaemonClient* const client ) {
+    if ( client->fd >= 0 && client->readClosed && !client->numOutstanding &&
+         !client->length && !client->outputLength ) {
+        daemon_closeClient( client );
+    }
+}
+
+static void daemon_reply( DaemonClient* const client, const char* const format, ... )
+    __attribute__(( format( printf, 2, 3 ) ));
+
+//send as much of client's output as its socket takes without blocking
+static void daemon_flush( DaemonClient* const client ) {
+    size_t written = 0;
+    while ( written < client->outputLength ) {
+        const ssize_t result = send( client->fd, client->output + written,
+                                     client->outputLength - written, MSG_NOSIGNAL );
+        if ( result < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( result < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+            break;
+        }
+        if ( result <= 0 ) {
+            daemon_closeClient( client );
+            return;
+        }
+        written += result;
+    }
+    memmove( client->output, client->output + written, client->outputLength - written );
+    client->outputLength -= written;
+}
+
+//queue a line for client, the main loop sends what doesn't go out right away
+static void daemon_reply( DaemonClient* const client, const char* const format, ... ) {
+    char line[512];
+    va_list args;
+    va_start( args, format );
+    const int length = vsnprintf( line, sizeof( line ), format, args );
+    va_end( args );
+    if ( client->outputLength + length > client->outputCapacity ) {
+        size_t capacity = client->outputCapacity ? client->outputCapacity : DAEMON_BUFFER_SIZE;
+        while ( client->outputLength + length > capacity ) {
+            capacity *= 2;
+        }
+        char* const output = realloc( client->output, capacity );
+        if ( !output ) {
+            fprintf( stderr, "Could not allocate %zu bytes of answers\n", capacity );
+            exit( 1 );
+        }
+        client->output = output;
+        client->outputCapacity = capacity;
+    }
+    memcpy( client->output + client->outputLength, line, length );
+    client->outputLength += length;
+    daemon_flush( client );
+}
+
+static bool daemon_hasOutput( const Daemon* const daemon ) {
+    for ( uint i = 0; i < DAEMON_MAX_CLIENTS; ++i ) {
+        if ( daemon->clients[i].fd >= 0 && daemon->clients[i].outputLength ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int compareUint64( const void* p1, const void* p2 ) {
+    const uint64_t a = *( const uint64_t* ) p1;
+    const uint64_t b = *( const uint64_t* ) p2;
+    return ( a > b ) - ( a < b );
+}
+
+//nearest rank percentile of sorted, in microseconds
+static double percentileMicroseconds( const uint64_t* const sorted, const size_t numSamples,
+                                      const uint percent ) {
+    return numSamples ? sorted[( numSamples - 1 ) * percent / 100] / 1e3 : 0.0;
+}
+
+static void daemon_formatStats( Daemon* const daemon, char* const line, const size_t size ) {
+    const size_t numSamples = daemon->numLatencies < DAEMON_LATENCY_SAMPLES ?
+                              daemon->numLatencies : DAEMON_LATENCY_SAMPLES;
+    uint64_t* const sorted = malloc( sizeof( uint64_t ) * ( numSamples ? numSamples : 1 ) );
+    if ( !sorted ) {
+        fprintf( stderr, "Could not allocate %zu latency samples\n", numSamples );
+        exit( 1 );
+    }
+    memcpy( sorted, daemon->latencies, sizeof( uint64_t ) * numSamples );
+    qsort( sorted, numSamples, sizeof( uint64_t ), compareUint64 );
+    uint numClients = 0;
+    for ( uint i = 0; i < DAEMON_MAX_CLIENTS; ++i ) {
+        numClients += daemon->clients[i].fd >= 0;
+    }
+    pthread_mutex_lock( &daemon->lock );
+    const uint numQueued = daemon->pending.count;
+    pthread_mutex_unlock( &daemon->lock );
+    snprintf( line, size, "stats requests=%" PRIu64 " solved=%" PRIu64 " errors=%" PRIu64
+              " cache_hits=%" PRIu64 " queued=%u queue_high_water=%u queue_size=%u"
+              " queue_full=%" PRIu64 " clients=%u p50_us=%.1f p90_us=%.1f p99_us=%.1f"
+              " max_us=%.1f\n", daemon->numRequests, daemon->numSolved, daemon->numErrors,
+              daemon->numCacheHits, numQueued, daemon->queueHighWater,
+              daemon->config->queueSize, daemon->numQueueFull, numClients,
+              percentileMicroseconds( sorted, numSamples, 50 ),
+              percentileMicroseconds( sorted, numSamples, 90 ),
+              percentileMicroseconds( sorted, numSamples, 99 ),
+              percentileMicroseconds( sorted, numSamples, 100 ) );
+    free( sorted );
+}
+
+//fills in job's request, or says what is wrong with it in error
+static bool daemon_parseSolve( const char* text, DaemonJob* const job,
+                               const char** const error ) {
+    char* end;
+    job->id = strtoull( text, &end, 10 );
+    if ( end == text ) {
+        *error = "missing id";
+        return false;
+    }
+    text = end;
+    const unsigned long numUniqueConnectors = strtoul( text, &end, 10 );
+    if ( end == text ) {
+        *error = "missing numUniqueConnectors";
+        return false;
+    }
+    text = end;
+    for ( uint i = 0; i < 40; ++i ) {
+        const long connection = strtol( text, &end, 10 );
+        if ( end == text || connection < -128 || connection > 127 ) {
+            *error = "expected 40 connections";
+            return false;
+        }
+        job->connections[i] = connection;
+        text = end;
+    }
+    while ( *text == ' ' || *text == '\t' || *text == '\r' ) {
+        ++text;
+    }
+    if ( *text ) {
+        *error = "expected 40 connections";
+        return false;
+    }
+    if ( numUniqueConnectors > PUZZLE_MAX_CONNECTORS ||
+         !puzzle_connectionsValid( job->connections, numUniqueConnectors ) ) {
+        *error = "invalid connections";
+        return false;
+    }
+    job->numUniqueConnectors = numUniqueConnectors;
+    return true;
+}
+
+static void daemon_handleLine( Daemon* const daemon, const uint clientIndex, char* const line ) {
+    DaemonClient* const client = &daemon->clients[clientIndex];
+    ++daemon->numRequests;
+    if ( strncmp( line, "solve ", 6 ) == 0 ) {
+        DaemonJob job = { .client = clientIndex, .connection = client->connection,
+                          .startNanoseconds = monotonicNanoseconds() };
+        const char* error;
+        if ( !daemon_parseSolve( line + 6, &job, &error ) ) {
+            ++daemon->numErrors;
+            if ( strcmp( error, "missing id" ) == 0 ) {
+                daemon_reply( client, "? error %s\n", error );
+            } else {
+                daemon_reply( client, "%" PRIu64 " error %s\n", job.id, error );
+            }
+            return;
+        }
+        pthread_mutex_lock( &daemon->lock );
+        jobQueue_push( &daemon->pending, &job );
+        if ( daemon->pending.count > daemon->queueHighWater ) {
+            daemon->queueHighWater = daemon->pending.count;
+        }
+        pthread_cond_signal( &daemon->work );
+        pthread_mutex_unlock( &daemon->lock );
+        ++daemon->numOutstanding;
+        ++client->numOutstanding;
+    } else if ( strcmp( line, "stats" ) == 0 ) {
+        char stats[512];
+        daemon_formatStats( daemon, stats, sizeof( stats ) );
+        daemon_reply( client, "%s", stats );
+    } else if ( strcmp( line, "shutdown" ) == 0 ) {
+        daemon->shuttingDown = true;
+    } else {
+        ++daemon->numErrors;
+        daemon_reply( client, "? error unknown request\n" );
+    }
+}
+
+//solves being solved and waiting to be answered count too, so neither queue can fill up
+static bool daemon_hasRoom( const Daemon* const daemon ) {
+    return daemon->numOutstanding < daemon->config->queueSize;
+}
+
+//handle the whole lines client has buffered, for as long as there is room to queue them
+static void daemon_handleLines( Daemon* const daemon, const uint clientIndex ) {
+    DaemonClient* const client = &daemon->clients[clientIndex];
+    size_t start = 0;
+    while ( client->fd >= 0 && !daemon->shuttingDown ) {
+        char* const newline = memchr( client->buffer + start, '\n', client->length - start );
+        if ( !newline ) {
+            break;
+        }
+        if ( !daemon_hasRoom( daemon ) ) {
+            if ( !daemon->full ) {
+                daemon->full = true;
+                ++daemon->numQueueFull;
+            }
+            break;
+        }
+        *newline = '\0';
+        daemon_handleLine( daemon, clientIndex, client->buffer + start );
+        start = newline - client->buffer + 1;
+    }
+    if ( client->fd < 0 ) {
+        return;
+    }
+    memmove( client->buffer, client->buffer + start, client->length - start );
+    client->length -= start;
+    if ( client->length == sizeof( client->buffer ) &&
+         !memchr( client->buffer, '\n', client->length ) ) {
+        daemon_reply( client, "? error line too long\n" );
+        if ( client->fd >= 0 ) {
+            daemon_closeClient( client );
+        }
+        return;
+    }
+    daemon_closeIfFinished( client );
+}
+
+static void daemon_read( Daemon* const daemon, const uint clientIndex ) {
+    DaemonClient* const client = &daemon->clients[clientIndex];
+    const ssize_t result = read( client->fd, client->buffer + client->length,
+                                 sizeof( client->buffer ) - client->length );
+    if ( result < 0 && errno == EINTR ) {
+        return;
+    }
+    if ( result < 0 ) {
+        //answers still on their way to it are dropped when they get back
+        daemon_closeClient( client );
+        return;
+    }
+    if ( result == 0 ) {
+        //the client is done sending (shutdown(SHUT_WR), nc -N), but still gets the
+        //answers to what it sent. An unterminated last line counts as a line
+        client->readClosed = true;
+        if ( client->length && client->length < sizeof( client->buffer ) &&
+             client->buffer[client->length - 1] != '\n' ) {
+            client->buffer[client->length++] = '\n';
+        }
+    }
+    client->length += result;
+    daemon_handleLines( daemon, clientIndex );
+}
+
+static void daemon_accept( Daemon* const daemon ) {
+    const int fd = accept( daemon->listenFd, NULL, NULL );
+    if ( fd < 0 ) {
+        return;
+    }
+    //answers are sent as the client takes them, the main thread never waits on one
+    fcntl( fd, F_SETFL, O_NONBLOCK );
+    for ( uint i = 0; i < DAEMON_MAX_CLIENTS; ++i ) {
+        DaemonClient* const client = &daemon->clients[i];
+        if ( client->fd < 0 ) {
+            client->fd = fd;
+            client->connection = ++daemon->numConnections;
+            client->numOutstanding = 0;
+            client->readClosed = false;
+            client->length = 0;
+            return;
+        }
+    }
+    fprintf( stderr, "More than %u clients, turning one away\n", DAEMON_MAX_CLIENTS );
+    close( fd );
+}
+
+//answer every job the workers have finished
+static void daemon_deliver( Daemon* const daemon ) {
+    char bytes[64];
+    while ( read( daemon->wake[0], bytes, sizeof( bytes ) ) > 0 ) {
+    }
+    while ( true ) {
+        pthread_mutex_lock( &daemon->lock );
+        const bool any = daemon->done.count > 0;
+        DaemonJob job;
+        if ( any ) {
+            job = jobQueue_pop( &daemon->done );
+        }
+        pthread_mutex_unlock( &daemon->lock );
+        if ( !any ) {
+            break;
+        }
+        --daemon->numOutstanding;
+        const uint64_t latency = monotonicNanoseconds() - job.startNanoseconds;
+        daemon->latencies[daemon->numLatencies++ % DAEMON_LATENCY_SAMPLES] = latency;
+        DaemonClient* const client = &daemon->clients[job.client];
+        if ( job.error != ERROR_NONE ) {
+            ++daemon->numErrors;
+        } else {
+            ++daemon->numSolved;
+            daemon->numCacheHits += job.cached;
+        }
+        if ( client->fd < 0 || client->connection != job.connection ) {
+            continue;
+        }
+        --client->numOutstanding;
+        if ( job.error == ERROR_TOO_MANY_SOLUTIONS ) {
+            daemon_reply( client, "%" PRIu64 " error too many other solutions\n", job.id );
+        } else if ( job.error != ERROR_NONE ) {
+            daemon_reply( client, "%" PRIu64 " error out of memory\n", job.id );
+        } else {
+            daemon_reply( client, "%" PRIu64 " %u %u %u\n", job.id, job.numOtherSolutions,
+                          job.maxUniqueSides, job.maxUniqueIndexes );
+        }
+        daemon_closeIfFinished( client );
+    }
+}
+
+void daemon_serve( const DaemonConfig* const config ) {
+    if ( config->numWorkers == 0 || config->queueSize == 0 ) {
+        fprintf( stderr, "The daemon needs at least one worker and room to queue a solve\n" );
+        exit( 1 );
+    }
+    Daemon* const daemon = calloc( 1, sizeof( Daemon ) );
+    DaemonWorker* const workers = calloc( config->numWorkers, sizeof( DaemonWorker ) );
+    uint64_t* const latencies = malloc( sizeof( uint64_t ) * DAEMON_LATENCY_SAMPLES );
+    if ( !daemon || !workers || !latencies || pipe( daemon->wake ) != 0 ) {
+        fprintf( stderr, "Could not start the daemon with %u workers\n", config->numWorkers );
+        exit( 1 );
+    }
+    daemon->config = config;
+    daemon->latencies = latencies;
+    jobQueue_init( &daemon->pending, config->queueSize );
+    jobQueue_init( &daemon->done, config->queueSize );
+    pthread_mutex_init( &daemon->lock, NULL );
+    pthread_cond_init( &daemon->work, NULL );
+    fcntl( daemon->wake[0], F_SETFL, O_NONBLOCK );
+    fcntl( daemon->wake[1], F_SETFL, O_NONBLOCK );
+    for ( uint i = 0; i < DAEMON_MAX_CLIENTS; ++i ) {
+        daemon->clients[i].fd = -1;
+    }
+    daemon->listenFd = daemon_listen( config->socketPath );
+
+    struct sigaction action = { .sa_handler = daemon_onSignal };
+    sigemptyset( &action.sa_mask );
+    sigaction( SIGINT, &action, NULL );
+    sigaction( SIGTERM, &action, NULL );
+
+    for ( uint i = 0; i < config->numWorkers; ++i ) {
+        DaemonWorker* const worker = &workers[i];
+        worker->daemon = daemon;
+        worker->cache = calloc( DAEMON_CACHE_SLOTS, sizeof( DaemonCacheEntry ) );
+        if ( !worker->cache ) {
+            fprintf( stderr, "Could not allocate a cache of %u Puzzles\n", DAEMON_CACHE_SLOTS );
+            exit( 1 );
+        }
+        solveWorkspace_init( &worker->workspace, NULL );
+        pthread_create( &worker->thread, NULL, daemon_work, worker );
+    }
+    printf( "Listening on %s with %u workers\n", config->socketPath, config->numWorkers );
+    fflush( stdout );
+
+    struct pollfd fds[DAEMON_MAX_CLIENTS + 2];
+    uint fdClients[DAEMON_MAX_CLIENTS + 2];
+    //answers still unsent at shutdown are delivered, unless a signal says not to wait
+    while ( !daemon->shuttingDown || daemon->numOutstanding ||
+            ( daemon_hasOutput( daemon ) && !daemonSignalled ) ) {
+        if ( daemonSignalled ) {
+            daemon->shuttingDown = true;
+        }
+        const bool room = daemon_hasRoom( daemon );
+        if ( room && daemon->full ) {
+            //lines that were left waiting go first, before more are read
+            daemon->full = false;
+            for ( uint i = 0; i < DAEMON_MAX_CLIENTS; ++i ) {
+                if ( daemon->clients[i].fd >= 0 ) {
+                    daemon_handleLines( daemon, i );
+                }
+            }
+        }
+        const bool reading = !daemon->shuttingDown && !daemon->full;
+        uint numFds = 0;
+        fds[numFds++] = ( struct pollfd ) { .fd = daemon->wake[0], .events = POLLIN };
+        fds[numFds++] = ( struct pollfd ) { .fd = daemon->listenFd,
+                                            .events = reading ? POLLIN : 0 };
+        for ( uint i = 0; i < DAEMON_MAX_CLIENTS; ++i ) {
+            const DaemonClient* const client = &daemon->clients[i];
+            if ( client->fd >= 0 ) {
+                fdClients[numFds] = i;
+                fds[numFds++] = ( struct pollfd ) {
+                    .fd = client->fd,
+                    .events = ( reading && !client->readClosed ? POLLIN : 0 ) |
+                              ( client->outputLength ? POLLOUT : 0 ) };
+            }
+        }
+        if ( poll( fds, numFds, DAEMON_POLL_MS ) <= 0 ) {
+            continue;
+        }
+        if ( fds[0].revents ) {
+            daemon_deliver( daemon );
+        }
+        if ( fds[1].revents & POLLIN ) {
+            daemon_accept( daemon );
+        }
+        for ( uint i = 2; i < numFds; ++i ) {
+            DaemonClient* const client = &daemon->clients[fdClients[i]];
+            if ( client->fd < 0 || !fds[i].revents ) {
+                continue;
+            }
+            if ( fds[i].revents & POLLOUT ) {
+                daemon_flush( client );
+                daemon_closeIfFinished( client );
+            }
+            if ( client->fd < 0 ) {
+                continue;
+            }
+            if ( fds[i].revents & ( POLLHUP | POLLERR ) && client->readClosed ) {
+                //hung up both ways, nothing more can be delivered to it
+                daemon_closeClient( client );
+            } else if ( fds[i].revents & ( POLLIN | POLLHUP | POLLERR ) ) {
+                daemon_read( daemon, fdClients[i] );
+            }
+        }
+    }
+
+    pthread_mutex_lock( &daemon->lock );
+    daemon->stopping = true;
+    pthread_cond_broadcast( &daemon->work );
+    pthread_mutex_unlock( &daemon->lock );
+    for ( uint i = 0; i < config->numWorkers; ++i ) {
+        pthread_join( workers[i].thread, NULL );
+        solveWorkspace_free( &workers[i].workspace );
+        free( workers[i].cache );
+    }
+    char stats[512];
+    daemon_formatStats( daemon, stats, sizeof( stats ) );
+    printf( "%s", stats );
+    for ( uint i = 0; i < DAEMON_MAX_CLIENTS; ++i ) {
+        if ( daemon->clients[i].fd >= 0 ) {
+            daemon_closeClient( &daemon->clients[i] );
+        }
+        free( daemon->clients[i].output );
+    }
+    close( daemon->listenFd );
+    unlink( config->socketPath );
+    close( daemon->wake[0] );
+    close( daemon->wake[1] );
+    pthread_mutex_destroy( &daemon->lock );
+    pthread_cond_destroy( &daemon->work );
+    free( daemon->pending.jobs );
+    free( daemon->done.jobs );
+    free( latencies );
+    free( workers );
+    free( daemon );
+}
@@ -0,0 +1,47 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <stdlib.h>
+
+/*
+ * Long lived solver behind a Unix domain socket, so scripts that solve a few
+ * Puzzles each don't pay for process startup and cold buffers every time
+ *
+ * Clients send lines and can have as many in flight as they like, each request is
+ * answered by one line:
+ *
+ *     solve <id> <numUniqueConnectors> <connection 0> ... <connection 39>
+ *         -> <id> <numOtherSolutions> <maxUniqueSides> <maxUniqueIndexes>
+ *            numOtherSolutions stops at 2, same as puzzle_findValidSolutions
+ *         -> <id> error <what>
+ *     stats -> stats key=value ... (counts since startup, latency percentiles over
+ *              the last DAEMON_LATENCY_SAMPLES solves)
+ *     shutdown -> finishes what is queued, answers it and exits
+ *
+ * Solves are answered as they finish, not in the order they were sent, the id is
+ * there to match them up. Connections are the Puzzle's connections array.
+ *
+ * numWorkers threads solve, each keeping its own SolveWorkspace and a cache of the
+ * Puzzles it has solved, for as long as the daemon runs. At most queueSize solves
+ * are in the daemon at once (queued, being solved or not answered yet). Past that
+ * the daemon stops reading from clients until there is room. Answers are kept per
+ * client for as long as it leaves them unread and sent as its socket takes them,
+ * so a client can write everything before reading anything, and one that doesn't
+ * read never holds up the others.
+ *
+ * A client that is done sending can shut down its side of the socket, it still
+ * gets every answer and is closed after the last one.
+*/
+typedef struct DaemonConfig {
+    const char* socketPath; //created by the daemon, replacing what was there
+    uint numWorkers;
+    uint queueSize;
+} DaemonConfig;
+
+/*
+ * Serve requests until a client sends shutdown, or SIGINT / SIGTERM. Prints the
+ * stats line at the end.
+*/
+void daemon_serve( const DaemonConfig* const config );
+
+#endif
@@ -0,0 +1,188 @@
+#include "edgecache.h"
+#include <stdio.h>
+#include <string.h>
+
+void edgeRingCache_init( EdgeRingCache* const cache, const uint capacity,
+                         const size_t maxEdgeSolutions ) {
+    uint numBuckets = 1;
+    while ( numBuckets < capacity * 2 ) {
+        numBuckets *= 2;
+    }
+    *cache = ( EdgeRingCache ) { .entries = calloc( capacity, sizeof( EdgeRingEntry ) ),
+                                 .buckets = malloc( sizeof( uint ) * numBuckets ),
+                                 .numBuckets = numBuckets,
+                                 .capacity = capacity,
+                                 .maxEdgeSolutions = maxEdgeSolutions };
+    if ( !cache->entries || !cache->buckets || capacity == 0 ) {
+        fprintf( stderr, "Could not create an edge ring cache of %u rings\n", capacity );
+        exit( 1 );
+    }
+    for ( uint i = 0; i < numBuckets; ++i ) {
+        cache->buckets[i] = EDGE_RING_CACHE_NONE;
+    }
+    pthread_rwlock_init( &cache->lock, NULL );
+}
+
+void edgeRingCache_free( EdgeRingCache* const cache ) {
+    for ( uint i = 0; i < cache->numEntries; ++i ) {
+        edgeSet_free( &cache->entries[i].edgeSet );
+    }
+    free( cache->entries );
+    free( cache->buckets );
+    pthread_rwlock_destroy( &cache->lock );
+}
+
+static void edgeRing_fromPuzzle( char ring[16], const Puzzle* const puzzle ) {
+    uint numRing = 0;
+    for ( uint i = 0; i < 40; ++i ) {
+        if ( ( PUZZLE_EDGE_RING_CONNECTIONS >> i ) & 1 ) {
+            ring[numRing++] = puzzle->connections[i];
+        }
+    }
+}
+
+//FNV-1a
+static uint edgeRing_bucket( const EdgeRingCache* const cache, const char ring[16] ) {
+    uint64_t hash = 14695981039346656037ull;
+    for ( uint i = 0; i < 16; ++i ) {
+        hash = ( hash ^ ( unsigned char ) ring[i] ) * 1099511628211ull;
+    }
+    return hash & ( cache->numBuckets - 1 );
+}
+
+//only call under a lock
+static EdgeRingEntry* edgeRingCache_find( const EdgeRingCache* const cache,
+                                          const char ring[16] ) {
+    for ( uint i = cache->buckets[edgeRing_bucket( cache, ring )]; i != EDGE_RING_CACHE_NONE;
+          i = cache->entries[i].next ) {
+        if ( memcmp( cache->entries[i].ring, ring, 16 ) == 0 ) {
+            return &cache->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void edgeSet_copy( EdgeSet* const dest, const EdgeSet* const src ) {
+    tripleVec_reserve( &dest->triples, src->triples.numElements );
+    memcpy( dest->triples.contents, src->triples.contents,
+            sizeof( TripleIndex ) * src->triples.numElements );
+    dest->triples.numElements = src->triples.numElements;
+    compactEdgeVec_reserve( &dest->solutions, src->solutions.numElements );
+    memcpy( dest->solutions.contents, src->solutions.contents,
+            sizeof( CompactEdgeSolution ) * src->solutions.numElements );
+    dest->solutions.numElements = src->solutions.numElements;
+}
+
+/*
+ * Copy ring's entry into edgeSet if there is one, returns false for none. tooBig is
+ * set for a ring that is too big, edgeSet is left alone then.
+*/
+static bool edgeRingCache_lookup( EdgeRingCache* const cache, const char ring[16],
+                                  EdgeSet* const edgeSet, bool* const tooBig ) {
+    pthread_rwlock_rdlock( &cache->lock );
+    EdgeRingEntry* const entry = edgeRingCache_find( cache, ring );
+    if ( entry ) {
+        *tooBig = entry->tooBig;
+        if ( !entry->tooBig ) {
+            edgeSet_copy( edgeSet, &entry->edgeSet );
+        }
+        //other readers can be storing at the same time, any of their ticks will do
+        atomic_store_explicit( &entry->lastUsed,
+                               atomic_fetch_add_explicit( &cache->clock, 1,
+                                                          memory_order_relaxed ),
+                               memory_order_relaxed );
+    }
+    pthread_rwlock_unlock( &cache->lock );
+    return entry != NULL;
+}
+
+//take the least recently used entry out of its bucket, only call under the write lock
+static EdgeRingEntry* edgeRingCache_evict( EdgeRingCache* const cache ) {
+    uint oldest = 0;
+    for ( uint i = 1; i < cache->numEntries; ++i ) {
+        if ( atomic_load_explicit( &cache->entries[i].lastUsed, memory_order_relaxed ) <
+             atomic_load_explicit( &cache->entries[oldest].lastUsed, memory_order_relaxed ) ) {
+            oldest = i;
+        }
+    }
+    uint* link = &cache->buckets[edgeRing_bucket( cache, cache->entries[oldest].ring )];
+    while ( *link != oldest ) {
+        link = &cache->entries[*link].next;
+    }
+    *link = cache->entries[oldest].next;
+    atomic_fetch_add_explicit( &cache->numEvictions, 1, memory_order_relaxed );
+    return &cache->entries[oldest];
+}
+
+//add ring with edgeSet, or as too big when edgeSet is NULL
+static void edgeRingCache_insert( EdgeRingCache* const cache, const char ring[16],
+                                  const EdgeSet* const edgeSet ) {
+    pthread_rwlock_wrlock( &cache->lock );
+    //another thread can have missed on the same ring at the same time
+    if ( !edgeRingCache_find( cache, ring ) ) {
+        EdgeRingEntry* const entry = cache->numEntries < cache->capacity ?
+                                     &cache->entries[cache->numEntries++] :
+                                     edgeRingCache_evict( cache );
+        memcpy( entry->ring, ring, 16 );
+        entry->tooBig = edgeSet == NULL;
+        entry->edgeSet.triples.numElements = 0;
+        entry->edgeSet.solutions.numElements = 0;
+        if ( edgeSet ) {
+            edgeSet_copy( &entry->edgeSet, edgeSet );
+        }
+        atomic_store_explicit( &entry->lastUsed,
+                               atomic_fetch_add_explicit( &cache->clock, 1,
+                                                          memory_order_relaxed ),
+                               memory_order_relaxed );
+        const uint bucket = edgeRing_bucket( cache, ring );
+        entry->next = cache->buckets[bucket];
+        cache->buckets[bucket] = entry - cache->entries;
+    }
+    pthread_rwlock_unlock( &cache->lock );
+}
+
+bool edgeRingCache_findValidSolutions( EdgeRingCache* const cache, const Puzzle* const puzzle,
+                                       PuzzleSolution* const otherSolutions,
+                                       uint* const numOtherSolutions,
+                                       const uint maxOtherSolutions,
+                                       uint* const maxUniqueIndexes,
+                                       uint* const maxUniqueSides ) {
+    static __thread EdgeSet edgeSet;
+    static __thread bool allocatedArrays = false;
+    if ( !allocatedArrays ) {
+        //terrible idea, no real way to free this after
+        edgeSet_init( &edgeSet, 1024 );
+        allocatedArrays = true;
+    }
+    char ring[16];
+    edgeRing_fromPuzzle( ring, puzzle );
+
+    bool tooBig = false;
+    const bool hit = edgeRingCache_lookup( cache, ring, &edgeSet, &tooBig );
+    atomic_fetch_add_explicit( hit ? &cache->numHits : &cache->numMisses, 1,
+                               memory_order_relaxed );
+    if ( !hit ) {
+        tooBig = !puzzle_findValidEdgesUpTo( puzzle, &edgeSet, cache->maxEdgeSolutions );
+        edgeRingCache_insert( cache, ring, tooBig ? NULL : &edgeSet );
+    }
+    if ( tooBig ) {
+        atomic_fetch_add_explicit( &cache->numTooBig, 1, memory_order_relaxed );
+        puzzle_findValidSolutions( puzzle, otherSolutions, numOtherSolutions, maxOtherSolutions,
+                                   maxUniqueIndexes, maxUniqueSides );
+    } else {
+        puzzle_findValidSolutions2( puzzle, &edgeSet, otherSolutions, numOtherSolutions,
+                                    maxOtherSolutions, maxUniqueIndexes, maxUniqueSides );
+    }
+    return hit;
+}
+
+void edgeRingCache_printStats( EdgeRingCache* const cache ) {
+    const uint64_t numHits = atomic_load( &cache->numHits );
+    const uint64_t numMisses = atomic_load( &cache->numMisses );
+    printf( "Edge ring cache: %" PRIu64 " hits, %" PRIu64 " misses (%.1f%% hit), %" PRIu64
+            " solves of rings too big to keep, %" PRIu64 " evictions, %u of %u rings held\n",
+            numHits, numMisses,
+            numHits + numMisses ? numHits * 100.0 / ( numHits + numMisses ) : 0.0,
+            atomic_load( &cache->numTooBig ), atomic_load( &cache->numEvictions ),
+            cache->numEntries, cache->capacity );
+}
@@ -0,0 +1,72 @@
+#ifndef EDGECACHE_H
+#define EDGECACHE_H
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "puzzle.h"
+
+/*
+ * The EdgeSolutions of recently seen edge rings, shared by every thread solving
+ *
+ * The edge stage only looks at the 16 edge ring connections
+ * (PUZZLE_EDGE_RING_CONNECTIONS), so Puzzles with the same ring have the same edge
+ * triples and EdgeSolutions whatever their centers are. The GA's children of one
+ * survivor mostly keep its ring, and anneal chains come back to rings they left.
+ *
+ * Lookups only take the read lock, long enough to copy the entry out, so solves
+ * never run under the lock. A miss lists the ring's EdgeSolutions and takes the
+ * write lock to add them, replacing the least recently used entry once there are
+ * capacity (found by a scan, misses already cost a whole edge stage). A ring with
+ * more than maxEdgeSolutions is only remembered as too big, and its Puzzles are
+ * solved the usual way, which can stop before listing them all.
+*/
+#define EDGE_RING_CACHE_NONE UINT32_MAX
+
+typedef struct EdgeRingEntry {
+    char ring[16]; //the ring connections, lowest connection first
+    bool tooBig; //edgeSet is empty, the ring has more than maxEdgeSolutions
+    uint next; //next entry in the same bucket, EDGE_RING_CACHE_NONE for none
+    atomic_uint_fast64_t lastUsed; //tick of the cache's clock
+    EdgeSet edgeSet; //grown to the largest ring the entry has held, reused after
+} EdgeRingEntry;
+
+typedef struct EdgeRingCache {
+    pthread_rwlock_t lock;
+    EdgeRingEntry* entries;
+    uint* buckets; //first entry of each bucket, EDGE_RING_CACHE_NONE for none
+    uint numBuckets; //power of 2
+    uint capacity;
+    uint numEntries;
+    size_t maxEdgeSolutions;
+    atomic_uint_fast64_t clock;
+    atomic_uint_fast64_t numHits;
+    atomic_uint_fast64_t numMisses;
+    atomic_uint_fast64_t numTooBig; //solves of a ring that was too big to keep
+    atomic_uint_fast64_t numEvictions;
+} EdgeRingCache;
+
+//exits if it can't be allocated
+void edgeRingCache_init( EdgeRingCache* const cache, const uint capacity,
+                         const size_t maxEdgeSolutions );
+void edgeRingCache_free( EdgeRingCache* const cache );
+
+/*
+ * puzzle_findValidSolutions, with the edge stage skipped when puzzle's ring is in
+ * cache. Same answer as puzzle_findValidSolutions, the center stage goes through
+ * the EdgeSolutions in the same order. Returns whether the ring was in cache.
+ *
+ * Thread safe.
+*/
+bool edgeRingCache_findValidSolutions( EdgeRingCache* const cache, const Puzzle* const puzzle,
+                                       PuzzleSolution* const otherSolutions,
+                                       uint* const numOtherSolutions,
+                                       const uint maxOtherSolutions,
+                                       uint* const maxUniqueIndexes,
+                                       uint* const maxUniqueSides );
+
+void edgeRingCache_printStats( EdgeRingCache* const cache );
+
+#endif
@@ -0,0 +1,298 @@
+#include "engine.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static const SolveEngine engines[ENGINE_COUNT] = {
+    { "batched/nested", SOLVE_DRIVER_BATCHED, EDGE_STAGE_NESTED },
+    { "batched/stack", SOLVE_DRIVER_BATCHED, EDGE_STAGE_STACK },
+    { "twophase/nested", SOLVE_DRIVER_TWO_PHASE, EDGE_STAGE_NESTED },
+    { "twophase/stack", SOLVE_DRIVER_TWO_PHASE, EDGE_STAGE_STACK },
+    { "pipelined/nested", SOLVE_DRIVER_PIPELINED, EDGE_STAGE_NESTED },
+    { "pipelined/stack", SOLVE_DRIVER_PIPELINED, EDGE_STAGE_STACK },
+};
+
+#define ENGINE_CALIBRATION_HEADER "engines"
+
+const SolveEngine* engine_find( const char* const name ) {
+    for ( uint i = 0; i < ENGINE_COUNT; ++i ) {
+        if ( strcmp( engines[i].name, name ) == 0 ) {
+            return &engines[i];
+        }
+    }
+    return NULL;
+}
+
+const SolveEngine* engine_at( const uint index ) {
+    return &engines[index];
+}
+
+void engine_printAll() {
+    for ( uint i = 0; i < ENGINE_COUNT; ++i ) {
+        printf( "%s\n", engines[i].name );
+    }
+}
+
+//every EdgeSolution of the Puzzle, for twophase
+static void engine_solveTwoPhase( const Puzzle* const puzzle,
+                                  PuzzleSolution* const otherSolutions,
+                                  uint* const numOtherSolutions, const uint maxOtherSolutions,
+                                  uint* const maxUniqueIndexes, uint* const maxUniqueSides ) {
+    static __thread EdgeSet edgeSet;
+    static __thread bool allocatedArrays = false;
+    if ( !allocatedArrays ) {
+        //terrible idea, no real way to free this after
+        edgeSet_init( &edgeSet, 10000 );
+        allocatedArrays = true;
+    }
+    puzzle_findValidEdges( puzzle, &edgeSet );
+    puzzle_findValidSolutions2( puzzle, &edgeSet, otherSolutions, numOtherSolutions,
+                                maxOtherSolutions, maxUniqueIndexes, maxUniqueSides );
+}
+
+void engine_solve( const SolveEngine* const engine, const Puzzle* const puzzle,
+                   PuzzleSolution* const otherSolutions, uint* const numOtherSolutions,
+                   const uint maxOtherSolutions, uint* const maxUniqueIndexes,
+                   uint* const maxUniqueSides ) {
+    const EdgeStage previous = puzzle_useEdgeStage( engine->edgeStage );
+    switch ( engine->driver ) {
+        case SOLVE_DRIVER_BATCHED:
+            puzzle_findValidSolutions( puzzle, otherSolutions, numOtherSolutions,
+                                       maxOtherSolutions, maxUniqueIndexes, maxUniqueSides );
+            break;
+        case SOLVE_DRIVER_TWO_PHASE:
+            engine_solveTwoPhase( puzzle, otherSolutions, numOtherSolutions, maxOtherSolutions,
+                                  maxUniqueIndexes, maxUniqueSides );
+            break;
+        case SOLVE_DRIVER_PIPELINED: {
+            //the calling thread has the edge stage
+            const long numCores = sysconf( _SC_NPROCESSORS_ONLN );
+            puzzle_findValidSolutionsPipelined( puzzle, numCores > 1 ? numCores - 1 : 1, NULL,
+                                                otherSolutions, numOtherSolutions,
+                                                maxOtherSolutions, maxUniqueIndexes,
+                                                maxUniqueSides );
+            break;
+        }
+        case SOLVE_NUM_DRIVERS:
+            break;
+    }
+    puzzle_useEdgeStage( previous );
+}
+
+EngineFeatures engine_features( const Puzzle* const puzzle ) {
+    uint counts[PUZZLE_MAX_CONNECTORS + 1] = { 0 };
+    uint ringRepeats = 0;
+    for ( uint i = 0; i < 40; ++i ) {
+        if ( ( PUZZLE_EDGE_RING_CONNECTIONS >> i ) & 1 ) {
+            const uint count = ++counts[abs( puzzle->connections[i] )];
+            ringRepeats = count > ringRepeats ? count : ringRepeats;
+        }
+    }
+    return ( EngineFeatures ) { .numUniqueConnectors = puzzle->numUniqueConnectors,
+                                .ringRepeats = ringRepeats < ENGINE_MAX_RING_REPEATS ?
+                                               ringRepeats : ENGINE_MAX_RING_REPEATS };
+}
+
+static void engineCalibration_clear( EngineCalibration* const calibration ) {
+    memset( calibration->numPuzzles, 0, sizeof( calibration->numPuzzles ) );
+    for ( uint i = 0; i <= PUZZLE_MAX_CONNECTORS; ++i ) {
+        for ( uint j = 0; j <= ENGINE_MAX_RING_REPEATS; ++j ) {
+            for ( uint k = 0; k < ENGINE_COUNT; ++k ) {
+                //not timed
+                calibration->nanoseconds[i][j][k] = -1;
+            }
+        }
+    }
+}
+
+static uint64_t monotonicNanoseconds() {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+//index of the fastest timed engine, ENGINE_COUNT if none was timed
+static uint fastestEngine( const double nanoseconds[ENGINE_COUNT] ) {
+    uint fastest = ENGINE_COUNT;
+    for ( uint i = 0; i < ENGINE_COUNT; ++i ) {
+        if ( nanoseconds[i] >= 0 &&
+             ( fastest == ENGINE_COUNT || nanoseconds[i] < nanoseconds[fastest] ) ) {
+            fastest = i;
+        }
+    }
+    return fastest;
+}
+
+void engine_calibrate( EngineCalibration* const calibration, const uint numPuzzles,
+                       const uint minConnectors, const uint maxConnectors ) {
+    if ( minConnectors < 2 || maxConnectors > PUZZLE_MAX_CONNECTORS ||
+         minConnectors > maxConnectors ) {
+        fprintf( stderr, "Can't calibrate engines on %u to %u connectors\n", minConnectors,
+                 maxConnectors );
+        exit( 1 );
+    }
+    engineCalibration_clear( calibration );
+    srand( 0 );
+
+    const uint maxOtherSolutions = 100;
+    PuzzleSolution otherSolutions[maxOtherSolutions];
+    uint64_t numDisagreements = 0;
+    for ( uint connectors = minConnectors; connectors <= maxConnectors; ++connectors ) {
+        double totals[ENGINE_MAX_RING_REPEATS + 1][ENGINE_COUNT] = { { 0 } };
+        for ( uint i = 0; i < numPuzzles; ++i ) {
+            Puzzle puzzle;
+            puzzle_init( &puzzle, connectors );
+            puzzle_shuffle( &puzzle );
+            const EngineFeatures features = engine_features( &puzzle );
+            ++calibration->numPuzzles[connectors][features.ringRepeats];
+
+            //the first engine on a Puzzle finds the caches cold, so each takes its turn
+            uint found[ENGINE_COUNT];
+            for ( uint k = 0; k < ENGINE_COUNT; ++k ) {
+                const uint j = ( i + k ) % ENGINE_COUNT;
+                uint numOtherSolutions = 0;
+                uint maxUniqueIndexes = 0;
+                uint maxUniqueSides = 0;
+                const uint64_t start = monotonicNanoseconds();
+                engine_solve( &engines[j], &puzzle, otherSolutions, &numOtherSolutions,
+                              maxOtherSolutions, &maxUniqueIndexes, &maxUniqueSides );
+                totals[features.ringRepeats][j] += monotonicNanoseconds() - start;
+
+                //past 2 it only depends on when the engine noticed
+                found[j] = numOtherSolutions < 2 ? numOtherSolutions : 2;
+            }
+            for ( uint j = 1; j < ENGINE_COUNT; ++j ) {
+                if ( found[j] != found[0] ) {
+                    fprintf( stderr, "%s found %u other solutions where %s found %u\n",
+                             engines[j].name, found[j], engines[0].name, found[0] );
+                    ++numDisagreements;
+                }
+            }
+        }
+        for ( uint repeats = 0; repeats <= ENGINE_MAX_RING_REPEATS; ++repeats ) {
+            const uint numSeen = calibration->numPuzzles[connectors][repeats];
+            if ( numSeen == 0 ) {
+                continue;
+            }
+            for ( uint j = 0; j < ENGINE_COUNT; ++j ) {
+                calibration->nanoseconds[connectors][repeats][j] = totals[repeats][j] / numSeen;
+            }
+            const uint fastest = fastestEngine( calibration->nanoseconds[connectors][repeats] );
+            printf( "%u connectors, ring repeats %u: %u Puzzles, %s fastest at %.1f us "
+                    "(%s %.1f us)\n", connectors, repeats, numSeen, engines[fastest].name,
+                    calibration->nanoseconds[connectors][repeats][fastest] / 1000,
+                    engines[0].name, calibration->nanoseconds[connectors][repeats][0] / 1000 );
+        }
+    }
+    printf( "%" PRIu64 " disagreements\n", numDisagreements );
+}
+
+void engineCalibration_write( const EngineCalibration* const calibration,
+                              const char* const path ) {
+    FILE* file = fopen( path, "w" );
+    if ( !file ) {
+        fprintf( stderr, "Could not write engine calibration %s\n", path );
+        exit( 1 );
+    }
+    fprintf( file, "# numUniqueConnectors ringRepeats numPuzzles, then mean ns per solve "
+                   "of each engine\n" ENGINE_CALIBRATION_HEADER );
+    for ( uint i = 0; i < ENGINE_COUNT; ++i ) {
+        fprintf( file, " %s", engines[i].name );
+    }
+    fprintf( file, "\n" );
+    for ( uint i = 0; i <= PUZZLE_MAX_CONNECTORS; ++i ) {
+        for ( uint j = 0; j <= ENGINE_MAX_RING_REPEATS; ++j ) {
+            if ( calibration->numPuzzles[i][j] == 0 ) {
+                continue;
+            }
+            fprintf( file, "%u %u %u", i, j, calibration->numPuzzles[i][j] );
+            for ( uint k = 0; k < ENGINE_COUNT; ++k ) {
+                fprintf( file, " %.0f", calibration->nanoseconds[i][j][k] );
+            }
+            fprintf( file, "\n" );
+        }
+    }
+    fclose( file );
+}
+
+bool engineCalibration_read( EngineCalibration* const calibration, const char* const path ) {
+    FILE* file = fopen( path, "r" );
+    if ( !file ) {
+        return false;
+    }
+    engineCalibration_clear( calibration );
+    //which engine each column of times is, ENGINE_COUNT for one this build doesn't have
+    uint columns[ENGINE_COUNT * 2];
+    uint numColumns = 0;
+    char line[1024];
+    while ( fgets( line, sizeof( line ), file ) ) {
+        if ( line[0] == '#' ) {
+            continue;
+        }
+        char* save = NULL;
+        char* token = strtok_r( line, " \n", &save );
+        if ( !token ) {
+            continue;
+        }
+        if ( strcmp( token, ENGINE_CALIBRATION_HEADER ) == 0 ) {
+            numColumns = 0;
+            while ( ( token = strtok_r( NULL, " \n", &save ) ) &&
+                    numColumns < ENGINE_COUNT * 2 ) {
+                const SolveEngine* const engine = engine_find( token );
+                columns[numColumns++] = engine ? ( uint ) ( engine - engines ) : ENGINE_COUNT;
+            }
+            continue;
+        }
+        const uint connectors = strtoul( token, NULL, 10 );
+        token = strtok_r( NULL, " \n", &save );
+        const uint repeats = token ? strtoul( token, NULL, 10 ) : 0;
+        token = strtok_r( NULL, " \n", &save );
+        if ( !token || connectors > PUZZLE_MAX_CONNECTORS || repeats > ENGINE_MAX_RING_REPEATS ) {
+            continue;
+        }
+        calibration->numPuzzles[connectors][repeats] = strtoul( token, NULL, 10 );
+        for ( uint i = 0; i < numColumns && ( token = strtok_r( NULL, " \n", &save ) ); ++i ) {
+            if ( columns[i] < ENGINE_COUNT ) {
+                calibration->nanoseconds[connectors][repeats][columns[i]] = strtod( token, NULL );
+            }
+        }
+    }
+    fclose( file );
+    return true;
+}
+
+const SolveEngine* engine_choose( const EngineCalibration* const calibration,
+                                  const Puzzle* const puzzle ) {
+    const SolveEngine* const fallback = engine_find( ENGINE_DEFAULT );
+    if ( !calibration ) {
+        return fallback;
+    }
+    const EngineFeatures features = engine_features( puzzle );
+    if ( features.numUniqueConnectors > PUZZLE_MAX_CONNECTORS ) {
+        return fallback;
+    }
+    //closest ring repeats first, fewer before more on a tie
+    for ( uint distance = 0; distance <= ENGINE_MAX_RING_REPEATS; ++distance ) {
+        const int candidates[2] = { ( int ) features.ringRepeats - ( int ) distance,
+                                    ( int ) ( features.ringRepeats + distance ) };
+        for ( uint i = 0; i < 2; ++i ) {
+            const int repeats = candidates[i];
+            if ( repeats < 0 || repeats > ENGINE_MAX_RING_REPEATS ||
+                 calibration->numPuzzles[features.numUniqueConnectors][repeats] <
+                 ENGINE_MIN_CALIBRATION_PUZZLES ) {
+                continue;
+            }
+            const double* const nanoseconds =
+                calibration->nanoseconds[features.numUniqueConnectors][repeats];
+            const uint fastest = fastestEngine( nanoseconds );
+            const double fallbackNanoseconds = nanoseconds[fallback - engines];
+            if ( fastest == ENGINE_COUNT || ( fallbackNanoseconds >= 0 &&
+                 fallbackNanoseconds < nanoseconds[fastest] * ENGINE_MIN_SPEEDUP ) ) {
+                return fallback;
+            }
+            return &engines[fastest];
+        }
+    }
+    return fallback;
+}
@@ -0,0 +1,128 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "puzzle.h"
+
+/*
+ * Interchangeable ways of solving one Puzzle, picked by name at runtime
+ *
+ * An engine is a driver and the edge stage (EdgeStage) it runs with, named
+ * "<driver>/<edge stage>":
+ *
+ *     batched    EdgeSolutions go to the center stage 1024 at a time, so the
+ *                solve can stop at the second other solution before the edge
+ *                stage is done (puzzle_findValidSolutions)
+ *     twophase   every EdgeSolution first (puzzle_findValidEdges), then the
+ *                center stage over all of them (puzzle_findValidSolutions2)
+ *     pipelined  the edge stage on the calling thread, the center stage on the
+ *                other cores (puzzle_findValidSolutionsPipelined)
+ *
+ *     nested, stack  EDGE_STAGE_NESTED, EDGE_STAGE_STACK
+ *
+ * Every engine gives the same numOtherSolutions. When there is more than one
+ * other solution, which two are found (and so maxUniqueIndexes / Sides) depends on
+ * the order the engine goes through the EdgeSolutions in.
+*/
+typedef enum SolveDriver {
+    SOLVE_DRIVER_BATCHED,
+    SOLVE_DRIVER_TWO_PHASE,
+    SOLVE_DRIVER_PIPELINED,
+    SOLVE_NUM_DRIVERS
+} SolveDriver;
+
+#define ENGINE_COUNT ( SOLVE_NUM_DRIVERS * EDGE_NUM_STAGES )
+//what engine_choose falls back to, same as puzzle_findValidSolutions
+#define ENGINE_DEFAULT "batched/nested"
+//name that has engine_choose pick per Puzzle instead of naming an engine
+#define ENGINE_AUTO "auto"
+//edge ring connector counts past this are calibrated together
+#define ENGINE_MAX_RING_REPEATS 8
+//fewer calibrated Puzzles than this and engine_choose looks at the next features
+#define ENGINE_MIN_CALIBRATION_PUZZLES 4
+//how many times faster than ENGINE_DEFAULT another engine has to be to be picked,
+//engines a few percent apart swap places from one calibration to the next
+#define ENGINE_MIN_SPEEDUP 1.1
+
+typedef struct SolveEngine {
+    const char* name;
+    SolveDriver driver;
+    EdgeStage edgeStage;
+} SolveEngine;
+
+/*
+ * The engine called name, NULL if there is none
+*/
+const SolveEngine* engine_find( const char* const name );
+
+//the engine at index, [0, ENGINE_COUNT)
+const SolveEngine* engine_at( const uint index );
+
+//print every engine's name, one per line
+void engine_printAll();
+
+/*
+ * Solve puzzle with engine, arguments as puzzle_findValidSolutions. The calling
+ * thread's edge stage is put back after.
+*/
+void engine_solve( const SolveEngine* const engine, const Puzzle* const puzzle,
+                   PuzzleSolution* const otherSolutions, uint* const numOtherSolutions,
+                   const uint maxOtherSolutions, uint* const maxUniqueIndexes,
+                   uint* const maxUniqueSides );
+
+/*
+ * What the engines' speed on a Puzzle is looked up by: its numUniqueConnectors,
+ * and how many of the 16 edge ring connections share the most common connector
+ * (capped at ENGINE_MAX_RING_REPEATS). The more the ring repeats a connector, the
+ * more EdgeSolutions there are.
+*/
+typedef struct EngineFeatures {
+    uint numUniqueConnectors;
+    uint ringRepeats;
+} EngineFeatures;
+
+EngineFeatures engine_features( const Puzzle* const puzzle );
+
+/*
+ * Mean nanoseconds per solve of every engine on the Puzzles of each
+ * EngineFeatures, from engine_calibrate or a file it wrote
+*/
+typedef struct EngineCalibration {
+    uint numPuzzles[PUZZLE_MAX_CONNECTORS + 1][ENGINE_MAX_RING_REPEATS + 1];
+    double nanoseconds[PUZZLE_MAX_CONNECTORS + 1][ENGINE_MAX_RING_REPEATS + 1][ENGINE_COUNT];
+} EngineCalibration;
+
+/*
+ * Time every engine on the same numPuzzles Puzzles from puzzle_shuffle (seed 0)
+ * for each numUniqueConnectors in [minConnectors, maxConnectors], filling in
+ * calibration and printing the fastest engine for each EngineFeatures seen. Any
+ * engine whose numOtherSolutions disagrees with the default is reported.
+ *
+ * Every engine solves every Puzzle, twophase lists every EdgeSolution, so keep
+ * minConnectors away from the few connector Puzzles with millions of them.
+*/
+void engine_calibrate( EngineCalibration* const calibration, const uint numPuzzles,
+                       const uint minConnectors, const uint maxConnectors );
+
+//exits if path can't be written
+void engineCalibration_write( const EngineCalibration* const calibration,
+                              const char* const path );
+
+/*
+ * Read what engineCalibration_write wrote, returns false if path can't be read.
+ * Engines the file doesn't have a column for are never picked.
+*/
+bool engineCalibration_read( EngineCalibration* const calibration, const char* const path );
+
+/*
+ * The engine calibration timed fastest on Puzzles like puzzle: same
+ * numUniqueConnectors, and the closest ring repeats with at least
+ * ENGINE_MIN_CALIBRATION_PUZZLES Puzzles. ENGINE_DEFAULT when that isn't
+ * ENGINE_MIN_SPEEDUP faster, or calibration is NULL or has too little at that
+ * numUniqueConnectors.
+*/
+const SolveEngine* engine_choose( const EngineCalibration* const calibration,
+                                  const Puzzle* const puzzle );
+
+#endif
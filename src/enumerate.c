@@ -0,0 +1,456 @@
+#include "enumerate.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "puzzle.h"
+
+#define MAX_UNIQUE_CONNECTORS 20
+//indexes each worker takes at a time
+#define CHUNK_SIZE 1024
+#ifdef SIGNED_CONNECTORS
+//a value's first use is an outie, every later use can be either
+#define NUM_REUSE_SIGNS 2
+#else
+#define NUM_REUSE_SIGNS 1
+#endif
+
+//numCompletions[r][m][s]: ways to fill the last r connections when m values have
+//been used so far and s of them have only been used once
+static EnumIndex numCompletions[41][MAX_UNIQUE_CONNECTORS + 1][MAX_UNIQUE_CONNECTORS + 1];
+static uint tableConnectors = 0;
+//numCompletions[40][0][0] doesn't fit in an EnumIndex, only possible with signs
+static bool tableOverflowed = false;
+
+//slotMaps[t][i]: where connection i ends up after symmetry t (0 is the identity)
+static uint slotMaps[8][40];
+static bool slotMapsBuilt = false;
+
+static void enumIndexToString( EnumIndex index, char string[41] ) {
+    char reversed[41];
+    uint length = 0;
+    do {
+        reversed[length++] = '0' + ( uint ) ( index % 10 );
+        index /= 10;
+    } while ( index );
+    for ( uint i = 0; i < length; ++i ) {
+        string[i] = reversed[length - 1 - i];
+    }
+    string[length] = '\0';
+}
+
+static EnumIndex enumIndexFromString( const char* string ) {
+    EnumIndex index = 0;
+    for ( ; *string >= '0' && *string <= '9'; ++string ) {
+        index = index * 10 + ( *string - '0' );
+    }
+    return index;
+}
+
+static void buildCompletionTable( const uint numUniqueConnectors ) {
+    if ( tableConnectors == numUniqueConnectors ) {
+        return;
+    }
+    //entries no assignment reaches can wrap around, they are never used. The
+    //approximate counts only tell whether the total itself fits
+    static long double approximate[41][MAX_UNIQUE_CONNECTORS + 1][MAX_UNIQUE_CONNECTORS + 1];
+    memset( numCompletions, 0, sizeof( numCompletions ) );
+    memset( approximate, 0, sizeof( approximate ) );
+    numCompletions[0][numUniqueConnectors][0] = 1;
+    approximate[0][numUniqueConnectors][0] = 1;
+    for ( uint r = 1; r <= 40; ++r ) {
+        for ( uint m = 0; m <= numUniqueConnectors; ++m ) {
+            for ( uint s = 0; s <= m; ++s ) {
+                EnumIndex total = ( m - s ) * NUM_REUSE_SIGNS * numCompletions[r - 1][m][s];
+                long double approximateTotal = ( m - s ) * NUM_REUSE_SIGNS *
+                                               approximate[r - 1][m][s];
+                if ( s > 0 ) {
+                    total += s * NUM_REUSE_SIGNS * numCompletions[r - 1][m][s - 1];
+                    approximateTotal += s * NUM_REUSE_SIGNS * approximate[r - 1][m][s - 1];
+                }
+                if ( m < numUniqueConnectors ) {
+                    total += numCompletions[r - 1][m + 1][s + 1];
+                    approximateTotal += approximate[r - 1][m + 1][s + 1];
+                }
+                numCompletions[r][m][s] = total;
+                approximate[r][m][s] = approximateTotal;
+            }
+        }
+    }
+    //an EnumIndex holds up to 2^128 - 1, the total is exact well below that
+    tableOverflowed = approximate[40][0][0] >= 0x1p127L * 2;
+    tableConnectors = numUniqueConnectors;
+}
+
+static uint slotFromCells( const int row1, const int col1, const int row2, const int col2 ) {
+    if ( row1 == row2 ) {
+        const int col = col1 < col2 ? col1 : col2;
+        return col * 5 + row1;
+    }
+    const int row = row1 < row2 ? row1 : row2;
+    return 20 + row * 5 + col1;
+}
+
+static void transformCell( const uint symmetry, int* const row, int* const col ) {
+    if ( symmetry >= 4 ) {
+        *col = 4 - *col;
+    }
+    for ( uint i = 0; i < symmetry % 4; ++i ) {
+        const int temp = *row;
+        *row = *col;
+        *col = 4 - temp;
+    }
+}
+
+//whether symmetry t puts the second Piece of connection i first, which turns an outie
+//into an innie
+static bool slotFlips[8][40];
+
+static void buildSlotMaps() {
+    if ( slotMapsBuilt ) {
+        return;
+    }
+    for ( uint t = 0; t < 8; ++t ) {
+        for ( uint i = 0; i < 40; ++i ) {
+            int row1, col1, row2, col2;
+            if ( i < 20 ) {
+                row1 = row2 = i % 5;
+                col1 = i / 5;
+                col2 = col1 + 1;
+            } else {
+                row1 = ( i - 20 ) / 5;
+                row2 = row1 + 1;
+                col1 = col2 = ( i - 20 ) % 5;
+            }
+            transformCell( t, &row1, &col1 );
+            transformCell( t, &row2, &col2 );
+            slotMaps[t][i] = slotFromCells( row1, col1, row2, col2 );
+            slotFlips[t][i] = row1 > row2 || col1 > col2;
+        }
+    }
+    slotMapsBuilt = true;
+}
+
+EnumIndex enumerate_numAssignments( const uint numUniqueConnectors ) {
+    if ( numUniqueConnectors == 0 || numUniqueConnectors > MAX_UNIQUE_CONNECTORS ) {
+        return 0;
+    }
+    buildCompletionTable( numUniqueConnectors );
+    return tableOverflowed ? 0 : numCompletions[40][0][0];
+}
+
+void enumerate_assignmentAt( const uint numUniqueConnectors, EnumIndex index,
+                             char connections[40] ) {
+    buildCompletionTable( numUniqueConnectors );
+    uint timesUsed[MAX_UNIQUE_CONNECTORS] = { 0 };
+    uint numUsed = 0;
+    uint numSingles = 0;
+    for ( uint i = 0; i < 40; ++i ) {
+        const uint remaining = 39 - i;
+        uint value = 0;
+        uint nextUsed = numUsed;
+        uint nextSingles = numSingles;
+        int sign = 1;
+        for ( ; value <= numUsed && value < numUniqueConnectors; ++value ) {
+            nextUsed = numUsed;
+            nextSingles = numSingles;
+            if ( value == numUsed ) {
+                ++nextUsed;
+                ++nextSingles;
+            } else if ( timesUsed[value] == 1 ) {
+                --nextSingles;
+            }
+            const EnumIndex count = numCompletions[remaining][nextUsed][nextSingles];
+            if ( index < count ) {
+                break;
+            }
+            index -= count;
+            //the same value again as an innie
+            if ( NUM_REUSE_SIGNS == 2 && value < numUsed ) {
+                if ( index < count ) {
+                    sign = -1;
+                    break;
+                }
+                index -= count;
+            }
+        }
+        connections[i] = sign * ( int ) ( value + 1 );
+        ++timesUsed[value];
+        numUsed = nextUsed;
+        numSingles = nextSingles;
+    }
+}
+
+bool enumerate_isCanonical( const char connections[40], uint* const orbitSize ) {
+    buildSlotMaps();
+    uint stabilizerSize = 1;
+    for ( uint t = 1; t < 8; ++t ) {
+        char transformed[40];
+        for ( uint i = 0; i < 40; ++i ) {
+            transformed[slotMaps[t][i]] = slotFlips[t][i] ? piece_complement( connections[i] ) :
+                                                             connections[i];
+        }
+        //relabel[abs( value )] is the label with the sign that makes the first use an outie,
+        //turning every use of a connector the other way round gives the same Puzzle
+        char relabel[MAX_UNIQUE_CONNECTORS + 1] = { 0 };
+        char nextLabel = 1;
+        for ( uint i = 0; i < 40; ++i ) {
+            const int value = transformed[i];
+            const int connector = abs( value );
+            if ( !relabel[connector] ) {
+                relabel[connector] = value < 0 ? -nextLabel : nextLabel;
+                ++nextLabel;
+            }
+            transformed[i] = value < 0 ? -relabel[connector] : relabel[connector];
+        }
+        const int comparison = memcmp( transformed, connections, sizeof( char ) * 40 );
+        if ( comparison < 0 ) {
+            return false;
+        }
+        if ( comparison == 0 ) {
+            ++stabilizerSize;
+        }
+    }
+    *orbitSize = 8 / stabilizerSize;
+    return true;
+}
+
+typedef struct ChunkResult {
+    bool done;
+    uint64_t numCanonical;
+    uint64_t numOneOther;
+    uint64_t numOneOtherWeighted;
+} ChunkResult;
+
+typedef struct ShardState {
+    uint numUniqueConnectors;
+    uint shardIndex;
+    uint numShards;
+    const char* progressFile;
+
+    EnumIndex start; //first index of the shard not covered by the progress file
+    EnumIndex end;
+    EnumIndex numChunks;
+    EnumIndex nextChunk; //next chunk to hand to a worker
+    EnumIndex doneChunks; //chunks [0, doneChunks) are finished and counted
+
+    //results of chunks that finished ahead of doneChunks, by chunk % windowSize
+    ChunkResult* window;
+    uint windowSize;
+
+    uint64_t numAssignments;
+    uint64_t numCanonical;
+    uint64_t numOneOther;
+    uint64_t numOneOtherWeighted;
+    time_t lastWrite;
+
+    pthread_mutex_t lock;
+    pthread_cond_t windowMoved;
+} ShardState;
+
+static void shard_writeProgress( const ShardState* const shard ) {
+    EnumIndex next = shard->start + shard->doneChunks * CHUNK_SIZE;
+    if ( next > shard->end ) {
+        next = shard->end;
+    }
+    char nextString[41];
+    char endString[41];
+    enumIndexToString( next, nextString );
+    enumIndexToString( shard->end, endString );
+
+    char tempFile[strlen( shard->progressFile ) + 5];
+    sprintf( tempFile, "%s.tmp", shard->progressFile );
+    FILE* file = fopen( tempFile, "w" );
+    if ( !file ) {
+        fprintf( stderr, "Could not write progress file %s\n", tempFile );
+        return;
+    }
+    fprintf( file, "numUniqueConnectors %u\n", shard->numUniqueConnectors );
+    fprintf( file, "shard %u %u\n", shard->shardIndex, shard->numShards );
+    fprintf( file, "next %s\n", nextString );
+    fprintf( file, "end %s\n", endString );
+    fprintf( file, "assignments %" PRIu64 "\n", shard->numAssignments );
+    fprintf( file, "canonical %" PRIu64 "\n", shard->numCanonical );
+    fprintf( file, "oneOtherSolution %" PRIu64 "\n", shard->numOneOther );
+    fprintf( file, "oneOtherSolutionWeighted %" PRIu64 "\n", shard->numOneOtherWeighted );
+    fclose( file );
+    rename( tempFile, shard->progressFile );
+}
+
+//returns false if there is no usable progress file for this shard
+static bool shard_readProgress( ShardState* const shard ) {
+    FILE* file = fopen( shard->progressFile, "r" );
+    if ( !file ) {
+        return false;
+    }
+    uint numUniqueConnectors = 0;
+    uint shardIndex = 0;
+    uint numShards = 0;
+    char nextString[41] = { 0 };
+    char endString[41] = { 0 };
+    uint64_t numAssignments, numCanonical, numOneOther, numOneOtherWeighted;
+    const int numRead = fscanf( file, "numUniqueConnectors %u\nshard %u %u\nnext %40s\nend %40s\n"
+                                "assignments %" SCNu64 "\ncanonical %" SCNu64 "\n"
+                                "oneOtherSolution %" SCNu64 "\noneOtherSolutionWeighted %" SCNu64,
+                                &numUniqueConnectors, &shardIndex, &numShards, nextString,
+                                endString, &numAssignments, &numCanonical, &numOneOther,
+                                &numOneOtherWeighted );
+    fclose( file );
+    if ( numRead != 9 || numUniqueConnectors != shard->numUniqueConnectors ||
+         shardIndex != shard->shardIndex || numShards != shard->numShards ||
+         enumIndexFromString( endString ) != shard->end ) {
+        fprintf( stderr, "Progress file %s is for a different shard, starting over\n",
+                 shard->progressFile );
+        return false;
+    }
+    shard->start = enumIndexFromString( nextString );
+    shard->numAssignments = numAssignments;
+    shard->numCanonical = numCanonical;
+    shard->numOneOther = numOneOther;
+    shard->numOneOtherWeighted = numOneOtherWeighted;
+    return true;
+}
+
+static ChunkResult shard_evaluateChunk( const ShardState* const shard, const EnumIndex chunk ) {
+    ChunkResult result = { .done = true };
+    const EnumIndex chunkStart = shard->start + chunk * CHUNK_SIZE;
+    const EnumIndex chunkEnd = chunkStart + CHUNK_SIZE < shard->end ? chunkStart + CHUNK_SIZE : shard->end;
+    const uint maxOtherSolutions = 100;
+    PuzzleSolution solutions[maxOtherSolutions];
+    for ( EnumIndex i = chunkStart; i < chunkEnd; ++i ) {
+        char connections[40];
+        uint orbitSize;
+        enumerate_assignmentAt( shard->numUniqueConnectors, i, connections );
+        if ( !enumerate_isCanonical( connections, &orbitSize ) ) {
+            continue;
+        }
+        ++result.numCanonical;
+
+        Puzzle puzzle;
+        puzzle_initFromConnections( &puzzle, connections, shard->numUniqueConnectors );
+        uint numOtherSolutions = 0;
+        uint maxUniqueIndexes;
+        uint maxUniqueSides;
+        puzzle_findValidSolutions( &puzzle, solutions, &numOtherSolutions, maxOtherSolutions,
+                                   &maxUniqueIndexes, &maxUniqueSides );
+        if ( numOtherSolutions == 1 ) {
+            ++result.numOneOther;
+            result.numOneOtherWeighted += orbitSize;
+        }
+    }
+    return result;
+}
+
+static void* shard_worker( void* arg ) {
+    ShardState* const shard = arg;
+    pthread_mutex_lock( &shard->lock );
+    while ( true ) {
+        while ( shard->nextChunk < shard->numChunks &&
+                shard->nextChunk >= shard->doneChunks + shard->windowSize ) {
+            pthread_cond_wait( &shard->windowMoved, &shard->lock );
+        }
+        if ( shard->nextChunk >= shard->numChunks ) {
+            break;
+        }
+        const EnumIndex chunk = shard->nextChunk++;
+        pthread_mutex_unlock( &shard->lock );
+
+        const ChunkResult result = shard_evaluateChunk( shard, chunk );
+
+        pthread_mutex_lock( &shard->lock );
+        shard->window[chunk % shard->windowSize] = result;
+        bool moved = false;
+        while ( shard->doneChunks < shard->numChunks &&
+                shard->window[shard->doneChunks % shard->windowSize].done ) {
+            ChunkResult* const done = &shard->window[shard->doneChunks % shard->windowSize];
+            const EnumIndex doneStart = shard->start + shard->doneChunks * CHUNK_SIZE;
+            shard->numAssignments += shard->end - doneStart < CHUNK_SIZE ? shard->end - doneStart : CHUNK_SIZE;
+            shard->numCanonical += done->numCanonical;
+            shard->numOneOther += done->numOneOther;
+            shard->numOneOtherWeighted += done->numOneOtherWeighted;
+            done->done = false;
+            ++shard->doneChunks;
+            moved = true;
+        }
+        if ( moved ) {
+            pthread_cond_broadcast( &shard->windowMoved );
+            const time_t now = time( NULL );
+            if ( now != shard->lastWrite || shard->doneChunks == shard->numChunks ) {
+                shard_writeProgress( shard );
+                shard->lastWrite = now;
+            }
+        }
+    }
+    pthread_mutex_unlock( &shard->lock );
+    return NULL;
+}
+
+void enumerate_runShard( const uint numUniqueConnectors, const uint shardIndex,
+                         const uint numShards, const uint numThreads,
+                         const char* const progressFile ) {
+    const EnumIndex total = enumerate_numAssignments( numUniqueConnectors );
+    if ( total == 0 && numUniqueConnectors > 0 && numUniqueConnectors <= MAX_UNIQUE_CONNECTORS ) {
+        fprintf( stderr, "%u unique connectors have too many signed assignments to index\n",
+                 numUniqueConnectors );
+        return;
+    }
+    if ( total == 0 || numShards == 0 || shardIndex >= numShards || numThreads == 0 ) {
+        fprintf( stderr, "Invalid shard %u/%u with %u unique connectors and %u threads\n",
+                 shardIndex, numShards, numUniqueConnectors, numThreads );
+        return;
+    }
+    buildSlotMaps();
+
+    ShardState shard = { .numUniqueConnectors = numUniqueConnectors,
+                         .shardIndex = shardIndex,
+                         .numShards = numShards,
+                         .progressFile = progressFile,
+                         .windowSize = numThreads * 4 };
+    const EnumIndex base = total / numShards;
+    const EnumIndex remainder = total % numShards;
+    shard.start = base * shardIndex + ( shardIndex < remainder ? shardIndex : remainder );
+    shard.end = shard.start + base + ( shardIndex < remainder ? 1 : 0 );
+    const EnumIndex shardStart = shard.start;
+    if ( shard_readProgress( &shard ) ) {
+        printf( "Resuming from %s\n", progressFile );
+    }
+    shard.numChunks = ( shard.end - shard.start + CHUNK_SIZE - 1 ) / CHUNK_SIZE;
+    shard.window = calloc( shard.windowSize, sizeof( ChunkResult ) );
+    if ( !shard.window ) {
+        fprintf( stderr, "Could not allocate shard window\n" );
+        exit( 1 );
+    }
+    pthread_mutex_init( &shard.lock, NULL );
+    pthread_cond_init( &shard.windowMoved, NULL );
+
+    char totalString[41];
+    char startString[41];
+    char endString[41];
+    enumIndexToString( total, totalString );
+    enumIndexToString( shardStart, startString );
+    enumIndexToString( shard.end, endString );
+    printf( "%u unique connectors: %s assignments, shard %u/%u is [%s, %s)\n",
+            numUniqueConnectors, totalString, shardIndex, numShards, startString, endString );
+
+    pthread_t threads[numThreads];
+    for ( uint i = 0; i < numThreads; ++i ) {
+        pthread_create( &threads[i], NULL, shard_worker, &shard );
+    }
+    for ( uint i = 0; i < numThreads; ++i ) {
+        pthread_join( threads[i], NULL );
+    }
+    shard_writeProgress( &shard );
+
+    printf( "Assignments: %" PRIu64 "\n", shard.numAssignments );
+    printf( "Canonical: %" PRIu64 "\n", shard.numCanonical );
+    printf( "Exactly one other solution: %" PRIu64 " (%" PRIu64 " counting symmetric copies)\n",
+            shard.numOneOther, shard.numOneOtherWeighted );
+
+    pthread_cond_destroy( &shard.windowMoved );
+    pthread_mutex_destroy( &shard.lock );
+    free( shard.window );
+}
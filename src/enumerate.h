@@ -0,0 +1,70 @@
+#ifndef ENUMERATE_H
+#define ENUMERATE_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+ * Position within the canonical enumeration order. Counts get past 64 bits as
+ * soon as there are more than a handful of unique connectors.
+*/
+typedef unsigned __int128 EnumIndex;
+
+/*
+ * Number of ways to assign numUniqueConnectors connector values to the 40
+ * connections, counting assignments that only differ by relabeling the values
+ * once, and with every value used at least twice (same rule as puzzle_shuffle)
+ *
+ * With SIGNED_CONNECTORS every connection also has a sign. Turning every use of
+ * one connector the other way round (outies to innies and back) gives the same
+ * Puzzle, so that counts as relabeling too: a value's first use is always an outie
+ * and every later use can be either. 0 when the count doesn't fit in an EnumIndex
+ * (7 to 16 signed connectors).
+ *
+ * This is the size of the index space that gets sharded. Symmetric copies
+ * (rotations/mirrors of the whole Puzzle) are still in there, they are skipped
+ * when the index is evaluated.
+*/
+EnumIndex enumerate_numAssignments( const uint numUniqueConnectors );
+
+/*
+ * Fill connections (values 1 - numUniqueConnectors, either sign with
+ * SIGNED_CONNECTORS) with the assignment at index
+ *
+ * Assignments are in lexicographic order of their restricted growth string, i.e.
+ * connection 0 is always value 1, and every value's first use comes after the
+ * first use of all smaller values. A later use as an outie comes before the same
+ * use as an innie.
+*/
+void enumerate_assignmentAt( const uint numUniqueConnectors, EnumIndex index,
+                             char connections[40] );
+
+/*
+ * Check if connections (as made by enumerate_assignmentAt) is the smallest of
+ * its orbit under the 8 rotations/mirrors of the Puzzle, after relabeling
+ *
+ * A symmetry that swaps which Piece of a connection comes first (left or top)
+ * turns that connection's sign round.
+ *
+ * If it is, orbitSize is set to how many distinct assignments the orbit has.
+*/
+bool enumerate_isCanonical( const char connections[40], uint* const orbitSize );
+
+/*
+ * Evaluate every canonical assignment in shard shardIndex of numShards, using
+ * numThreads worker threads
+ *
+ * The index space is split into numShards equal contiguous ranges, so separate
+ * processes can each take a shard. Progress is written to progressFile as the
+ * shard goes (at most once a second), and a shard that is started again with the
+ * same progressFile picks up where the file says it left off.
+ *
+ * Prints the counts when the shard is done: canonical assignments evaluated, how
+ * many of them have exactly one other solution, and that number weighted by orbit
+ * size (how many Puzzles it stands for).
+*/
+void enumerate_runShard( const uint numUniqueConnectors, const uint shardIndex,
+                         const uint numShards, const uint numThreads,
+                         const char* const progressFile );
+
+#endif
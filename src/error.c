@@ -0,0 +1,38 @@
+#include "error.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ERROR_MESSAGE_SIZE 256
+
+static __thread ErrorTarget* errorTarget = NULL;
+static __thread char lastMessage[ERROR_MESSAGE_SIZE];
+
+void error_push( ErrorTarget* const target ) {
+    target->code = ERROR_NONE;
+    target->previous = errorTarget;
+    errorTarget = target;
+}
+
+void error_pop( ErrorTarget* const target ) {
+    errorTarget = target->previous;
+}
+
+_Noreturn void error_raise( const ErrorCode code, const char* const format, ... ) {
+    va_list args;
+    va_start( args, format );
+    vsnprintf( lastMessage, sizeof( lastMessage ), format, args );
+    va_end( args );
+    ErrorTarget* const target = errorTarget;
+    if ( !target ) {
+        fprintf( stderr, "%s\n", lastMessage );
+        exit( 1 );
+    }
+    errorTarget = target->previous;
+    target->code = code;
+    longjmp( target->jump, 1 );
+}
+
+const char* error_lastMessage() {
+    return lastMessage;
+}
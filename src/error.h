@@ -0,0 +1,50 @@
+#ifndef ERROR_H
+#define ERROR_H
+
+#include <setjmp.h>
+
+typedef enum ErrorCode {
+    ERROR_NONE,
+    ERROR_OUT_OF_MEMORY,
+    ERROR_INVALID_ARGUMENT,
+    ERROR_TOO_MANY_SOLUTIONS
+} ErrorCode;
+
+/*
+ * Where error_raise unwinds to, see error_push
+*/
+typedef struct ErrorTarget {
+    jmp_buf jump;
+    ErrorCode code;
+    struct ErrorTarget* previous;
+} ErrorTarget;
+
+/*
+ * Catch errors raised on this thread until error_pop, for code that has to
+ * return an error instead of exiting (the library):
+ *
+ *     ErrorTarget target;
+ *     error_push( &target );
+ *     if ( setjmp( target.jump ) ) {
+ *         //target.code says what went wrong, target is already popped
+ *     }
+ *     ...
+ *     error_pop( &target );
+ *
+ * Targets nest. Whatever was being built when the error was raised is left as it
+ * was, nothing in between gets to clean up.
+*/
+void error_push( ErrorTarget* const target );
+void error_pop( ErrorTarget* const target );
+
+/*
+ * Give up on what this thread is doing: unwind to its innermost target, or with
+ * none, print the message and exit(1)
+*/
+_Noreturn void error_raise( const ErrorCode code, const char* const format, ... )
+    __attribute__(( format( printf, 2, 3 ) ));
+
+//the message of the last error raised on this thread
+const char* error_lastMessage();
+
+#endif
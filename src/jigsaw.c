@@ -0,0 +1,134 @@
+#include "jigsaw.h"
+#include <string.h>
+#include "error.h"
+#include "memory.h"
+#include "puzzle.h"
+
+//the solve stops at the second other solution, the rest is room to spare
+#define JIGSAW_MAX_OTHER_SOLUTIONS 8
+
+struct JigsawSolver {
+    Allocator allocator; //allocate NULL for malloc
+    SolveWorkspace workspace;
+};
+
+static JigsawStatus jigsaw_status( const ErrorCode code ) {
+    switch ( code ) {
+        case ERROR_NONE:
+            return JIGSAW_OK;
+        case ERROR_OUT_OF_MEMORY:
+            return JIGSAW_OUT_OF_MEMORY;
+        case ERROR_TOO_MANY_SOLUTIONS:
+            return JIGSAW_TOO_MANY_SOLUTIONS;
+        case ERROR_INVALID_ARGUMENT:
+        default:
+            return JIGSAW_INVALID_ARGUMENT;
+    }
+}
+
+static const Allocator* jigsaw_allocator( const JigsawSolver* const solver ) {
+    return solver->allocator.allocate ? &solver->allocator : NULL;
+}
+
+//allocate or free the JigsawSolver itself with its own allocator
+static void* jigsaw_reallocateSolver( const Allocator* const allocator, void* const solver,
+                                      const size_t oldSize, const size_t newSize ) {
+    const Allocator* const previous = memory_use( allocator );
+    void* const result = memory_reallocate( solver, oldSize, newSize );
+    memory_use( previous );
+    return result;
+}
+
+JigsawStatus jigsaw_createSolver( const JigsawAllocator* const allocator,
+                                  JigsawSolver** const solver ) {
+    if ( !solver || ( allocator && !allocator->allocate ) ) {
+        return JIGSAW_INVALID_ARGUMENT;
+    }
+    *solver = NULL;
+    const Allocator own = { .allocate = allocator ? allocator->allocate : NULL,
+                            .context = allocator ? allocator->context : NULL };
+    JigsawSolver* const created = jigsaw_reallocateSolver( own.allocate ? &own : NULL, NULL,
+                                                           0, sizeof( JigsawSolver ) );
+    if ( !created ) {
+        return JIGSAW_OUT_OF_MEMORY;
+    }
+    created->allocator = own;
+
+    const Allocator* const previous = memory_use( jigsaw_allocator( created ) );
+    ErrorTarget target;
+    error_push( &target );
+    if ( setjmp( target.jump ) ) {
+        memory_use( previous );
+        //whatever init didn't get to is still empty, which frees as nothing
+        solveWorkspace_free( &created->workspace );
+        jigsaw_reallocateSolver( jigsaw_allocator( created ), created,
+                                 sizeof( JigsawSolver ), 0 );
+        return jigsaw_status( target.code );
+    }
+    solveWorkspace_init( &created->workspace, jigsaw_allocator( created ) );
+    error_pop( &target );
+    memory_use( previous );
+    *solver = created;
+    return JIGSAW_OK;
+}
+
+JigsawStatus jigsaw_solve( JigsawSolver* const solver, const signed char connections[40],
+                           const unsigned int numUniqueConnectors, const uint64_t maxNodes,
+                           const uint64_t maxNanoseconds, JigsawResult* const result ) {
+    if ( !solver || !connections || !result ||
+         !puzzle_connectionsValid( ( const char* ) connections, numUniqueConnectors ) ) {
+        return JIGSAW_INVALID_ARGUMENT;
+    }
+    Puzzle puzzle;
+    puzzle_initFromConnections( &puzzle, ( const char* ) connections, numUniqueConnectors );
+    const SolveBudget budget = { .maxNodes = maxNodes, .maxNanoseconds = maxNanoseconds };
+    PuzzleSolution otherSolutions[JIGSAW_MAX_OTHER_SOLUTIONS];
+    uint numOtherSolutions = 0;
+    uint maxUniqueIndexes = 0;
+    uint maxUniqueSides = 0;
+    SolveVerdict verdict = SOLVE_COMPLETE;
+    //without limits the meter is left out altogether
+    const ErrorCode code = puzzle_solveInWorkspace( &solver->workspace, &puzzle,
+                                                    maxNodes || maxNanoseconds ? &budget : NULL,
+                                                    NULL, &verdict, otherSolutions,
+                                                    &numOtherSolutions,
+                                                    JIGSAW_MAX_OTHER_SOLUTIONS,
+                                                    &maxUniqueIndexes, &maxUniqueSides );
+
+    memset( result, 0, sizeof( *result ) );
+    result->numOtherSolutions = numOtherSolutions < 2 ? numOtherSolutions : 2;
+    result->uniqueIndexes = maxUniqueIndexes;
+    result->uniqueSides = maxUniqueSides;
+    if ( numOtherSolutions ) {
+        memcpy( result->otherSolution.indexes, otherSolutions[0].indexes, 25 );
+        memcpy( result->otherSolution.rotations, otherSolutions[0].rotations, 25 );
+    }
+    if ( code != ERROR_NONE ) {
+        return jigsaw_status( code );
+    }
+    return verdict == SOLVE_UNKNOWN ? JIGSAW_OUT_OF_BUDGET : JIGSAW_OK;
+}
+
+void jigsaw_freeSolver( JigsawSolver* const solver ) {
+    if ( !solver ) {
+        return;
+    }
+    solveWorkspace_free( &solver->workspace );
+    jigsaw_reallocateSolver( jigsaw_allocator( solver ), solver, sizeof( JigsawSolver ), 0 );
+}
+
+const char* jigsaw_statusString( const JigsawStatus status ) {
+    switch ( status ) {
+        case JIGSAW_OK:
+            return "ok";
+        case JIGSAW_OUT_OF_MEMORY:
+            return "out of memory";
+        case JIGSAW_INVALID_ARGUMENT:
+            return "invalid argument";
+        case JIGSAW_TOO_MANY_SOLUTIONS:
+            return "too many other solutions";
+        case JIGSAW_OUT_OF_BUDGET:
+            return "solve ran out of its node or time budget";
+    }
+    return "unknown status";
+}
@@ -0,0 +1,108 @@
+#ifndef JIGSAW_H
+#define JIGSAW_H
+
+/*
+ * libjigsaw, the solver built as a library (make lib): build/lib/libjigsaw.a and
+ * build/lib/libjigsaw.so
+ *
+ * This header is the whole interface and includes nothing from the rest of src,
+ * so it can be copied out on its own. Nothing in the library exits or prints,
+ * every failure comes back as a JigsawStatus.
+ *
+ * Thread safety: every function says what it can run alongside. The short of it
+ * is one solver per thread; separate solvers can be used at the same time from
+ * separate threads.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined( __GNUC__ )
+#define JIGSAW_API __attribute__(( visibility( "default" ) ))
+#else
+#define JIGSAW_API
+#endif
+
+typedef enum JigsawStatus {
+    JIGSAW_OK = 0,
+    JIGSAW_OUT_OF_MEMORY,
+    JIGSAW_INVALID_ARGUMENT,
+    JIGSAW_TOO_MANY_SOLUTIONS,
+    JIGSAW_OUT_OF_BUDGET //the solve gave up, the result is only what was found by then
+} JigsawStatus;
+
+/*
+ * Every allocation the solver makes, like realloc: newSize 0 frees pointer (and
+ * returns NULL), pointer NULL allocates. oldSize is what pointer was allocated
+ * with, 0 for NULL. Return NULL when it can't allocate, the call fails with
+ * JIGSAW_OUT_OF_MEMORY.
+ *
+ * Only called from the thread using the solver at the time, but different solvers
+ * sharing one allocate function call it from their own threads.
+*/
+typedef struct JigsawAllocator {
+    void* ( *allocate )( void* context, void* pointer, size_t oldSize, size_t newSize );
+    void* context;
+} JigsawAllocator;
+
+typedef struct JigsawSolver JigsawSolver;
+
+/*
+ * A layout of the 25 pieces, left to right top to bottom: which original piece
+ * (numbered the same way) is in each cell, and its rotation in quarter turns
+ * counter-clockwise, [0, 3]
+*/
+typedef struct JigsawLayout {
+    signed char indexes[25];
+    signed char rotations[25];
+} JigsawLayout;
+
+typedef struct JigsawResult {
+    //layouts other than the original that every piece fits in: 0, 1, or 2 for
+    //two or more (the solve stops at the second)
+    unsigned int numOtherSolutions;
+    //the most of the 40 connections, over the other solutions found, that join
+    //pieces that weren't joined originally / that join them on different sides
+    unsigned int uniqueIndexes;
+    unsigned int uniqueSides;
+    //the first other solution found, all 0 with none
+    JigsawLayout otherSolution;
+} JigsawResult;
+
+/*
+ * Make a solver that allocates with allocator (copied, NULL for malloc). Its
+ * buffers are allocated up front and reused by every solve.
+ *
+ * Thread safe.
+*/
+JIGSAW_API JigsawStatus jigsaw_createSolver( const JigsawAllocator* allocator,
+                                             JigsawSolver** solver );
+
+/*
+ * Find the other solutions of the 5x5 puzzle with connections: [0, 19] the
+ * vertical connections top to bottom, [20, 39] the horizontal ones left to right.
+ * Each is a connector in [1, numUniqueConnectors] (numUniqueConnectors at most 31),
+ * negative for an innie in a signed build.
+ *
+ * maxNodes and maxNanoseconds limit the solve, 0 for no limit. A node is one
+ * candidate piece tried, about 10 ns. Running out is JIGSAW_OUT_OF_BUDGET.
+ *
+ * Not thread safe for one solver, only one thread can be using it at a time.
+*/
+JIGSAW_API JigsawStatus jigsaw_solve( JigsawSolver* solver, const signed char connections[40],
+                                      unsigned int numUniqueConnectors, uint64_t maxNodes,
+                                      uint64_t maxNanoseconds, JigsawResult* result );
+
+/*
+ * Free solver and everything it allocated, NULL does nothing.
+ *
+ * Not thread safe for one solver, nothing else can be using it.
+*/
+JIGSAW_API void jigsaw_freeSolver( JigsawSolver* solver );
+
+/*
+ * What status means, a static string. Thread safe.
+*/
+JIGSAW_API const char* jigsaw_statusString( JigsawStatus status );
+
+#endif
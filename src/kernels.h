@@ -0,0 +1,53 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdlib.h>
+#include "puzzle.h"
+
+/*
+ * Entry points into the solver's hot inner functions, which are static in
+ * puzzle.c. Only here so microbench.c can time each one on its own, nothing
+ * else should call these.
+*/
+
+//edge triples that fit between any two corners, nested loop version
+void kernel_calculateValidEdges( const Puzzle* const puzzle, TripleIndexVec* const validEdges );
+
+//same result as kernel_calculateValidEdges, explicit stack version
+void kernel_calculateValidEdgesStack( const Puzzle* const puzzle,
+                                      TripleIndexVec* const validEdges );
+
+/*
+ * Every EdgeSolution out of the triples already in edgeSet, for all 6 corner
+ * arrangements, replacing edgeSet's solutions
+*/
+void kernel_recEdgeSolve( const Puzzle* const puzzle, EdgeSet* const edgeSet );
+
+//center rows (with rotations) that fit between the left and right edges
+void kernel_calculateValidCenterRows( const Puzzle* const puzzle,
+                                      const EdgeSolution* const edgeSolution,
+                                      TripleIndexVec* const validCenterRows );
+
+/*
+ * Stack 3 of centerRows into centers that fit edgeSolution, adding up to
+ * maxCenterSolutions of them to centerSolutions
+*/
+void kernel_recCenterSolve( const Puzzle* const puzzle, const EdgeSolution* const edgeSolution,
+                            const TripleIndexVec* const centerRows,
+                            PackedCenterSolutionVec* const centerSolutions,
+                            const size_t maxCenterSolutions );
+
+//how many centers 3 of centerRows make that fit edgeSolution, without listing them
+uint64_t kernel_countCenters( const Puzzle* const puzzle, const EdgeSolution* const edgeSolution,
+                              const TripleIndexVec* const centerRows );
+
+//how many of the 40 original connections solution keeps, by index and by side
+void kernel_calculateOriginalConnections( const Puzzle* const puzzle,
+                                          const PuzzleSolution* const solution,
+                                          uint* const numIndexConnections,
+                                          uint* const numSideConnections );
+
+//rebuild the Pieces from puzzle->connections
+void kernel_setPieces2( Puzzle* const puzzle );
+
+#endif
@@ -2,17 +2,186 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include "anneal.h"
 #include "benchmark.h"
+#include "bandit.h"
+#include "cluster.h"
+#include "daemon.h"
+#include "edgecache.h"
+#include "engine.h"
+#include "enumerate.h"
+#include "microbench.h"
 #include "puzzle.h"
 #include "pieces.h"
+#include "results.h"
+#include "telemetry.h"
+
+//how many of the best Puzzles the GA and anneal print at the end
+#define HALL_OF_FAME_SIZE 10
+//how often a telemetry line is written
+#define TELEMETRY_INTERVAL_MS 1000
+//edge rings the GA and anneal keep the EdgeSolutions of with edgecache, and the most they keep of one
+#define EDGE_RING_CACHE_SIZE 4096
+#define EDGE_RING_CACHE_MAX_SOLUTIONS 4096
 
 int main( int argc, char *argv[] ) {
-    /*
-    for ( uint i = 1; i <= 20; ++i ) {
-        generateSwappablePuzzle( i );
+    //temp enumerate <numUniqueConnectors> <shardIndex> <numShards> <numThreads> <progressFile>
+    if ( argc == 7 && strcmp( argv[1], "enumerate" ) == 0 ) {
+        enumerate_runShard( strtoul( argv[2], NULL, 10 ), strtoul( argv[3], NULL, 10 ),
+                            strtoul( argv[4], NULL, 10 ), strtoul( argv[5], NULL, 10 ),
+                            argv[6] );
+        return 0;
+    }
+    //temp hitrate <numPuzzles> <numUniqueConnectors>
+    if ( argc == 4 && strcmp( argv[1], "hitrate" ) == 0 ) {
+        benchmark_generatorHitRate( strtoul( argv[2], NULL, 10 ), strtoul( argv[3], NULL, 10 ) );
+        return 0;
+    }
+
+    //temp parallelsolve <numPuzzles> <numUniqueConnectors> <numWorkers>
+    if ( argc == 5 && strcmp( argv[1], "parallelsolve" ) == 0 ) {
+        benchmark_parallelSolve( strtoul( argv[2], NULL, 10 ), strtoul( argv[3], NULL, 10 ),
+                                 strtoul( argv[4], NULL, 10 ) );
+        return 0;
+    }
+
+    //temp crossoverbench <numRuns> <secondsPerRun> <rate> [<rate> ...]
+    if ( argc >= 5 && strcmp( argv[1], "crossoverbench" ) == 0 ) {
+        double rates[argc - 4];
+        for ( int i = 4; i < argc; ++i ) {
+            rates[i - 4] = strtod( argv[i], NULL );
+        }
+        benchmark_crossover( strtoul( argv[2], NULL, 10 ), strtod( argv[3], NULL ), rates,
+                             argc - 4 );
+        return 0;
+    }
+
+    //temp engines, the names engine and enginebench take
+    if ( argc == 2 && strcmp( argv[1], "engines" ) == 0 ) {
+        engine_printAll();
+        return 0;
+    }
+
+    //temp calibrate <numPuzzles> <minConnectors> <maxConnectors> <calibrationFile>
+    if ( argc == 6 && strcmp( argv[1], "calibrate" ) == 0 ) {
+        EngineCalibration calibration;
+        engine_calibrate( &calibration, strtoul( argv[2], NULL, 10 ),
+                          strtoul( argv[3], NULL, 10 ), strtoul( argv[4], NULL, 10 ) );
+        engineCalibration_write( &calibration, argv[5] );
+        return 0;
+    }
+
+    //temp enginebench <numPuzzles> <numUniqueConnectors> <engine|auto> [calibrationFile]
+    if ( ( argc == 5 || argc == 6 ) && strcmp( argv[1], "enginebench" ) == 0 ) {
+        benchmark_engine( strtoul( argv[2], NULL, 10 ), strtoul( argv[3], NULL, 10 ), argv[4],
+                          argc == 6 ? argv[5] : NULL );
+        return 0;
     }
-    exit( 0 );
-    
+
+    //temp uniqueedge <numRings> <numUniqueConnectors>
+    if ( argc == 4 && strcmp( argv[1], "uniqueedge" ) == 0 ) {
+        benchmark_uniqueEdge( strtoul( argv[2], NULL, 10 ), strtoul( argv[3], NULL, 10 ) );
+        return 0;
+    }
+
+    //temp results <resultLog> <text|csv>
+    if ( argc == 4 && strcmp( argv[1], "results" ) == 0 ) {
+        resultLog_print( argv[2], strcmp( argv[3], "csv" ) == 0 );
+        return 0;
+    }
+
+    //temp uniqueedges [telemetry], runs until killed
+    if ( ( argc == 2 || argc == 3 ) && strcmp( argv[1], "uniqueedges" ) == 0 ) {
+        if ( argc == 3 ) {
+            telemetry_start( argv[2], TELEMETRY_INTERVAL_MS );
+        }
+        puzzle_findSolutionsUniqueEdges();
+        return 0;
+    }
+
+    //temp anneal <numUniqueConnectors> <numChains> <numMoves> <startTemperature> <endTemperature> <geometric|linear> [resultLog [telemetry]] [edgecache],
+    //edgecache shares an EdgeRingCache between the chains
+    const bool annealEdgeCache = argc >= 9 && strcmp( argv[argc - 1], "edgecache" ) == 0;
+    const int annealArgc = annealEdgeCache ? argc - 1 : argc;
+    if ( ( annealArgc >= 8 && annealArgc <= 10 ) && strcmp( argv[1], "anneal" ) == 0 ) {
+        HallOfFame hallOfFame;
+        hallOfFame_init( &hallOfFame, HALL_OF_FAME_SIZE );
+        EdgeRingCache edgeCache;
+        if ( annealEdgeCache ) {
+            edgeRingCache_init( &edgeCache, EDGE_RING_CACHE_SIZE, EDGE_RING_CACHE_MAX_SOLUTIONS );
+        }
+        const AnnealConfig config = { .numUniqueConnectors = strtoul( argv[2], NULL, 10 ),
+                                      .numChains = strtoul( argv[3], NULL, 10 ),
+                                      .numMoves = strtoul( argv[4], NULL, 10 ),
+                                      .startTemperature = strtof( argv[5], NULL ),
+                                      .endTemperature = strtof( argv[6], NULL ),
+                                      .cooling = strcmp( argv[7], "linear" ) == 0 ?
+                                                 ANNEAL_LINEAR : ANNEAL_GEOMETRIC,
+                                      .seed = 0,
+                                      .generate = puzzle_generateSwappable,
+                                      .resultLog = annealArgc >= 9 ? resultLog_open( argv[8] ) : NULL,
+                                      .hallOfFame = &hallOfFame,
+                                      .edgeCache = annealEdgeCache ? &edgeCache : NULL };
+        if ( annealArgc == 10 ) {
+            telemetry_start( argv[9], TELEMETRY_INTERVAL_MS );
+        }
+        anneal_run( &config );
+        if ( annealArgc == 10 ) {
+            telemetry_stop();
+        }
+        resultLog_close( config.resultLog );
+        hallOfFame_print( &hallOfFame );
+        hallOfFame_free( &hallOfFame );
+        if ( annealEdgeCache ) {
+            edgeRingCache_free( &edgeCache );
+        }
+        return 0;
+    }
+
+    //temp cluster <socket> <numWorkers> <numUnits> <puzzlesPerUnit> <numUniqueConnectors> [resultLog]
+    if ( ( argc == 7 || argc == 8 ) && strcmp( argv[1], "cluster" ) == 0 ) {
+        HallOfFame hallOfFame;
+        hallOfFame_init( &hallOfFame, HALL_OF_FAME_SIZE );
+        const ClusterConfig config = { .socketPath = argv[2],
+                                       .numWorkers = strtoul( argv[3], NULL, 10 ),
+                                       .numUnits = strtoul( argv[4], NULL, 10 ),
+                                       .puzzlesPerUnit = strtoul( argv[5], NULL, 10 ),
+                                       .numUniqueConnectors = strtoul( argv[6], NULL, 10 ),
+                                       .seed = 0,
+                                       .resultLog = argc == 8 ? resultLog_open( argv[7] ) : NULL,
+                                       .hallOfFame = &hallOfFame };
+        cluster_coordinate( &config );
+        resultLog_close( config.resultLog );
+        hallOfFame_print( &hallOfFame );
+        hallOfFame_free( &hallOfFame );
+        return 0;
+    }
+
+    //temp worker <socket>
+    if ( argc == 3 && strcmp( argv[1], "worker" ) == 0 ) {
+        cluster_work( argv[2] );
+        return 0;
+    }
+
+    //temp daemon <socket> <numWorkers> <queueSize>
+    if ( argc == 5 && strcmp( argv[1], "daemon" ) == 0 ) {
+        const DaemonConfig config = { .socketPath = argv[2],
+                                      .numWorkers = strtoul( argv[3], NULL, 10 ),
+                                      .queueSize = strtoul( argv[4], NULL, 10 ) };
+        daemon_serve( &config );
+        return 0;
+    }
+
+    //temp microbench <corpusSize> <numSamples> <baselineFile> <maxSlowdownPercent> [update]
+    if ( ( argc == 6 || argc == 7 ) && strcmp( argv[1], "microbench" ) == 0 ) {
+        const bool update = argc == 7 && strcmp( argv[6], "update" ) == 0;
+        const uint numSlower = microbench_run( strtoul( argv[2], NULL, 10 ),
+                                               strtoul( argv[3], NULL, 10 ), argv[4],
+                                               strtof( argv[5], NULL ), update );
+        return numSlower ? 1 : 0;
+    }
+
+    /*
 
     benchmark_puzzleSolve( 50000, "Initial PuzzleSolve, no modifications, no debug, level 3 optimizations" );
 
@@ -20,18 +189,73 @@ int main( int argc, char *argv[] ) {
 
     */
 
+    //temp [ga <resultLog> [<maxSolveNodes> <maxSolveMicroseconds> <maxSeconds> [telemetry]] [adaptive] [edgecache]],
+    //0 is no limit, adaptive has a MutationBandit pick how children are mutated, edgecache
+    //keeps the EdgeSolutions of the edge rings unbudgeted solves see in an EdgeRingCache
+    const bool edgeCached = argc >= 4 && strcmp( argv[argc - 1], "edgecache" ) == 0;
+    const int optionArgc = edgeCached ? argc - 1 : argc;
+    const bool adaptive = optionArgc >= 4 && strcmp( argv[optionArgc - 1], "adaptive" ) == 0;
+    const int gaArgc = adaptive ? optionArgc - 1 : optionArgc;
+    const bool ga = ( gaArgc == 3 || gaArgc == 6 || gaArgc == 7 ) && strcmp( argv[1], "ga" ) == 0;
+    ResultLog* resultLog = ga ? resultLog_open( argv[2] ) : NULL;
+    const bool budgeted = ga && gaArgc >= 6;
+    const bool telemetry = ga && gaArgc == 7;
+    const SolveBudget solveBudget = { .maxNodes = budgeted ? strtoull( argv[3], NULL, 10 ) : 0,
+                                      .maxNanoseconds = budgeted ?
+                                                        strtoull( argv[4], NULL, 10 ) * 1000 : 0 };
+    const double maxSeconds = budgeted ? strtod( argv[5], NULL ) : 0;
+    HallOfFame hallOfFame;
+    hallOfFame_init( &hallOfFame, HALL_OF_FAME_SIZE );
+
     srand( 0 );
+    if ( telemetry ) {
+        telemetry_start( argv[6], TELEMETRY_INTERVAL_MS );
+    }
 
-    const uint numUniqueConnections = 10;
-    const uint generationSize = 5000;
-    const uint numGenerations = 10;
-    const uint numSurivors = 5;
-    const uint numChildren = 800;
     const uint minMutations = 1;
     const uint maxMutations = 6;
+    MutationBandit bandit;
+    if ( adaptive ) {
+        mutationBandit_init( &bandit, minMutations, maxMutations );
+    }
+    EdgeRingCache edgeCache;
+    if ( edgeCached ) {
+        edgeRingCache_init( &edgeCache, EDGE_RING_CACHE_SIZE, EDGE_RING_CACHE_MAX_SOLUTIONS );
+    }
 
-    puzzle_findMostUniqueSolution( numUniqueConnections, generationSize, numGenerations,
-                                   numSurivors, numChildren, minMutations, maxMutations );
+    const GaConfig config = { .numUniqueConnectors = 10,
+                              .generationSize = 5000,
+                              .numGenerations = 10,
+                              .numSurvivors = 5,
+                              .numChildren = 800,
+                              .minMutations = minMutations,
+                              .maxMutations = maxMutations,
+                              //best of 0, 0.2 and 0.5 in crossoverbench (mean best 38.3,
+                              //50.0 and 45.0 over 3 runs of 20 s each)
+                              .crossoverRate = 0.2,
+                              .generate = puzzle_generateSwappable,
+                              .resultLog = resultLog,
+                              .hallOfFame = &hallOfFame,
+                              .solveBudget = budgeted ? &solveBudget : NULL,
+                              .maxSeconds = maxSeconds,
+                              .bandit = adaptive ? &bandit : NULL,
+                              //off by default: a third of the GA's Puzzles find their ring
+                              //in the cache, but a miss lists every EdgeSolution instead
+                              //of stopping early, and it came out slower
+                              .edgeCache = edgeCached ? &edgeCache : NULL };
+    puzzle_findMostUniqueSolution( &config, NULL );
+    if ( telemetry ) {
+        telemetry_stop();
+    }
+    resultLog_close( resultLog );
+    if ( edgeCached ) {
+        if ( !budgeted ) {
+            edgeRingCache_printStats( &edgeCache );
+        }
+        edgeRingCache_free( &edgeCache );
+    }
+    hallOfFame_print( &hallOfFame );
+    hallOfFame_free( &hallOfFame );
 
 
     //puzzle_findSolutionsUniqueEdges();
@@ -0,0 +1,20 @@
+#include "memory.h"
+
+static __thread const Allocator* currentAllocator = NULL;
+
+const Allocator* memory_use( const Allocator* const allocator ) {
+    const Allocator* const previous = currentAllocator;
+    currentAllocator = allocator;
+    return previous;
+}
+
+void* memory_reallocate( void* const pointer, const size_t oldSize, const size_t newSize ) {
+    if ( currentAllocator ) {
+        return currentAllocator->allocate( currentAllocator->context, pointer, oldSize, newSize );
+    }
+    if ( newSize == 0 ) {
+        free( pointer );
+        return NULL;
+    }
+    return realloc( pointer, newSize );
+}
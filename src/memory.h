@@ -0,0 +1,34 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stdlib.h>
+
+/*
+ * One function for every allocation, like realloc: newSize 0 frees pointer (and
+ * returns NULL), pointer NULL allocates. oldSize is what pointer was allocated
+ * with, 0 for NULL. Returns NULL when it can't allocate.
+*/
+typedef void* ( *AllocateFunction )( void* const context, void* const pointer,
+                                     const size_t oldSize, const size_t newSize );
+
+typedef struct Allocator {
+    AllocateFunction allocate;
+    void* context;
+} Allocator;
+
+/*
+ * Make allocator the one memory_reallocate uses on this thread, NULL for
+ * realloc/free. Returns the one it replaces, to put back after.
+ *
+ * Memory has to be freed with the allocator it came from, so only switch around
+ * code that frees everything it allocates, or that works in buffers of its own.
+*/
+const Allocator* memory_use( const Allocator* const allocator );
+
+/*
+ * Resize pointer to newSize with this thread's allocator, same rules as
+ * AllocateFunction
+*/
+void* memory_reallocate( void* const pointer, const size_t oldSize, const size_t newSize );
+
+#endif
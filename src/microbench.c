@@ -0,0 +1,383 @@
+#include "microbench.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "kernels.h"
+#include "puzzle.h"
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define COUNTER_UNIT "cycles"
+static inline uint64_t readCounter() {
+    //keep earlier instructions from drifting past the read
+    _mm_lfence();
+    return __rdtsc();
+}
+#else
+#define COUNTER_UNIT "ns"
+static inline uint64_t readCounter() {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+#endif
+
+#define MAX_KERNEL_NAME 64
+
+//one Puzzle of the corpus, with everything its kernels take as input
+typedef struct CorpusPuzzle {
+    Puzzle puzzle;
+    EdgeSet edgeSet; //triples from calculateValidEdges
+    EdgeSolution edgeSolution;
+    TripleIndexVec centerRows; //for edgeSolution
+    PuzzleSolution solution; //an other solution, or the original one if there is none
+} CorpusPuzzle;
+
+typedef struct Corpus {
+    CorpusPuzzle* puzzles;
+    uint numPuzzles;
+    //outputs that don't need keeping
+    TripleIndexVec scratchTriples;
+    PackedCenterSolutionVec centerSolutions;
+} Corpus;
+
+static void corpus_init( Corpus* const corpus, const uint numPuzzles ) {
+    srand( 0 );
+    corpus->numPuzzles = numPuzzles;
+    corpus->puzzles = malloc( sizeof( CorpusPuzzle ) * numPuzzles );
+    if ( !corpus->puzzles ) {
+        fprintf( stderr, "Could not allocate microbench corpus of %u Puzzles\n", numPuzzles );
+        exit( 1 );
+    }
+    tripleVec_init( &corpus->scratchTriples, 4000 );
+    packedCenterVec_init( &corpus->centerSolutions, 16 );
+
+    const uint maxOtherSolutions = 100;
+    PuzzleSolution otherSolutions[maxOtherSolutions];
+    for ( uint i = 0; i < numPuzzles; ++i ) {
+        CorpusPuzzle* const current = &corpus->puzzles[i];
+        puzzle_init( &current->puzzle, 7 );
+
+        edgeSet_init( &current->edgeSet, 64 );
+        kernel_calculateValidEdges( &current->puzzle, &current->edgeSet.triples );
+        kernel_recEdgeSolve( &current->puzzle, &current->edgeSet );
+        //the original edges are always there, so there is at least one
+        puzzle_expandEdgeSolution( &current->edgeSet,
+                                   compactEdgeVec_at( &current->edgeSet.solutions, 0 ),
+                                   &current->edgeSolution );
+
+        tripleVec_init( &current->centerRows, 64 );
+        kernel_calculateValidCenterRows( &current->puzzle, &current->edgeSolution,
+                                         &current->centerRows );
+
+        uint numOtherSolutions = 0;
+        uint maxUniqueIndexes;
+        uint maxUniqueSides;
+        puzzle_findValidSolutions( &current->puzzle, otherSolutions, &numOtherSolutions,
+                                   maxOtherSolutions, &maxUniqueIndexes, &maxUniqueSides );
+        if ( numOtherSolutions ) {
+            current->solution = otherSolutions[0];
+        } else {
+            for ( uint j = 0; j < 25; ++j ) {
+                current->solution.indexes[j] = j;
+                current->solution.rotations[j] = 0;
+            }
+        }
+    }
+}
+
+static void corpus_free( Corpus* const corpus ) {
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        edgeSet_free( &corpus->puzzles[i].edgeSet );
+        tripleVec_free( &corpus->puzzles[i].centerRows );
+    }
+    tripleVec_free( &corpus->scratchTriples );
+    packedCenterVec_free( &corpus->centerSolutions );
+    free( corpus->puzzles );
+}
+
+/*
+ * Each kernel does one pass over the corpus, calling its kernel callsPerPuzzle times
+ * per Puzzle, and returns something computed from the results so none of the work
+ * can be optimized out
+*/
+typedef struct Kernel {
+    const char* name;
+    uint64_t ( *run )( Corpus* const corpus );
+    uint callsPerPuzzle;
+} Kernel;
+
+static uint64_t run_twoIndexesOriginallyTouched( Corpus* const corpus ) {
+    uint64_t check = 0;
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        for ( char index1 = 0; index1 < 25; ++index1 ) {
+            for ( char index2 = 0; index2 < 25; ++index2 ) {
+                check += twoIndexesOriginallyTouched( index1, index2 );
+            }
+        }
+    }
+    return check;
+}
+
+static uint64_t run_calculateValidEdges( Corpus* const corpus ) {
+    uint64_t check = 0;
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        kernel_calculateValidEdges( &corpus->puzzles[i].puzzle, &corpus->scratchTriples );
+        check += corpus->scratchTriples.numElements;
+    }
+    return check;
+}
+
+static uint64_t run_calculateValidEdgesStack( Corpus* const corpus ) {
+    uint64_t check = 0;
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        kernel_calculateValidEdgesStack( &corpus->puzzles[i].puzzle, &corpus->scratchTriples );
+        check += corpus->scratchTriples.numElements;
+    }
+    return check;
+}
+
+static uint64_t run_recEdgeSolve( Corpus* const corpus ) {
+    uint64_t check = 0;
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        CorpusPuzzle* const current = &corpus->puzzles[i];
+        kernel_recEdgeSolve( &current->puzzle, &current->edgeSet );
+        check += current->edgeSet.solutions.numElements;
+    }
+    return check;
+}
+
+static uint64_t run_calculateValidCenterRows( Corpus* const corpus ) {
+    uint64_t check = 0;
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        const CorpusPuzzle* const current = &corpus->puzzles[i];
+        kernel_calculateValidCenterRows( &current->puzzle, &current->edgeSolution,
+                                         &corpus->scratchTriples );
+        check += corpus->scratchTriples.numElements;
+    }
+    return check;
+}
+
+static uint64_t run_recCenterSolve( Corpus* const corpus ) {
+    uint64_t check = 0;
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        const CorpusPuzzle* const current = &corpus->puzzles[i];
+        packedCenterVec_clear( &corpus->centerSolutions );
+        //same cap the solver uses
+        kernel_recCenterSolve( &current->puzzle, &current->edgeSolution, &current->centerRows,
+                               &corpus->centerSolutions, 2 );
+        check += corpus->centerSolutions.numElements;
+    }
+    return check;
+}
+
+static uint64_t run_countCenters( Corpus* const corpus ) {
+    uint64_t check = 0;
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        const CorpusPuzzle* const current = &corpus->puzzles[i];
+        check += kernel_countCenters( &current->puzzle, &current->edgeSolution,
+                                      &current->centerRows );
+    }
+    return check;
+}
+
+static uint64_t run_calculateOriginalConnections( Corpus* const corpus ) {
+    uint64_t check = 0;
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        const CorpusPuzzle* const current = &corpus->puzzles[i];
+        uint numIndexConnections;
+        uint numSideConnections;
+        kernel_calculateOriginalConnections( &current->puzzle, &current->solution,
+                                             &numIndexConnections, &numSideConnections );
+        check += numIndexConnections + numSideConnections;
+    }
+    return check;
+}
+
+static uint64_t run_setPieces2( Corpus* const corpus ) {
+    uint64_t check = 0;
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        Puzzle* const puzzle = &corpus->puzzles[i].puzzle;
+        kernel_setPieces2( puzzle );
+        check += piece_getSide( puzzle->pieces[12], TOP );
+    }
+    return check;
+}
+
+//two swaps per Puzzle, the second undoes the first so the corpus stays the same
+static uint64_t run_swapConnections( Corpus* const corpus ) {
+    uint64_t check = 0;
+    for ( uint i = 0; i < corpus->numPuzzles; ++i ) {
+        Puzzle* const puzzle = &corpus->puzzles[i].puzzle;
+        const uint first = i % 40;
+        const uint second = ( i * 7 + 13 ) % 40;
+        puzzle_swapConnections( puzzle, first, second );
+        check += piece_getSide( puzzle->pieces[12], TOP );
+        puzzle_swapConnections( puzzle, first, second );
+    }
+    return check;
+}
+
+static const Kernel kernels[] = {
+    { "twoIndexesOriginallyTouched", run_twoIndexesOriginallyTouched, 625 },
+    { "puzzle_calculateValidEdges", run_calculateValidEdges, 1 },
+    { "puzzle_calculateValidEdgesStack", run_calculateValidEdgesStack, 1 },
+    { "puzzle_recEdgeSolve", run_recEdgeSolve, 1 },
+    { "puzzle_calculateValidCenterRows", run_calculateValidCenterRows, 1 },
+    { "puzzle_recCenterSolve", run_recCenterSolve, 1 },
+    { "puzzle_countCenters", run_countCenters, 1 },
+    { "puzzle_calculateOriginalConnections", run_calculateOriginalConnections, 1 },
+    { "puzzle_setPieces2", run_setPieces2, 1 },
+    { "puzzle_swapConnections", run_swapConnections, 2 },
+};
+#define NUM_KERNELS ( sizeof( kernels ) / sizeof( kernels[0] ) )
+
+//cost per call after outlier rejection
+typedef struct KernelTiming {
+    double perCall;
+    uint numKept;
+} KernelTiming;
+
+static int doubleSortAscending( const void* p1, const void* p2 ) {
+    const double value1 = *( const double* ) p1;
+    const double value2 = *( const double* ) p2;
+    return ( value1 > value2 ) - ( value1 < value2 );
+}
+
+static double sortedMedian( const double* const values, const uint numValues ) {
+    return numValues % 2 ? values[numValues / 2] :
+                           ( values[numValues / 2 - 1] + values[numValues / 2] ) / 2;
+}
+
+/*
+ * Mean of the samples within 3 scaled MADs (the standard deviation estimate for
+ * normal noise) of the median. Interrupts and migrations only ever make a sample
+ * slower, and one of those would drag a plain mean along with it.
+*/
+static KernelTiming rejectOutliers( double* const samples, const uint numSamples ) {
+    qsort( samples, numSamples, sizeof( double ), doubleSortAscending );
+    const double median = sortedMedian( samples, numSamples );
+    double deviations[numSamples];
+    for ( uint i = 0; i < numSamples; ++i ) {
+        deviations[i] = samples[i] > median ? samples[i] - median : median - samples[i];
+    }
+    qsort( deviations, numSamples, sizeof( double ), doubleSortAscending );
+    const double limit = 3 * 1.4826 * sortedMedian( deviations, numSamples );
+
+    KernelTiming timing = { 0 };
+    for ( uint i = 0; i < numSamples; ++i ) {
+        if ( samples[i] - median <= limit && median - samples[i] <= limit ) {
+            timing.perCall += samples[i];
+            ++timing.numKept;
+        }
+    }
+    timing.perCall /= timing.numKept;
+    return timing;
+}
+
+static KernelTiming timeKernel( const Kernel* const kernel, Corpus* const corpus,
+                                const uint numSamples, uint64_t* const check ) {
+    const double numCalls = ( double ) corpus->numPuzzles * kernel->callsPerPuzzle;
+    double samples[numSamples];
+    //warm up the caches and let the outputs grow to size
+    *check += kernel->run( corpus );
+    for ( uint i = 0; i < numSamples; ++i ) {
+        const uint64_t start = readCounter();
+        *check += kernel->run( corpus );
+        samples[i] = ( readCounter() - start ) / numCalls;
+    }
+    return rejectOutliers( samples, numSamples );
+}
+
+//returns how many kernels were read, baseline[i] is < 0 for kernels not in the file
+static uint readBaseline( const char* const baselineFile, double baseline[NUM_KERNELS] ) {
+    for ( uint i = 0; i < NUM_KERNELS; ++i ) {
+        baseline[i] = -1;
+    }
+    FILE* file = fopen( baselineFile, "r" );
+    if ( !file ) {
+        return 0;
+    }
+    uint numRead = 0;
+    char line[256];
+    while ( fgets( line, sizeof( line ), file ) ) {
+        char name[MAX_KERNEL_NAME];
+        double perCall;
+        if ( line[0] == '#' || sscanf( line, "%63s %lf", name, &perCall ) != 2 ) {
+            continue;
+        }
+        for ( uint i = 0; i < NUM_KERNELS; ++i ) {
+            if ( strcmp( name, kernels[i].name ) == 0 ) {
+                baseline[i] = perCall;
+                ++numRead;
+                break;
+            }
+        }
+    }
+    fclose( file );
+    return numRead;
+}
+
+static void writeBaseline( const char* const baselineFile, const uint corpusSize,
+                           const KernelTiming timings[NUM_KERNELS] ) {
+    FILE* file = fopen( baselineFile, "w" );
+    if ( !file ) {
+        fprintf( stderr, "Could not write baseline file %s\n", baselineFile );
+        exit( 1 );
+    }
+    fprintf( file, "# " COUNTER_UNIT " per call, corpus of %u Puzzles\n", corpusSize );
+    for ( uint i = 0; i < NUM_KERNELS; ++i ) {
+        fprintf( file, "%s %.3f\n", kernels[i].name, timings[i].perCall );
+    }
+    fclose( file );
+}
+
+uint microbench_run( const uint corpusSize, const uint numSamples,
+                     const char* const baselineFile, const float maxSlowdownPercent,
+                     const bool updateBaseline ) {
+    if ( corpusSize == 0 || numSamples == 0 ) {
+        fprintf( stderr, "Invalid microbench settings: %u Puzzles, %u samples\n", corpusSize,
+                 numSamples );
+        exit( 1 );
+    }
+    Corpus corpus;
+    corpus_init( &corpus, corpusSize );
+
+    double baseline[NUM_KERNELS];
+    const bool haveBaseline = !updateBaseline && readBaseline( baselineFile, baseline ) > 0;
+
+    printf( "--------Microbenchmarks, %u Puzzles, %u samples, " COUNTER_UNIT " per call--------\n",
+            corpusSize, numSamples );
+    KernelTiming timings[NUM_KERNELS];
+    uint64_t check = 0;
+    uint numSlower = 0;
+    for ( uint i = 0; i < NUM_KERNELS; ++i ) {
+        timings[i] = timeKernel( &kernels[i], &corpus, numSamples, &check );
+        printf( "%-36s %12.1f (%u/%u samples kept)", kernels[i].name, timings[i].perCall,
+                timings[i].numKept, numSamples );
+        if ( haveBaseline && baseline[i] > 0 ) {
+            const double change = ( timings[i].perCall / baseline[i] - 1 ) * 100;
+            printf( "  baseline %.1f, %+.1f%%", baseline[i], change );
+            if ( change > maxSlowdownPercent ) {
+                printf( "  SLOWER" );
+                ++numSlower;
+            }
+        }
+        printf( "\n" );
+    }
+    //printing it is what keeps the kernels' work from being thrown away
+    printf( "Check: %" PRIu64 "\n", check );
+
+    if ( haveBaseline ) {
+        printf( "%u kernel(s) more than %.1f%% slower than %s\n", numSlower, maxSlowdownPercent,
+                baselineFile );
+    } else {
+        writeBaseline( baselineFile, corpusSize, timings );
+        printf( "Wrote baseline %s\n", baselineFile );
+    }
+
+    corpus_free( &corpus );
+    return numSlower;
+}
@@ -0,0 +1,27 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+ * Time each of the solver's hot kernels (see kernels.h) on its own
+ *
+ * Every kernel runs over the same corpus of corpusSize Puzzles from puzzle_shuffle
+ * with seed 0, with its inputs (edge triples, an EdgeSolution, center rows, an
+ * other solution) worked out ahead of time. Each kernel is timed numSamples times
+ * over the whole corpus with the cycle counter (nanoseconds where there is none),
+ * samples more than 3 scaled MADs from the median are thrown out, and the mean of
+ * the rest is the kernel's cost per call.
+ *
+ * The costs are compared with baselineFile: any kernel more than maxSlowdownPercent
+ * slower is flagged. If there is no baselineFile yet, or updateBaseline is set,
+ * this run is written as the new baseline instead.
+ *
+ * Returns how many kernels were flagged.
+*/
+uint microbench_run( const uint corpusSize, const uint numSamples,
+                     const char* const baselineFile, const float maxSlowdownPercent,
+                     const bool updateBaseline );
+
+#endif
@@ -14,21 +14,64 @@ __inline__ Piece piece_create( const PieceType type, const uint index, const cha
                               .index = index,
                               .bitfield = 0 };
 
-    piece.bitfield |= ( ( uint64_t ) 1 ) << top;
-    piece.bitfield |= ( ( uint64_t ) 1 ) << right;
-    piece.bitfield |= ( ( uint64_t ) 1 ) << bottom;
-    piece.bitfield |= ( ( uint64_t ) 1 ) << left;
+    piece.bitfield |= piece_sideBit( top );
+    piece.bitfield |= piece_sideBit( right );
+    piece.bitfield |= piece_sideBit( bottom );
+    piece.bitfield |= piece_sideBit( left );
     return piece;
 }
 
-__inline__ bool piece_contains( const Piece piece, const char side ) {
-    return piece.bitfield >> side & 1;
+void piece_setSide( Piece* const piece, const SideDirection side, const char value ) {
+    piece->sides[side] = value;
+    piece->bitfield = 0;
+    for ( uint i = 0; i < 4; ++i ) {
+        piece->bitfield |= piece_sideBit( piece->sides[i] );
+    }
+}
+
+#ifdef SIGNED_CONNECTORS
+
+__inline__ char piece_complement( const char side ) {
+    return -side;
+}
+
+__inline__ uint64_t piece_sideBit( const char side ) {
+    if ( side > 0 ) {
+        return ( ( uint64_t ) 1 ) << side;
+    }
+    if ( side < 0 ) {
+        return ( ( uint64_t ) 1 ) << ( PIECE_INNIE_BITS - side );
+    }
+    return ( ( uint64_t ) 1 ) | ( ( uint64_t ) 1 ) << PIECE_INNIE_BITS;
+}
+
+__inline__ bool piece_canBeNeighbors( const Piece piece1, const Piece piece2 ) {
+    //swapping the halves turns every outie into its innie and back
+    const uint64_t complements = piece1.bitfield >> PIECE_INNIE_BITS |
+                                 piece1.bitfield << PIECE_INNIE_BITS;
+    return complements & piece2.bitfield;
+}
+
+#else
+
+__inline__ char piece_complement( const char side ) {
+    return side;
+}
+
+__inline__ uint64_t piece_sideBit( const char side ) {
+    return ( ( uint64_t ) 1 ) << side;
 }
 
 __inline__ bool piece_canBeNeighbors( const Piece piece1, const Piece piece2 ) {
     return piece1.bitfield & piece2.bitfield;
 }
 
+#endif
+
+__inline__ bool piece_contains( const Piece piece, const char side ) {
+    return piece.bitfield & piece_sideBit( side );
+}
+
 __inline__ char piece_getSide( const Piece piece, const SideDirection side ) {
     return piece.sides[side];
 }
@@ -39,8 +82,11 @@ __inline__ char piece_getSideWithRotation( const Piece piece, const SideDirectio
 }
 
 __inline__ bool piece_piecesConnect( const char side1, const char side2 ) {
-    //return side1 + side2 == 0;
+#ifdef SIGNED_CONNECTORS
+    return side1 + side2 == 0;
+#else
     return side1 == side2;
+#endif
 }
 
 void piece_print( const Piece* const piece ) {
@@ -19,6 +19,18 @@ typedef enum PieceType {
     CENTER
 } PieceType;
 
+/*
+ * Built with SIGNED_CONNECTORS (make signed), sides are signed: negative is an
+ * innie, positive an outie, and a side only connects to its complement (the same
+ * connector with the other sign). Otherwise every side is positive and connects to
+ * an equal side. Either way, code that needs to know what a side connects to goes
+ * through piece_complement / piece_piecesConnect instead of assuming one.
+*/
+#ifdef SIGNED_CONNECTORS
+//innies go in the high half of the bitfield, a flat side (0) sets a bit in both
+#define PIECE_INNIE_BITS 32
+#endif
+
 //abs( sides[x] ) is [0, numUniqueConnections)
 //negative is an innie, positive it outie
 //Pieces had previously held their own rotation, but only 9 Pieces have rotation
@@ -27,9 +39,19 @@ typedef struct Piece {
     char sides[4]; //top, right, bottom, left
     char index; //index of Piece within the original Puzzle (0 - 25, left to right
                 //top to bottom)
-    uint64_t bitfield;
+    uint64_t bitfield; //piece_sideBit of every side
 } Piece;
 
+/*
+ * The side that connects to side
+*/
+char piece_complement( const char side );
+
+/*
+ * Bit of a Piece's bitfield that says it has side, max connector is 31
+*/
+uint64_t piece_sideBit( const char side );
+
 bool piece_contains( const Piece piece, const char side );
 bool piece_canBeNeighbors( const Piece piece1, const Piece piece2 );
 
@@ -63,6 +85,11 @@ char piece_getSide( const Piece piece, const SideDirection side );
 char piece_getSideWithRotation( const Piece piece, const SideDirection side,
                                 const uint rotation );
 
+/*
+ * Change one side of a Piece, keeping its bitfield up to date
+*/
+void piece_setSide( Piece* const piece, const SideDirection side, const char value );
+
 /*
  * Print the Piece, no rotation
 */
@@ -0,0 +1,266 @@
+#include "prefilter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pieces.h"
+
+#define NUM_OPTIONS 36
+//sides are kept as bits of a uint64_t, signed connectors (up to +-31) use all 64
+#define NUM_SIDE_KEYS 64
+
+//edge ring clockwise from the top left corner
+static const char ringIndexes[16] = { 0, 1, 2, 3, 4, 9, 14, 19, 24, 23, 22, 21, 20, 15, 10, 5 };
+static const char centerIndexes[9] = { 6, 7, 8, 11, 12, 13, 16, 17, 18 };
+
+/*
+ * What a position could hold. Edge ring positions pick one of the 16 edge ring
+ * Pieces (option i is ringIndexes[i]), their rotation is fixed by the flat side.
+ * Center positions pick a center Piece and rotation, option is piece * 4 + rotation.
+ * sides[option][direction] is the connector the option shows in that direction of
+ * the Puzzle, 0 is a flat side. TOP and LEFT are stored as their piece_complement,
+ * so two neighbors fit when the values facing each other are equal.
+*/
+typedef struct PositionOptions {
+    uint64_t options;
+    bool center;
+    char sides[NUM_OPTIONS][4];
+} PositionOptions;
+
+static char storedSide( const SideDirection direction, const char side ) {
+    return direction == TOP || direction == LEFT ? piece_complement( side ) : side;
+}
+
+static uint sideKey( const char side ) {
+    return ( unsigned char ) side & ( NUM_SIDE_KEYS - 1 );
+}
+
+//options that place the same Piece as option does
+static uint64_t samePieceOptions( const bool center, const uint option ) {
+    return center ? 0xFull << ( option / 4 * 4 ) : 1ull << option;
+}
+
+static char optionPieceIndex( const bool center, const uint option ) {
+    return center ? centerIndexes[option / 4] : ringIndexes[option];
+}
+
+//side of the edge ring a position is on: 0 top, 1 right, 2 bottom, 3 left
+static uint ringSide( const uint row, const uint col ) {
+    if ( row == 0 ) {
+        return 0;
+    }
+    if ( col == 4 ) {
+        return 1;
+    }
+    if ( row == 4 ) {
+        return 2;
+    }
+    return 3;
+}
+
+static void setOptions( const Puzzle* const puzzle, PositionOptions positions[25] ) {
+    static const char cornerPositions[4] = { 0, 4, 24, 20 };
+
+    //every center position has the same options
+    char centerSides[NUM_OPTIONS][4];
+    for ( uint option = 0; option < 36; ++option ) {
+        const Piece piece = puzzle->pieces[( int ) centerIndexes[option / 4]];
+        for ( uint direction = 0; direction < 4; ++direction ) {
+            centerSides[option][direction] = storedSide( direction,
+                                                         piece.sides[( direction + option ) % 4] );
+        }
+    }
+
+    for ( uint position = 0; position < 25; ++position ) {
+        const uint row = position / 5;
+        const uint col = position % 5;
+        PositionOptions* const current = &positions[position];
+        current->options = 0;
+        current->center = row > 0 && row < 4 && col > 0 && col < 4;
+        if ( current->center ) {
+            memcpy( current->sides, centerSides, sizeof( centerSides ) );
+            current->options = ( 1ull << NUM_OPTIONS ) - 1;
+            continue;
+        }
+
+        const bool cornerPosition = ( row == 0 || row == 4 ) && ( col == 0 || col == 4 );
+        for ( uint option = 0; option < 16; ++option ) {
+            const Piece piece = puzzle->pieces[( int ) ringIndexes[option]];
+            if ( ( piece.type == CORNER ) != cornerPosition ) {
+                continue;
+            }
+            for ( uint direction = 0; direction < 4; ++direction ) {
+                current->sides[option][direction] = 0;
+            }
+            //edge/corner right is clockwise along the ring, left counter-clockwise.
+            //Edges have their center side at the bottom when on the top side.
+            if ( cornerPosition ) {
+                uint corner = 0;
+                while ( cornerPositions[corner] != position ) {
+                    ++corner;
+                }
+                const SideDirection right = ( RIGHT + corner ) % 4;
+                const SideDirection bottom = ( BOTTOM + corner ) % 4;
+                current->sides[option][right] = storedSide( right, piece_getSide( piece, RIGHT ) );
+                current->sides[option][bottom] = storedSide( bottom, piece_getSide( piece, LEFT ) );
+            } else {
+                const uint side = ringSide( row, col );
+                for ( SideDirection direction = RIGHT; direction <= LEFT; ++direction ) {
+                    const SideDirection shown = ( direction + side ) % 4;
+                    current->sides[option][shown] = storedSide( shown,
+                                                                piece_getSide( piece, direction ) );
+                }
+            }
+            current->options |= 1ull << option;
+        }
+    }
+
+    //the solver always puts Piece 0 in the top left corner
+    positions[0].options = 1ull << 0;
+}
+
+//position next to position in direction, -1 if that is off the Puzzle
+static int neighborPosition( const uint position, const SideDirection direction ) {
+    const uint row = position / 5;
+    const uint col = position % 5;
+    switch ( direction ) {
+    case TOP:
+        return row > 0 ? ( int ) position - 5 : -1;
+    case RIGHT:
+        return col < 4 ? ( int ) position + 1 : -1;
+    case BOTTOM:
+        return row < 4 ? ( int ) position + 5 : -1;
+    case LEFT:
+        return col > 0 ? ( int ) position - 1 : -1;
+    }
+    return -1;
+}
+
+/*
+ * What the options of every position show in each direction: how many options put
+ * each connector value there, and a bit per value that at least one does
+*/
+typedef struct ShownSides {
+    uint8_t counts[25][4][NUM_SIDE_KEYS];
+    uint64_t shown[25][4];
+    int neighbors[25][4];
+    uint32_t dirty; //positions to look at again
+} ShownSides;
+
+static void removeOption( PositionOptions* const positions, ShownSides* const sides,
+                          const uint position, const uint option ) {
+    positions[position].options &= ~( 1ull << option );
+    for ( uint direction = 0; direction < 4; ++direction ) {
+        const uint key = sideKey( positions[position].sides[option][direction] );
+        if ( --sides->counts[position][direction][key] ) {
+            continue;
+        }
+        sides->shown[position][direction] &= ~( 1ull << key );
+        const int neighbor = sides->neighbors[position][direction];
+        if ( neighbor != -1 ) {
+            sides->dirty |= 1u << neighbor;
+        }
+    }
+}
+
+/*
+ * Cut options until nothing changes: an option goes if some neighbor has no option
+ * that connects to it, and a Piece that is the only option of a position goes from
+ * every other position. Returns true if every position is left with only the Piece
+ * that is there originally.
+ *
+ * Positions are only looked at again when something around them changed.
+*/
+static bool layoutIsForced( PositionOptions positions[25] ) {
+    ShownSides sides;
+    memset( sides.counts, 0, sizeof( sides.counts ) );
+    memset( sides.shown, 0, sizeof( sides.shown ) );
+    for ( uint position = 0; position < 25; ++position ) {
+        for ( uint direction = 0; direction < 4; ++direction ) {
+            sides.neighbors[position][direction] = neighborPosition( position, direction );
+        }
+        for ( uint64_t left = positions[position].options; left; left &= left - 1 ) {
+            const uint option = __builtin_ctzll( left );
+            for ( uint direction = 0; direction < 4; ++direction ) {
+                const uint key = sideKey( positions[position].sides[option][direction] );
+                ++sides.counts[position][direction][key];
+                sides.shown[position][direction] |= 1ull << key;
+            }
+        }
+    }
+
+    sides.dirty = ( 1u << 25 ) - 1;
+    uint32_t placed = 0; //positions whose only Piece was already taken out elsewhere
+    while ( sides.dirty ) {
+        const uint position = __builtin_ctz( sides.dirty );
+        sides.dirty &= sides.dirty - 1;
+        PositionOptions* const current = &positions[position];
+
+        for ( uint64_t left = current->options; left; left &= left - 1 ) {
+            const uint option = __builtin_ctzll( left );
+            for ( uint direction = 0; direction < 4; ++direction ) {
+                const int neighbor = sides.neighbors[position][direction];
+                if ( neighbor == -1 ) {
+                    continue;
+                }
+                const uint key = sideKey( current->sides[option][direction] );
+                if ( !( sides.shown[neighbor][( direction + 2 ) % 4] & ( 1ull << key ) ) ) {
+                    removeOption( positions, &sides, position, option );
+                    break;
+                }
+            }
+        }
+        if ( !current->options ) {
+            //not even the original layout fits, can't happen for a real Puzzle
+            return false;
+        }
+
+        const uint64_t pieceOptions = samePieceOptions( current->center,
+                                                        __builtin_ctzll( current->options ) );
+        if ( ( placed & ( 1u << position ) ) || ( current->options & ~pieceOptions ) ) {
+            continue;
+        }
+        placed |= 1u << position;
+        //options are numbered the same in every position of the same kind
+        for ( uint other = 0; other < 25; ++other ) {
+            PositionOptions* const otherOptions = &positions[other];
+            if ( other == position || otherOptions->center != current->center ) {
+                continue;
+            }
+            const uint64_t removed = otherOptions->options & pieceOptions;
+            for ( uint64_t left = removed; left; left &= left - 1 ) {
+                removeOption( positions, &sides, other, __builtin_ctzll( left ) );
+            }
+            if ( removed ) {
+                sides.dirty |= 1u << other;
+            }
+        }
+    }
+
+    for ( uint position = 0; position < 25; ++position ) {
+        const PositionOptions* const current = &positions[position];
+        for ( uint64_t left = current->options; left; left &= left - 1 ) {
+            if ( optionPieceIndex( current->center, __builtin_ctzll( left ) ) != ( char ) position ) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool prefilter_mayHaveOtherSolution( const Puzzle* const puzzle, PrefilterStats* const stats ) {
+    PositionOptions positions[25];
+    setOptions( puzzle, positions );
+    ++stats->numChecked;
+    if ( layoutIsForced( positions ) ) {
+        ++stats->numRejected;
+        return false;
+    }
+    return true;
+}
+
+void prefilter_printStats( const PrefilterStats* const stats ) {
+    printf( "Prefilter rejected %" PRIu64 "/%" PRIu64 " (%.1f%%)\n", stats->numRejected,
+            stats->numChecked,
+            stats->numChecked ? stats->numRejected * 100.0 / stats->numChecked : 0.0 );
+}
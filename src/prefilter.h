@@ -0,0 +1,35 @@
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include "puzzle.h"
+
+/*
+ * How many Puzzles went through prefilter_mayHaveOtherSolution, and how many it
+ * threw out
+*/
+typedef struct PrefilterStats {
+    uint64_t numChecked;
+    uint64_t numRejected;
+} PrefilterStats;
+
+/*
+ * Cheap check that runs before puzzle_findValidSolutions, returns false only if the
+ * Puzzle for sure has no other solution
+ *
+ * Every position starts with every Piece that could go there (edge ring Pieces on
+ * the edge ring with their flat side out, center Pieces in any rotation in the
+ * center, Piece 0 in the top left like the solver). Options are then cut if a
+ * neighbor has nothing that connects to them, and a Piece that is the only option
+ * of a position is taken out everywhere else. If every position ends up with only
+ * the Piece that is there originally, no other solution exists.
+ *
+ * Nothing is ever cut that a real solution could use, so it never rejects a Puzzle
+ * with other solutions. Puzzles that pass can still have none.
+*/
+bool prefilter_mayHaveOtherSolution( const Puzzle* const puzzle, PrefilterStats* const stats );
+
+void prefilter_printStats( const PrefilterStats* const stats );
+
+#endif
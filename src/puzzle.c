@@ -1,37 +1,116 @@
 #include "puzzle.h"
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-#include "da.h"
+#include "arena.h"
+#include "bandit.h"
+#include "edgecache.h"
+#include "error.h"
+#include "kernels.h"
 #include "pieces.h"
+#include "prefilter.h"
 #include "rand.h"
+#include "results.h"
+#include "spsc.h"
+#include "telemetry.h"
+#include "vec.h"
 
 
-typedef struct TripleIndex {
-    char indexes[3];
-    char rotations[3];
-} TripleIndex;
-
-typedef struct EdgeSolution {
-    char cornerIndexes[4];
-    char topEdgeIndexes[3]; //left to right
-    char leftEdgeIndexes[3]; //top to bottom
-    char rightEdgeIndexes[3]; //top to bottom
-    char bottomEdgeIndexes[3]; //left to right
-} EdgeSolution;
-
-typedef struct CenterSolution {
-    char indexes[3][3];
-    char rotations[3][3];
-} CenterSolution;
-
 typedef struct PiecePair {
     char indexes[2];
     char sides[2];
 } PiecePair;
 
+/*
+ * Hands CompactEdgeSolutions to the next stage in batches of batchSize while the
+ * edge stage is still running, so the full set never has to be stored. The
+ * EdgeSet is cleared after every batch, returning false stops the edge stage.
+*/
+typedef struct EdgeBatchConsumer {
+    bool ( *consume )( const Puzzle* const puzzle, const EdgeSet* const edgeSet, void* const arg );
+    void* arg;
+    size_t batchSize;
+} EdgeBatchConsumer;
+
+//only 6 valid arangements of corners (top left, top right, bottom right, bottom left)
+static const char cornerArrangements[6][5] = { {0, 4, 20, 24, 0}, {0, 4, 24, 20, 0},
+    {0, 20, 4, 24, 0}, {0, 20, 24, 4, 0},
+    {0, 24, 4, 20, 0}, {0, 24, 20, 4, 0} };
+
+//where EdgeSolution.cornerIndexes go in the Puzzle
+static const char cornerPositions[4] = { 0, 4, 24, 20 };
+
+//the two Piece sides each connection feeds, same layout puzzle_setPieces2 builds. The
+//first gets the connection's value, the second its piece_complement
+typedef struct PieceSide {
+    char piece;
+    char side;
+} PieceSide;
+
+static const PieceSide connectionSides[40][2] = {
+    { { 0, RIGHT }, { 1, LEFT } }, { { 5, BOTTOM }, { 6, LEFT } },
+    { { 10, BOTTOM }, { 11, LEFT } }, { { 15, BOTTOM }, { 16, LEFT } },
+    { { 20, LEFT }, { 21, RIGHT } }, { { 1, RIGHT }, { 2, LEFT } },
+    { { 6, RIGHT }, { 7, LEFT } }, { { 11, RIGHT }, { 12, LEFT } },
+    { { 16, RIGHT }, { 17, LEFT } }, { { 21, LEFT }, { 22, RIGHT } },
+    { { 2, RIGHT }, { 3, LEFT } }, { { 7, RIGHT }, { 8, LEFT } },
+    { { 12, RIGHT }, { 13, LEFT } }, { { 17, RIGHT }, { 18, LEFT } },
+    { { 22, LEFT }, { 23, RIGHT } }, { { 3, RIGHT }, { 4, LEFT } },
+    { { 8, RIGHT }, { 9, BOTTOM } }, { { 13, RIGHT }, { 14, BOTTOM } },
+    { { 18, RIGHT }, { 19, BOTTOM } }, { { 23, LEFT }, { 24, RIGHT } },
+    { { 0, LEFT }, { 5, RIGHT } }, { { 1, BOTTOM }, { 6, TOP } },
+    { { 2, BOTTOM }, { 7, TOP } }, { { 3, BOTTOM }, { 8, TOP } },
+    { { 4, RIGHT }, { 9, LEFT } }, { { 5, LEFT }, { 10, RIGHT } },
+    { { 6, BOTTOM }, { 11, TOP } }, { { 7, BOTTOM }, { 12, TOP } },
+    { { 8, BOTTOM }, { 13, TOP } }, { { 9, RIGHT }, { 14, LEFT } },
+    { { 10, LEFT }, { 15, RIGHT } }, { { 11, BOTTOM }, { 16, TOP } },
+    { { 12, BOTTOM }, { 17, TOP } }, { { 13, BOTTOM }, { 18, TOP } },
+    { { 14, RIGHT }, { 19, LEFT } }, { { 15, LEFT }, { 20, RIGHT } },
+    { { 16, BOTTOM }, { 21, BOTTOM } }, { { 17, BOTTOM }, { 22, BOTTOM } },
+    { { 18, BOTTOM }, { 23, BOTTOM } }, { { 19, RIGHT }, { 24, LEFT } } };
+
+static const char centerPieceIndexes[9] = { 6, 7, 8, 11, 12, 13, 16, 17, 18 };
+//inverse of centerPieceIndexes, only the center entries are meaningful
+static const char centerPieceSlots[25] = { [6] = 0, [7] = 1, [8] = 2, [11] = 3, [12] = 4,
+                                           [13] = 5, [16] = 6, [17] = 7, [18] = 8 };
+//PackedCenterSolution bits that say which Piece is in each cell, and their value for
+//the original layout (rotations are left out, a Piece that looks the same rotated
+//still makes the original layout)
+static const PackedCenterSolution centerSlotsMask = 0xF3CF3CF3CF3CFull;
+static const PackedCenterSolution originalCenterSlots = 0x81C61440C2040ull;
+
+void edgeSet_init( EdgeSet* const edgeSet, const size_t startingSize ) {
+    tripleVec_init( &edgeSet->triples, 2000 );
+    compactEdgeVec_init( &edgeSet->solutions, startingSize );
+}
+
+void edgeSet_free( EdgeSet* const edgeSet ) {
+    tripleVec_free( &edgeSet->triples );
+    compactEdgeVec_free( &edgeSet->solutions );
+}
+
+void puzzle_expandEdgeSolution( const EdgeSet* const edgeSet,
+                                const CompactEdgeSolution* const compact,
+                                EdgeSolution* const edgeSolution ) {
+    const char* const arrangement = cornerArrangements[compact->arrangement];
+    const TripleIndex* topEdge = tripleVec_at( &edgeSet->triples, compact->tripleIndexes[0] );
+    const TripleIndex* rightEdge = tripleVec_at( &edgeSet->triples, compact->tripleIndexes[1] );
+    const TripleIndex* bottomEdge = tripleVec_at( &edgeSet->triples, compact->tripleIndexes[2] );
+    const TripleIndex* leftEdge = tripleVec_at( &edgeSet->triples, compact->tripleIndexes[3] );
+    for ( uint i = 0; i < 4; ++i ) {
+        edgeSolution->cornerIndexes[i] = arrangement[i];
+        if ( i < 3 ) {
+            edgeSolution->topEdgeIndexes[i] = topEdge->indexes[i];
+            edgeSolution->rightEdgeIndexes[i] = rightEdge->indexes[i];
+            edgeSolution->bottomEdgeIndexes[i] = bottomEdge->indexes[2 - i];
+            edgeSolution->leftEdgeIndexes[i] = leftEdge->indexes[2 - i];
+        }
+    }
+}
+
 
 bool twoIndexesOriginallyTouched( const char index1, const char index2 ) {
     uint col1 = index1 % 5;
@@ -75,13 +154,14 @@ static bool edgeSolutionIsUnique( const EdgeSolution* edge ) {
     if ( !edgeRowIsUnique( edge->cornerIndexes[0], edge->cornerIndexes[1], edge->topEdgeIndexes ) ) {
         return false; 
     }
-    if ( !edgeRowIsUnique( edge->cornerIndexes[1], edge->cornerIndexes[3], edge->rightEdgeIndexes ) ) {
+    //cornerIndexes go clockwise from the top left
+    if ( !edgeRowIsUnique( edge->cornerIndexes[1], edge->cornerIndexes[2], edge->rightEdgeIndexes ) ) {
         return false; 
     }
     if ( !edgeRowIsUnique( edge->cornerIndexes[3], edge->cornerIndexes[2], edge->bottomEdgeIndexes ) ) {
         return false; 
     }
-    if ( !edgeRowIsUnique( edge->cornerIndexes[2], edge->cornerIndexes[0], edge->leftEdgeIndexes ) ) {
+    if ( !edgeRowIsUnique( edge->cornerIndexes[0], edge->cornerIndexes[3], edge->leftEdgeIndexes ) ) {
         return false; 
     }
 
@@ -135,7 +215,7 @@ static bool uintArrayContains( const uint* const array, const uint arraySize,
 }
 
 static void puzzle_calculateValidEdgesStack( const Puzzle* const puzzle,
-                                             DynamicArray* const validEdges ) {
+                                             TripleIndexVec* const validEdges ) {
     static const uint cornerIndexes[4] = { 0, 4, 20, 24 };
     static const uint edgeIndexes[12] = { 1, 2, 3, 5, 10, 15, 9, 14, 19, 21, 22, 23 };
     //Right/Left refer to Right/Left of edge pieces
@@ -143,20 +223,18 @@ static void puzzle_calculateValidEdgesStack( const Puzzle* const puzzle,
     char validRights[4] = {0};
     for ( uint i = 0; i < 4; ++i ) {
         const Piece corner = puzzle->pieces[cornerIndexes[i]];
-        //validLefts[i] = -piece_getSide( corner, RIGHT );
-        //validRights[i] = -piece_getSide( corner, LEFT );
-        validLefts[i] = piece_getSide( corner, RIGHT );
-        validRights[i] = piece_getSide( corner, LEFT );
+        validLefts[i] = piece_complement( piece_getSide( corner, RIGHT ) );
+        validRights[i] = piece_complement( piece_getSide( corner, LEFT ) );
     }
 
-    validEdges->numElements = 0;
+    tripleVec_clear( validEdges );
     typedef struct {
         char lastRight;
         uint indexes[3];
         uint numEdges;
     } StackParams;
 
-    static StackParams stack[5000];
+    static __thread StackParams stack[5000];
     int stackSize = 1;
     stack[0] = ( StackParams ) { .numEdges = 0 };
 
@@ -186,11 +264,10 @@ static void puzzle_calculateValidEdgesStack( const Puzzle* const puzzle,
                     continue;
                 }
                 parameters.indexes[2] = i;
-                TripleIndex tempTriple;
+                TripleIndex* const tempTriple = tripleVec_emplace( validEdges );
                 for ( uint j = 0; j < 3; ++j ) {
-                    tempTriple.indexes[j] = edgeIndexes[parameters.indexes[j]];
+                    tempTriple->indexes[j] = edgeIndexes[parameters.indexes[j]];
                 }
-                da_addElement( validEdges, &tempTriple );
                 continue;
             }
             parameters.indexes[parameters.numEdges] = i;
@@ -203,7 +280,7 @@ static void puzzle_calculateValidEdgesStack( const Puzzle* const puzzle,
 }
 
 static void puzzle_calculateValidEdges( const Puzzle* const puzzle,
-                                        DynamicArray* const validEdges ) {
+                                        TripleIndexVec* const validEdges ) {
     static const uint cornerIndexes[4] = { 0, 4, 20, 24 };
     static const uint edgeIndexes[12] = { 1, 2, 3, 5, 10, 15, 9, 14, 19, 21, 22, 23 };
     //Right/Left refer to Right/Left of edge pieces
@@ -211,13 +288,11 @@ static void puzzle_calculateValidEdges( const Puzzle* const puzzle,
     char validRights[4] = {0};
     for ( uint i = 0; i < 4; ++i ) {
         const Piece corner = puzzle->pieces[cornerIndexes[i]];
-        //validLefts[i] = -piece_getSide( corner, RIGHT );
-        //validRights[i] = -piece_getSide( corner, LEFT );
-        validLefts[i] = piece_getSide( corner, RIGHT );
-        validRights[i] = piece_getSide( corner, LEFT );
+        validLefts[i] = piece_complement( piece_getSide( corner, RIGHT ) );
+        validRights[i] = piece_complement( piece_getSide( corner, LEFT ) );
     }
 
-    validEdges->numElements = 0;
+    tripleVec_clear( validEdges );
     for ( uint i = 0; i < 12; ++i ) { //left
 
         const Piece first = puzzle->pieces[edgeIndexes[i]];
@@ -259,34 +334,117 @@ static void puzzle_calculateValidEdges( const Puzzle* const puzzle,
                     continue; 
                 }
 
-                TripleIndex tempTripleIndex;
+                TripleIndex* const tempTripleIndex = tripleVec_emplace( validEdges );
 
-                tempTripleIndex.indexes[0] = first.index;
-                tempTripleIndex.indexes[1] = second.index;
-                tempTripleIndex.indexes[2] = third.index;
-                
-                da_addElement( validEdges, &tempTripleIndex );
+                tempTripleIndex->indexes[0] = first.index;
+                tempTripleIndex->indexes[1] = second.index;
+                tempTripleIndex->indexes[2] = third.index;
             }
         }
     }
 }
 
-static void puzzle_recEdgeSolve( const Puzzle* const puzzle, uint edgeIndexes[4],
-                                const char* const currentArrangement,
-                                const DynamicArray* const edgeTriples, 
-                                const uint currentEdge, DynamicArray* const edgeSolutions ) {
+//which way this thread's solves find their edge triples
+static __thread EdgeStage edgeStage = EDGE_STAGE_NESTED;
+
+EdgeStage puzzle_useEdgeStage( const EdgeStage stage ) {
+    const EdgeStage previous = edgeStage;
+    edgeStage = stage;
+    return previous;
+}
+
+static void puzzle_calculateEdgeTriples( const Puzzle* const puzzle,
+                                         TripleIndexVec* const validEdges ) {
+    if ( edgeStage == EDGE_STAGE_STACK ) {
+        puzzle_calculateValidEdgesStack( puzzle, validEdges );
+    } else {
+        puzzle_calculateValidEdges( puzzle, validEdges );
+    }
+}
+
+//how many nodes go by between looks at the clock and the node budget
+#define BUDGET_CHECK_INTERVAL 1024
+
+/*
+ * Budget of the solve running on this thread. The searches only count down
+ * countdown, everything else is looked at when it gets to 0. Without a budget it
+ * starts too high to ever get there.
+*/
+typedef struct SolveMeter {
+    uint64_t countdown;
+    uint64_t window; //what countdown started at
+    uint64_t numNodes; //before the current window
+    uint64_t maxNodes;
+    uint64_t deadline; //CLOCK_MONOTONIC nanoseconds, 0 for none
+    bool outOfNodes;
+    bool outOfTime;
+    bool stopped;
+} SolveMeter;
+
+static __thread SolveMeter solveMeter = { .countdown = UINT64_MAX };
+
+static uint64_t monotonicNanoseconds() {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+//start the next window, or stop if the budget is used up
+static bool solveMeter_check() {
+    SolveMeter* const meter = &solveMeter;
+    if ( !meter->stopped ) {
+        meter->numNodes += meter->window;
+        if ( meter->maxNodes && meter->numNodes >= meter->maxNodes ) {
+            meter->outOfNodes = true;
+        } else if ( meter->deadline && monotonicNanoseconds() >= meter->deadline ) {
+            meter->outOfTime = true;
+        }
+        meter->stopped = meter->outOfNodes || meter->outOfTime;
+    }
+    if ( meter->stopped ) {
+        //every node from here on comes back to this check
+        meter->window = 0;
+        meter->countdown = 1;
+        return false;
+    }
+    meter->window = BUDGET_CHECK_INTERVAL;
+    if ( meter->maxNodes && meter->maxNodes - meter->numNodes < meter->window ) {
+        meter->window = meter->maxNodes - meter->numNodes;
+    }
+    meter->countdown = meter->window;
+    return true;
+}
+
+//count a node of the search, false once the budget is used up
+static inline bool solveMeter_tick() {
+    if ( __builtin_expect( --solveMeter.countdown != 0, 1 ) ) {
+        return true;
+    }
+    return solveMeter_check();
+}
+
+//returns false if the consumer asked to stop or the budget ran out
+static bool puzzle_recEdgeSolve( const Puzzle* const puzzle, uint edgeIndexes[4],
+                                const uint arrangement, EdgeSet* const edgeSet,
+                                const uint currentEdge,
+                                const EdgeBatchConsumer* const consumer ) {
+    const char* const currentArrangement = cornerArrangements[arrangement];
+    const TripleIndexVec* const edgeTriples = &edgeSet->triples;
     const char leftCorner = piece_getSide( puzzle->pieces[( int ) currentArrangement[( int ) currentEdge]], RIGHT );
     const char rightCorner = piece_getSide( puzzle->pieces[( int ) currentArrangement[( int  ) currentEdge + 1]], LEFT );
 
     for ( uint i = 0; i < edgeTriples->numElements; ++i ) {
+        if ( !solveMeter_tick() ) {
+            return false;
+        }
         if ( uintArrayContains( edgeIndexes, currentEdge, i ) ) {
             continue;   
         }
 
-        TripleIndex* edgeToCheck = ( TripleIndex* ) da_getElement( edgeTriples, i );
+        const TripleIndex* edgeToCheck = tripleVec_at( edgeTriples, i );
         bool valid = true;
         for ( uint j = 0; j < currentEdge; ++j ) {
-            TripleIndex* tempTripleIndex1 = ( TripleIndex* ) da_getElement( edgeTriples, ( int ) edgeIndexes[j] );
+            const TripleIndex* tempTripleIndex1 = tripleVec_at( edgeTriples, edgeIndexes[j] );
             for ( uint k = 0; k < 3; ++k ) {
                 if ( charArrayContains( tempTripleIndex1->indexes, 3, edgeToCheck->indexes[k] ) ) {
                     valid = false;
@@ -312,40 +470,38 @@ static void puzzle_recEdgeSolve( const Puzzle* const puzzle, uint edgeIndexes[4]
 
         edgeIndexes[currentEdge] = i;
         if ( currentEdge == 3 ) {
-            EdgeSolution tempEdgeSolution;
-            TripleIndex* topEdge = ( TripleIndex* ) da_getElement( edgeTriples, ( int ) edgeIndexes[0] );
-            TripleIndex* rightEdge = ( TripleIndex* ) da_getElement( edgeTriples, ( int ) edgeIndexes[1] );
-            TripleIndex* bottomEdge = ( TripleIndex* ) da_getElement( edgeTriples, ( int ) edgeIndexes[2] );
-            TripleIndex* leftEdge = ( TripleIndex* ) da_getElement( edgeTriples, ( int ) edgeIndexes[3] );
-            for ( uint i = 0; i < 4; ++i ) {
-                tempEdgeSolution.cornerIndexes[i] = currentArrangement[i]; 
-                if ( i < 3 ) {
-                    tempEdgeSolution.topEdgeIndexes[i] = topEdge->indexes[i];
-                    tempEdgeSolution.rightEdgeIndexes[i] = rightEdge->indexes[i];   
-                    tempEdgeSolution.bottomEdgeIndexes[i] = bottomEdge->indexes[2 - i];   
-                    tempEdgeSolution.leftEdgeIndexes[i] = leftEdge->indexes[2 - i];   
+            CompactEdgeSolution* const tempEdgeSolution = compactEdgeVec_emplace( &edgeSet->solutions );
+            for ( uint j = 0; j < 4; ++j ) {
+                tempEdgeSolution->tripleIndexes[j] = edgeIndexes[j];
+            }
+            tempEdgeSolution->arrangement = arrangement;
+            if ( consumer && edgeSet->solutions.numElements == consumer->batchSize ) {
+                const bool keepGoing = consumer->consume( puzzle, edgeSet, consumer->arg );
+                compactEdgeVec_clear( &edgeSet->solutions );
+                if ( !keepGoing ) {
+                    return false;
                 }
             }
-            da_addElement( edgeSolutions, &tempEdgeSolution );
-        } else {
-            puzzle_recEdgeSolve( puzzle, edgeIndexes, currentArrangement, 
-                                edgeTriples, currentEdge + 1,
-                                edgeSolutions );
+        } else if ( !puzzle_recEdgeSolve( puzzle, edgeIndexes, arrangement, edgeSet,
+                                          currentEdge + 1, consumer ) ) {
+            return false;
         }
     }
+    return true;
 }
 
 static void puzzle_calculateValidCenterRowsNoEdge( const Puzzle* const puzzle,
-                                                   DynamicArray* const validCenterRows ) {
+                                                   TripleIndexVec* const validCenterRows ) {
     static const uint centerIndexes[9] = { 6, 7, 8, 11, 12, 13, 16, 17, 18 };
 
-    validCenterRows->numElements = 0;
+    tripleVec_clear( validCenterRows );
 
     for ( uint i = 0; i < 36; ++i ) {
         const uint firstIndex = i / 4; 
         const uint firstRotation = i % 4;
         const Piece firstPiece = puzzle->pieces[centerIndexes[firstIndex]];
         const char firstRight = piece_getSideWithRotation( firstPiece, RIGHT, firstRotation );
+        const char firstRightMatch = piece_complement( firstRight );
         for ( uint j = 0; j < 36; ++j ) {
             const uint secondIndex = j / 4; 
             if ( firstIndex == secondIndex ) {
@@ -353,7 +509,7 @@ static void puzzle_calculateValidCenterRowsNoEdge( const Puzzle* const puzzle,
             }
             const uint secondRotation = j % 4;
             const Piece secondPiece = puzzle->pieces[centerIndexes[secondIndex]];
-            if ( secondRotation == 0 && !piece_contains( secondPiece, firstRight ) ) {
+            if ( secondRotation == 0 && !piece_contains( secondPiece, firstRightMatch ) ) {
                 j += 3;
                 continue;
             }
@@ -362,6 +518,7 @@ static void puzzle_calculateValidCenterRowsNoEdge( const Puzzle* const puzzle,
                 continue;
             }
             const char secondRight = piece_getSideWithRotation( secondPiece, RIGHT, secondRotation );
+            const char secondRightMatch = piece_complement( secondRight );
             for ( uint k = 0; k < 36; ++k ) {
                 const uint thirdIndex = k / 4; 
                 if ( thirdIndex == secondIndex || thirdIndex == firstIndex ) {
@@ -369,7 +526,7 @@ static void puzzle_calculateValidCenterRowsNoEdge( const Puzzle* const puzzle,
                 }
                 const uint thirdRotation = k % 4;
                 const Piece thirdPiece = puzzle->pieces[centerIndexes[thirdIndex]];
-                if ( thirdRotation == 0 && !piece_contains( thirdPiece, secondRight ) ) {
+                if ( thirdRotation == 0 && !piece_contains( thirdPiece, secondRightMatch ) ) {
                     k += 3;
                     continue;
                 }
@@ -378,15 +535,14 @@ static void puzzle_calculateValidCenterRowsNoEdge( const Puzzle* const puzzle,
                 if ( !piece_piecesConnect( secondRight, thirdLeft ) ){
                     continue;
                 }
-                TripleIndex tempValidCenterRow;
-
-                tempValidCenterRow.indexes[0] = firstPiece.index;
-                tempValidCenterRow.indexes[1] = secondPiece.index;
-                tempValidCenterRow.indexes[2] = thirdPiece.index;
-                tempValidCenterRow.rotations[0] = firstRotation;
-                tempValidCenterRow.rotations[1] = secondRotation;
-                tempValidCenterRow.rotations[2] = thirdRotation;
-                da_addElement( validCenterRows, &tempValidCenterRow );
+                TripleIndex* const tempValidCenterRow = tripleVec_emplace( validCenterRows );
+
+                tempValidCenterRow->indexes[0] = firstPiece.index;
+                tempValidCenterRow->indexes[1] = secondPiece.index;
+                tempValidCenterRow->indexes[2] = thirdPiece.index;
+                tempValidCenterRow->rotations[0] = firstRotation;
+                tempValidCenterRow->rotations[1] = secondRotation;
+                tempValidCenterRow->rotations[2] = thirdRotation;
             }
         }
     }
@@ -394,7 +550,7 @@ static void puzzle_calculateValidCenterRowsNoEdge( const Puzzle* const puzzle,
 
 static void puzzle_calculateValidCenterRows( const Puzzle* const puzzle,
                                             const EdgeSolution* edgeSolution,
-                                            DynamicArray* const validCenterRows,
+                                            TripleIndexVec* const validCenterRows,
                                             const uint validNeighbors[9][9],
                                             const uint validNeighborsCount[9] ) {
     static const uint centerIndexes[9] = { 6, 7, 8, 11, 12, 13, 16, 17, 18 };
@@ -405,23 +561,22 @@ static void puzzle_calculateValidCenterRows( const Puzzle* const puzzle,
     for ( uint i = 0; i < 3; ++i ) {
         const Piece leftEdge = puzzle->pieces[( int ) edgeSolution->leftEdgeIndexes[i]];
         const Piece rightEdge = puzzle->pieces[( int ) edgeSolution->rightEdgeIndexes[i]];
-        //validLefts[i]= -piece_getSide( leftEdge, BOTTOM );
-        //validRights[i]= -piece_getSide( rightEdge, BOTTOM );
         validLefts[i]= piece_getSide( leftEdge, BOTTOM );
         validRights[i]= piece_getSide( rightEdge, BOTTOM );
     }
 
-    validCenterRows->numElements = 0;
+    tripleVec_clear( validCenterRows );
 
     for ( uint i = 0; i < 36; ++i ) {
         const uint firstIndex = i / 4; 
         const uint firstRotation = i % 4;
         const Piece firstPiece = puzzle->pieces[centerIndexes[firstIndex]];
         const char firstLeft = piece_getSideWithRotation( firstPiece, LEFT, firstRotation );
-        if ( !charArrayContains( validLefts, 3, firstLeft ) ) {
+        if ( !charArrayContains( validLefts, 3, piece_complement( firstLeft ) ) ) {
             continue;
         }
         const char firstRight = piece_getSideWithRotation( firstPiece, RIGHT, firstRotation );
+        const char firstRightMatch = piece_complement( firstRight );
         for ( uint j = 0; j < 36; ++j ) {
             const uint secondIndex = j/4;
             if ( firstIndex == secondIndex ) {
@@ -429,7 +584,7 @@ static void puzzle_calculateValidCenterRows( const Puzzle* const puzzle,
             }
             const uint secondRotation = j % 4;
             const Piece secondPiece = puzzle->pieces[centerIndexes[secondIndex]];
-            if ( secondRotation == 0 && !piece_contains( secondPiece, firstRight ) ) {
+            if ( secondRotation == 0 && !piece_contains( secondPiece, firstRightMatch ) ) {
                 j += 3;
                 continue;
             }
@@ -438,6 +593,7 @@ static void puzzle_calculateValidCenterRows( const Puzzle* const puzzle,
                 continue;
             }
             const char secondRight = piece_getSideWithRotation( secondPiece, RIGHT, secondRotation );
+            const char secondRightMatch = piece_complement( secondRight );
             for ( uint k = 0; k < 36; ++k ) {
                 const uint thirdIndex = k / 4;
                 if ( thirdIndex == secondIndex || thirdIndex == firstIndex ) {
@@ -445,7 +601,7 @@ static void puzzle_calculateValidCenterRows( const Puzzle* const puzzle,
                 }
                 const uint thirdRotation = k % 4;
                 const Piece thirdPiece = puzzle->pieces[centerIndexes[thirdIndex]];
-                if ( thirdRotation == 0 && !piece_contains( thirdPiece, secondRight ) ) {
+                if ( thirdRotation == 0 && !piece_contains( thirdPiece, secondRightMatch ) ) {
                     k += 3;
                     continue;
                 }
@@ -470,15 +626,14 @@ static void puzzle_calculateValidCenterRows( const Puzzle* const puzzle,
                     continue;
                 }
 
-                TripleIndex tempValidCenterRow;
+                TripleIndex* const tempValidCenterRow = tripleVec_emplace( validCenterRows );
 
-                tempValidCenterRow.indexes[0] = firstPiece.index;
-                tempValidCenterRow.indexes[1] = secondPiece.index;
-                tempValidCenterRow.indexes[2] = thirdPiece.index;
-                tempValidCenterRow.rotations[0] = firstRotation;
-                tempValidCenterRow.rotations[1] = secondRotation;
-                tempValidCenterRow.rotations[2] = thirdRotation;
-                da_addElement( validCenterRows, &tempValidCenterRow );
+                tempValidCenterRow->indexes[0] = firstPiece.index;
+                tempValidCenterRow->indexes[1] = secondPiece.index;
+                tempValidCenterRow->indexes[2] = thirdPiece.index;
+                tempValidCenterRow->rotations[0] = firstRotation;
+                tempValidCenterRow->rotations[1] = secondRotation;
+                tempValidCenterRow->rotations[2] = thirdRotation;
             }
         }
     }
@@ -486,18 +641,23 @@ static void puzzle_calculateValidCenterRows( const Puzzle* const puzzle,
 
 void puzzle_recCenterSolve( const Puzzle* const puzzle, uint centerIndexes[3],
                            const EdgeSolution* const edgeSolution,
-                           const DynamicArray* const centerRows, const uint currentRow,
-                           DynamicArray* const centerSolutions ) {
+                           const TripleIndexVec* const centerRows, const uint currentRow,
+                           PackedCenterSolutionVec* const centerSolutions,
+                           const size_t maxCenterSolutions,
+                           const PackedCenterSolution skipSlots ) {
     if ( currentRow == 3 ) {
-        CenterSolution tempCenterSolution;
+        PackedCenterSolution packed = 0;
         for ( uint i = 0; i < 3; ++i ) {
-            TripleIndex* row = ( TripleIndex* ) da_getElement( centerRows, centerIndexes[i] );
+            const TripleIndex* row = tripleVec_at( centerRows, centerIndexes[i] );
             for ( uint j = 0; j < 3; ++j ) {
-                tempCenterSolution.indexes[i][j] = row->indexes[j];
-                tempCenterSolution.rotations[i][j] = row->rotations[j];
+                const PackedCenterSolution cell = centerPieceSlots[( int ) row->indexes[j]] |
+                                                  row->rotations[j] << 4;
+                packed |= cell << ( 6 * ( i * 3 + j ) );
             }
         }
-        da_addElement( centerSolutions, &tempCenterSolution );
+        if ( ( packed & centerSlotsMask ) != skipSlots ) {
+            packedCenterVec_add( centerSolutions, packed );
+        }
 
         return;
     }
@@ -506,15 +666,18 @@ void puzzle_recCenterSolve( const Puzzle* const puzzle, uint centerIndexes[3],
     const char rightEdge = piece_getSide( puzzle->pieces[( int ) edgeSolution->rightEdgeIndexes[currentRow]], BOTTOM );
 
     for ( int i = 0; i < centerRows->numElements; ++i ) {
+        if ( !solveMeter_tick() ) {
+            return;
+        }
         if ( uintArrayContains( centerIndexes, currentRow, i ) ) {
             continue;   
         }
 
-        const TripleIndex* row = ( TripleIndex* ) da_getElement( centerRows, i );
+        const TripleIndex* row = tripleVec_at( centerRows, i );
 
         bool valid = true;
         for ( uint j = 0; j < currentRow; ++j ) {
-            TripleIndex* checkRow = ( TripleIndex* ) da_getElement( centerRows, ( int ) centerIndexes[j] );
+            const TripleIndex* checkRow = tripleVec_at( centerRows, centerIndexes[j] );
             for ( uint k = 0; k < 3; ++k ) {
                 if ( charArrayContains( checkRow->indexes, 3, row->indexes[k] ) ) {
                     valid = false;
@@ -528,11 +691,11 @@ void puzzle_recCenterSolve( const Puzzle* const puzzle, uint centerIndexes[3],
         if ( !valid ) {
             continue;
         }
-        const char leftCenter = piece_getSide( puzzle->pieces[( int ) row->indexes[0]], LEFT );
+        const char leftCenter = piece_getSideWithRotation( puzzle->pieces[( int ) row->indexes[0]], LEFT, row->rotations[0] );
         if ( !piece_piecesConnect( leftCenter, leftEdge ) ) {
             continue;
         }
-        const char rightCenter = piece_getSide( puzzle->pieces[( int ) row->indexes[2]], RIGHT );
+        const char rightCenter = piece_getSideWithRotation( puzzle->pieces[( int ) row->indexes[2]], RIGHT, row->rotations[2] );
         if ( !piece_piecesConnect( rightCenter, rightEdge ) ) {
             continue;
         }
@@ -546,7 +709,7 @@ void puzzle_recCenterSolve( const Puzzle* const puzzle, uint centerIndexes[3],
                 }
             }
         } else if ( currentRow == 1 ) {
-            TripleIndex* rowAbove = ( TripleIndex* ) da_getElement( centerRows, ( int ) centerIndexes[0] );
+            const TripleIndex* rowAbove = tripleVec_at( centerRows, centerIndexes[0] );
             for ( uint j = 0; j < 3; ++j ) {
                 if ( !piece_piecesConnect( piece_getSideWithRotation( puzzle->pieces[( int ) row->indexes[j]], TOP, row->rotations[j] ),
                     piece_getSideWithRotation( puzzle->pieces[( int ) rowAbove->indexes[j]], BOTTOM, rowAbove->rotations[j] ) ) ) {
@@ -556,7 +719,7 @@ void puzzle_recCenterSolve( const Puzzle* const puzzle, uint centerIndexes[3],
 
             }
         } else if ( currentRow == 2 ) {
-            TripleIndex* rowAbove = ( TripleIndex* ) da_getElement( centerRows, ( int ) centerIndexes[1] );
+            const TripleIndex* rowAbove = tripleVec_at( centerRows, centerIndexes[1] );
             for ( uint j = 0; j < 3; ++j ) {
                 if ( !piece_piecesConnect( piece_getSideWithRotation( puzzle->pieces[( int ) row->indexes[j]], BOTTOM, row->rotations[j] ),
                     piece_getSide( puzzle->pieces[( int ) edgeSolution->bottomEdgeIndexes[j]], BOTTOM ) ) ) {
@@ -576,21 +739,23 @@ void puzzle_recCenterSolve( const Puzzle* const puzzle, uint centerIndexes[3],
 
         centerIndexes[currentRow] = i;
         puzzle_recCenterSolve( puzzle, centerIndexes, edgeSolution, centerRows,
-                               currentRow + 1, centerSolutions );
+                               currentRow + 1, centerSolutions, maxCenterSolutions,
+                               skipSlots );
+        if ( centerSolutions->numElements >= maxCenterSolutions || solveMeter.stopped ) {
+            return;
+        }
     }
 }
 
 static void puzzle_convertEdgeCenterToSolution( PuzzleSolution* const solution,
                                                const EdgeSolution* const edgeSolution,
-                                               const CenterSolution* const centerSolution ) {
-    const static int corners[] = { 0, 4, 24, 20 };
-
+                                               const PackedCenterSolution centerSolution ) {
     for ( uint i = 0; i < 25; ++i ) {
         solution->rotations[i] = 0;
     }
 
     for ( uint i = 0; i < 4; ++i ) {
-        solution->indexes[corners[i]] = edgeSolution->cornerIndexes[i];
+        solution->indexes[( int ) cornerPositions[i]] = edgeSolution->cornerIndexes[i];
         if ( i < 3 ) {
             solution->indexes[( i + 1 ) * 5] = edgeSolution->leftEdgeIndexes[i];
             solution->indexes[( i + 1 ) * 5 + 4]= edgeSolution->rightEdgeIndexes[i];
@@ -602,8 +767,9 @@ static void puzzle_convertEdgeCenterToSolution( PuzzleSolution* const solution,
     for ( uint i = 0; i < 3; ++i ) {
         for ( uint j = 0; j < 3; ++j ) {
             int index = ( i + 1 ) * 5 + j + 1;
-            solution->indexes[index] = centerSolution->indexes[i][j];
-            solution->rotations[index] = centerSolution->rotations[i][j];
+            const uint cell = ( centerSolution >> ( 6 * ( i * 3 + j ) ) ) & 0x3F;
+            solution->indexes[index] = centerPieceIndexes[cell & 0xF];
+            solution->rotations[index] = cell >> 4;
         }
     }
 }
@@ -686,45 +852,60 @@ static void puzzle_calculateOriginalConnections( const Puzzle* const puzzle,
 }
 
 
-void puzzle_findValidEdges( const Puzzle* const puzzle, DynamicArray* const edgeSolutions ) {
-    //only 6 valid arangements of corners (top left, top right, bottom right, bottom left)
-    const static char cornerArrangements[6][5] = { {0, 4, 20, 24, 0}, {0, 4, 24, 20, 0},
-        {0, 20, 4, 24, 0}, {0, 20, 24, 4, 0},
-        {0, 24, 4, 20, 0}, {0, 24, 20, 4, 0} };
+static void puzzle_findValidEdgesBatched( const Puzzle* const puzzle, EdgeSet* const edgeSet,
+                                          const EdgeBatchConsumer* const consumer ) {
     //get the valid triplets of edges
-    static bool allocatedEdges = false;
-    static DynamicArray* validEdges;
-    if ( !allocatedEdges ) {
-        validEdges = da_create( 2000, sizeof( TripleIndex ) );
-        allocatedEdges = true;
-    }
-
-    puzzle_calculateValidEdges( puzzle, validEdges );
-    //puzzle_calculateValidEdgesStack( puzzle, validEdges );
+    puzzle_calculateEdgeTriples( puzzle, &edgeSet->triples );
 
-    if ( validEdges->numElements < 4 ) {
+    if ( edgeSet->triples.numElements < 4 ) {
         printf( "Error in edge solver\n" );
     }
 
     //for all of the valid configurations, try all possible combinations of edges
-    edgeSolutions->numElements = 0;
+    compactEdgeVec_clear( &edgeSet->solutions );
     for ( uint i = 0; i < 6; ++i ) {
         uint edges[4];
-        puzzle_recEdgeSolve( puzzle, edges, cornerArrangements[i], 
-                            validEdges, 0, edgeSolutions );
+        if ( !puzzle_recEdgeSolve( puzzle, edges, i, edgeSet, 0, consumer ) ) {
+            return;
+        }
+    }
+    if ( consumer && edgeSet->solutions.numElements ) {
+        consumer->consume( puzzle, edgeSet, consumer->arg );
+        compactEdgeVec_clear( &edgeSet->solutions );
     }
 }
 
-void findValidCentersForEdge( const Puzzle* const puzzle, const EdgeSolution* edgeSolution,
-                              DynamicArray* centerSolutions ) {
-    static const uint centerIndex[9] = { 6, 7, 8, 11, 12, 13, 16, 17, 18 };
-    static bool allocatedCenters = false;
-    static DynamicArray* validCenterRows;
-    if ( !allocatedCenters ) {
-        validCenterRows = da_create( 4000, sizeof( TripleIndex ) );
-        allocatedCenters = true;
+void puzzle_findValidEdges( const Puzzle* const puzzle, EdgeSet* const edgeSet ) {
+    puzzle_findValidEdgesBatched( puzzle, edgeSet, NULL );
+}
+
+//EdgeBatchConsumer of puzzle_findValidEdgesUpTo, only called once there are too many
+static bool edgeLimit_reached( const Puzzle* const puzzle, const EdgeSet* const edgeSet,
+                               void* const arg ) {
+    return false;
+}
+
+bool puzzle_findValidEdgesUpTo( const Puzzle* const puzzle, EdgeSet* const edgeSet,
+                                const size_t maxSolutions ) {
+    puzzle_calculateEdgeTriples( puzzle, &edgeSet->triples );
+    compactEdgeVec_clear( &edgeSet->solutions );
+    const EdgeBatchConsumer consumer = { .consume = edgeLimit_reached,
+                                         .batchSize = maxSolutions + 1 };
+    for ( uint i = 0; i < 6; ++i ) {
+        uint edges[4];
+        if ( !puzzle_recEdgeSolve( puzzle, edges, i, edgeSet, 0, &consumer ) ) {
+            return false;
+        }
     }
-    validCenterRows->numElements = 0;
+    return true;
+}
+
+//center rows that could go between the left and right edges of edgeSolution
+static void puzzle_centerRowsForEdge( const Puzzle* const puzzle,
+                                      const EdgeSolution* const edgeSolution,
+                                      TripleIndexVec* const validCenterRows ) {
+    static const uint centerIndex[9] = { 6, 7, 8, 11, 12, 13, 16, 17, 18 };
+    tripleVec_clear( validCenterRows );
     uint validNeighbors[9][9];
     uint validNeighborsCount[9];
     memset( validNeighborsCount, 0, sizeof( uint ) * 9 );
@@ -742,67 +923,409 @@ void findValidCentersForEdge( const Puzzle* const puzzle, const EdgeSolution* ed
 
     puzzle_calculateValidCenterRows( puzzle, edgeSolution, validCenterRows,
                                      validNeighbors, validNeighborsCount );
+}
+
+static bool edgeSolutionIsOriginal( const EdgeSolution* const edgeSolution ) {
+    bool originalEdges = true;
+    for ( uint i = 0; i < 3; ++i ) {
+        if ( edgeSolution->topEdgeIndexes[i] != i + 1 ||
+             edgeSolution->leftEdgeIndexes[i] != ( i + 1 ) * 5 ||
+             edgeSolution->rightEdgeIndexes[i] != ( i + 1 ) * 5 + 4 ||
+             edgeSolution->bottomEdgeIndexes[i] != i + 21 ) {
+            originalEdges = false;
+        }
+    }
+    for ( uint i = 0; i < 4; ++i ) {
+        if ( edgeSolution->cornerIndexes[i] != cornerPositions[i] ) {
+            originalEdges = false;
+        }
+    }
+    return originalEdges;
+}
+
+//findValidCentersForEdge with the center rows built in validCenterRows
+static void findValidCentersForEdgeInRows( const Puzzle* const puzzle,
+                                           const EdgeSolution* edgeSolution,
+                                           TripleIndexVec* const validCenterRows,
+                                           PackedCenterSolutionVec* centerSolutions,
+                                           const size_t maxCenterSolutions ) {
+    puzzle_centerRowsForEdge( puzzle, edgeSolution, validCenterRows );
+    //the original layout is never another solution, so it is left out of the
+    //centers for the original edges
+    const bool originalEdges = edgeSolutionIsOriginal( edgeSolution );
     uint centerIndexes[3];
     puzzle_recCenterSolve( puzzle, centerIndexes, edgeSolution, validCenterRows,
-                           0, centerSolutions );
+                           0, centerSolutions, maxCenterSolutions,
+                           originalEdges ? originalCenterSlots : ~( PackedCenterSolution ) 0 );
 }
 
-void puzzle_findValidSolutions( const Puzzle* const puzzle,
-                               PuzzleSolution* const otherSolutions,
-                               uint* const numOtherSolutions, const uint maxOtherSolutions,
-                               uint* const maxUniqueIndexes, uint* const maxUniqueSides ) {
-    static DynamicArray* edgeSolutions;
-    static DynamicArray* validCenterRows;
-    static DynamicArray* centerSolutions;
-    static bool allocatedArrays = false;
-    if ( !allocatedArrays ) {
-        //terrible idea, no real way to free this after
-        centerSolutions = da_create( 2000, sizeof( CenterSolution ) );
-        edgeSolutions = da_create( 1000000, sizeof( EdgeSolution ) );
-        validCenterRows = da_create( 2000, sizeof( TripleIndex ) );
-        allocatedArrays = true;
+void findValidCentersForEdge( const Puzzle* const puzzle, const EdgeSolution* edgeSolution,
+                              PackedCenterSolutionVec* centerSolutions,
+                              const size_t maxCenterSolutions ) {
+    static __thread bool allocatedCenters = false;
+    static __thread TripleIndexVec validCenterRows;
+    if ( !allocatedCenters ) {
+        tripleVec_init( &validCenterRows, 4000 );
+        allocatedCenters = true;
     }
+    findValidCentersForEdgeInRows( puzzle, edgeSolution, &validCenterRows, centerSolutions,
+                                   maxCenterSolutions );
+}
 
-    edgeSolutions->numElements = 0;
-    centerSolutions->numElements = 0;
+/*
+ * Rows placed so far in puzzle_countCenters: which center Pieces they use and the
+ * bottom sides of the last one, packed into key, and how many ways there are to
+ * get there
+*/
+typedef struct CenterCountState {
+    uint64_t key;
+    uint64_t count;
+} CenterCountState;
+
+VEC_DEFINE( CenterCountStateVec, CenterCountState, centerCountVec )
+
+static uint64_t centerCountKey( const uint mask, const char bottoms[3] ) {
+    return mask | ( uint64_t ) ( unsigned char ) bottoms[0] << 9 |
+           ( uint64_t ) ( unsigned char ) bottoms[1] << 17 |
+           ( uint64_t ) ( unsigned char ) bottoms[2] << 25;
+}
 
-    puzzle_findValidEdges( puzzle, edgeSolutions );
+static char centerCountKeyBottom( const uint64_t key, const uint column ) {
+    return ( char ) ( unsigned char ) ( key >> ( 9 + 8 * column ) );
+}
 
-    *maxUniqueIndexes = 0;
-    *maxUniqueSides = 0;
-    for ( uint i = 0; i < edgeSolutions->numElements; ++i ) {
-        uint temp = centerSolutions->numElements;
-        findValidCentersForEdge( puzzle, ( EdgeSolution* ) da_getElement( edgeSolutions, i ),
-                                 centerSolutions );
-        for  ( uint j = temp; j < centerSolutions->numElements; ++j ) {
+static int centerCountStateCompare( const void* p1, const void* p2 ) {
+    const uint64_t key1 = ( ( const CenterCountState* ) p1 )->key;
+    const uint64_t key2 = ( ( const CenterCountState* ) p2 )->key;
+    return ( key1 > key2 ) - ( key1 < key2 );
+}
+
+//add up the counts of equal keys, states ends up sorted and with every key once
+static void centerCountMerge( CenterCountStateVec* const states ) {
+    if ( states->numElements == 0 ) {
+        return;
+    }
+    qsort( states->contents, states->numElements, sizeof( CenterCountState ),
+           centerCountStateCompare );
+    size_t numMerged = 0;
+    for ( size_t i = 1; i < states->numElements; ++i ) {
+        CenterCountState* const last = centerCountVec_at( states, numMerged );
+        const CenterCountState* const state = centerCountVec_at( states, i );
+        if ( state->key == last->key ) {
+            last->count += state->count;
+        } else {
+            *centerCountVec_at( states, ++numMerged ) = *state;
+        }
+    }
+    states->numElements = numMerged + 1;
+}
+
+/*
+ * Number of ways to fill the center of edgeSolution with rows, by dynamic
+ * programming over the rows: a state only needs the Pieces used so far and the
+ * bottom sides of the last row, however it got there. With originalOnly, only
+ * rows holding the Pieces of the original row (in any rotation) are used.
+*/
+static uint64_t puzzle_countCenters( const Puzzle* const puzzle,
+                                     const EdgeSolution* const edgeSolution,
+                                     const TripleIndexVec* const rows,
+                                     const bool originalOnly ) {
+    static __thread CenterCountStateVec states[2];
+    static __thread bool allocatedStates = false;
+    if ( !allocatedStates ) {
+        centerCountVec_init( &states[0], 256 );
+        centerCountVec_init( &states[1], 256 );
+        allocatedStates = true;
+    }
+    CenterCountStateVec* current = &states[0];
+    CenterCountStateVec* next = &states[1];
+    centerCountVec_clear( current );
+    char tops[3];
+    for ( uint j = 0; j < 3; ++j ) {
+        tops[j] = piece_getSide( puzzle->pieces[( int ) edgeSolution->topEdgeIndexes[j]], BOTTOM );
+    }
+    centerCountVec_add( current, ( CenterCountState ) { .key = centerCountKey( 0, tops ),
+                                                        .count = 1 } );
+
+    uint64_t total = 0;
+    for ( uint currentRow = 0; currentRow < 3; ++currentRow ) {
+        const char leftEdge = piece_getSide( puzzle->pieces[( int ) edgeSolution->leftEdgeIndexes[currentRow]], BOTTOM );
+        const char rightEdge = piece_getSide( puzzle->pieces[( int ) edgeSolution->rightEdgeIndexes[currentRow]], BOTTOM );
+        centerCountVec_clear( next );
+        for ( size_t i = 0; i < rows->numElements; ++i ) {
+            const TripleIndex* const row = tripleVec_at( rows, i );
+            if ( originalOnly ) {
+                bool original = true;
+                for ( uint j = 0; j < 3; ++j ) {
+                    original &= row->indexes[j] == ( int ) ( currentRow + 1 ) * 5 + j + 1;
+                }
+                if ( !original ) {
+                    continue;
+                }
+            }
+            if ( !piece_piecesConnect( piece_getSideWithRotation( puzzle->pieces[( int ) row->indexes[0]], LEFT, row->rotations[0] ), leftEdge ) ||
+                 !piece_piecesConnect( piece_getSideWithRotation( puzzle->pieces[( int ) row->indexes[2]], RIGHT, row->rotations[2] ), rightEdge ) ) {
+                continue;
+            }
+            uint rowMask = 0;
+            char rowTops[3];
+            char rowBottoms[3];
+            bool valid = true;
+            for ( uint j = 0; j < 3; ++j ) {
+                const Piece piece = puzzle->pieces[( int ) row->indexes[j]];
+                rowMask |= 1u << centerPieceSlots[( int ) row->indexes[j]];
+                rowTops[j] = piece_getSideWithRotation( piece, TOP, row->rotations[j] );
+                rowBottoms[j] = piece_getSideWithRotation( piece, BOTTOM, row->rotations[j] );
+                if ( currentRow == 2 ) {
+                    valid &= piece_piecesConnect( rowBottoms[j],
+                        piece_getSide( puzzle->pieces[( int ) edgeSolution->bottomEdgeIndexes[j]], BOTTOM ) );
+                }
+            }
+            if ( !valid ) {
+                continue;
+            }
+
+            for ( size_t k = 0; k < current->numElements; ++k ) {
+                const CenterCountState* const state = centerCountVec_at( current, k );
+                if ( state->key & rowMask ) {
+                    continue;
+                }
+                bool fits = true;
+                for ( uint j = 0; j < 3; ++j ) {
+                    fits &= piece_piecesConnect( rowTops[j], centerCountKeyBottom( state->key, j ) );
+                }
+                if ( !fits ) {
+                    continue;
+                }
+                if ( currentRow == 2 ) {
+                    total += state->count;
+                } else {
+                    centerCountVec_add( next, ( CenterCountState ) {
+                        .key = centerCountKey( ( state->key & 0x1FF ) | rowMask, rowBottoms ),
+                        .count = state->count } );
+                }
+            }
+        }
+        centerCountMerge( next );
+        CenterCountStateVec* const temp = current;
+        current = next;
+        next = temp;
+    }
+    return total;
+}
+
+uint64_t puzzle_countCentersForEdge( const Puzzle* const puzzle,
+                                     const EdgeSolution* const edgeSolution ) {
+    static __thread bool allocatedCenters = false;
+    static __thread TripleIndexVec validCenterRows;
+    if ( !allocatedCenters ) {
+        tripleVec_init( &validCenterRows, 4000 );
+        allocatedCenters = true;
+    }
+    puzzle_centerRowsForEdge( puzzle, edgeSolution, &validCenterRows );
+    uint64_t count = puzzle_countCenters( puzzle, edgeSolution, &validCenterRows, false );
+    //same as findValidCentersForEdge, the original Pieces in any rotation aren't counted
+    if ( edgeSolutionIsOriginal( edgeSolution ) ) {
+        count -= puzzle_countCenters( puzzle, edgeSolution, &validCenterRows, true );
+    }
+    return count;
+}
+
+//Where the center stage puts what it finds, shared by both findValidSolutions drivers
+typedef struct SolutionSearch {
+    PuzzleSolution* otherSolutions;
+    uint* numOtherSolutions;
+    uint maxOtherSolutions;
+    uint* maxUniqueIndexes;
+    uint* maxUniqueSides;
+    PackedCenterSolutionVec* centerSolutions;
+    TripleIndexVec* centerRows;
+} SolutionSearch;
+
+/*
+ * Keep solution if it is an other solution (not every Piece touches the same
+ * Pieces as originally), returns false once there is more than one
+*/
+static bool search_add( SolutionSearch* const search, const PuzzleSolution* const solution,
+                        const uint numIndexConnections, const uint numSideConnections ) {
+    if ( numIndexConnections < 40 ) {
+        search->otherSolutions[*search->numOtherSolutions] = *solution;
+        ++*search->numOtherSolutions;
+        if ( ( 40 - numIndexConnections ) > *search->maxUniqueIndexes ) {
+            *search->maxUniqueIndexes = 40 - numIndexConnections;
+        }
+        if ( ( 40 - numSideConnections ) > *search->maxUniqueSides ) {
+            *search->maxUniqueSides = 40 - numSideConnections;
+        }
+        if ( *search->numOtherSolutions == search->maxOtherSolutions ) {
+            error_raise( ERROR_TOO_MANY_SOLUTIONS, "Too many total solutions" );
+        }
+    }
+    return *search->numOtherSolutions <= 1;
+}
+
+/*
+ * Run the center stage for every EdgeSolution in edgeSet. Full PuzzleSolutions are
+ * only built on the stack to be scored, and only kept if they are other solutions.
+ * Returns false once more than one other solution has been found.
+*/
+static bool puzzle_solveCenters( const Puzzle* const puzzle, const EdgeSet* const edgeSet,
+                                 void* const arg ) {
+    SolutionSearch* const search = arg;
+    for ( uint i = 0; i < edgeSet->solutions.numElements; ++i ) {
+        EdgeSolution edgeSolution;
+        puzzle_expandEdgeSolution( edgeSet, compactEdgeVec_at( &edgeSet->solutions, i ),
+                                   &edgeSolution );
+        packedCenterVec_clear( search->centerSolutions );
+        //the original layout is left out, so 2 centers for an edge is already 2 other
+        //solutions and the search stops there anyway. Without the cap a Puzzle with
+        //few connector values can have billions of them
+        findValidCentersForEdgeInRows( puzzle, &edgeSolution, search->centerRows,
+                                       search->centerSolutions, 2 );
+        for  ( uint j = 0; j < search->centerSolutions->numElements; ++j ) {
             PuzzleSolution solution;
-            puzzle_convertEdgeCenterToSolution( &solution,
-                                                ( EdgeSolution* ) da_getElement( edgeSolutions, i ),
-                                                ( CenterSolution* ) da_getElement( centerSolutions, j ) );
+            puzzle_convertEdgeCenterToSolution( &solution, &edgeSolution,
+                                                *packedCenterVec_at( search->centerSolutions, j ) );
             uint numIndexConnections = 0;
             uint numSideConnections = 0;
             puzzle_calculateOriginalConnections( puzzle, &solution,
                                                 &numIndexConnections,
                                                 &numSideConnections );
-            if ( numIndexConnections < 40 ) {
-                otherSolutions[*numOtherSolutions] = solution;
-                ++*numOtherSolutions;;
-                if ( ( 40 - numIndexConnections ) > *maxUniqueIndexes ) {
-                    *maxUniqueIndexes = 40 - numIndexConnections;
-                }
-                if ( ( 40 - numSideConnections ) > *maxUniqueSides ) {
-                    *maxUniqueSides = 40 - numSideConnections;
-                }
-                if ( *numOtherSolutions == maxOtherSolutions ) {
-                    fprintf( stderr, "Too many total solutions\n" );
-                    exit( 1 );
-                }
-            }
-            if ( *numOtherSolutions > 1 ) {
-                return;
+            if ( !search_add( search, &solution, numIndexConnections, numSideConnections ) ) {
+                return false;
             }
         }
+        if ( solveMeter.stopped ) {
+            return false;
+        }
     }
+    return true;
+}
+
+//EdgeSolutions are handed to the center stage a batch at a time, low connector
+//Puzzles can have millions of them and usually stop after the first few batches
+static const size_t edgeBatchSize = 1024;
+
+void solveWorkspace_init( SolveWorkspace* const workspace, const Allocator* const allocator ) {
+    *workspace = ( SolveWorkspace ) { .allocator = allocator };
+    const Allocator* const previous = memory_use( allocator );
+    edgeSet_init( &workspace->edgeSet, edgeBatchSize );
+    packedCenterVec_init( &workspace->centerSolutions, 256 );
+    tripleVec_init( &workspace->centerRows, 4000 );
+    memory_use( previous );
+}
+
+void solveWorkspace_free( SolveWorkspace* const workspace ) {
+    const Allocator* const previous = memory_use( workspace->allocator );
+    edgeSet_free( &workspace->edgeSet );
+    packedCenterVec_free( &workspace->centerSolutions );
+    tripleVec_free( &workspace->centerRows );
+    memory_use( previous );
+}
+
+static void puzzle_solveWith( SolveWorkspace* const workspace, const Puzzle* const puzzle,
+                              PuzzleSolution* const otherSolutions,
+                              uint* const numOtherSolutions, const uint maxOtherSolutions,
+                              uint* const maxUniqueIndexes, uint* const maxUniqueSides ) {
+    *maxUniqueIndexes = 0;
+    *maxUniqueSides = 0;
+    SolutionSearch search = { .otherSolutions = otherSolutions,
+                              .numOtherSolutions = numOtherSolutions,
+                              .maxOtherSolutions = maxOtherSolutions,
+                              .maxUniqueIndexes = maxUniqueIndexes,
+                              .maxUniqueSides = maxUniqueSides,
+                              .centerSolutions = &workspace->centerSolutions,
+                              .centerRows = &workspace->centerRows };
+    const EdgeBatchConsumer consumer = { .consume = puzzle_solveCenters, .arg = &search,
+                                         .batchSize = edgeBatchSize };
+    puzzle_findValidEdgesBatched( puzzle, &workspace->edgeSet, &consumer );
+}
+
+void puzzle_findValidSolutions( const Puzzle* const puzzle,
+                               PuzzleSolution* const otherSolutions,
+                               uint* const numOtherSolutions, const uint maxOtherSolutions,
+                               uint* const maxUniqueIndexes, uint* const maxUniqueSides ) {
+    //buffers are per thread, so separate threads can solve separate Puzzles
+    static __thread SolveWorkspace workspace;
+    static __thread bool allocatedArrays = false;
+    if ( !allocatedArrays ) {
+        //terrible idea, no real way to free this after
+        solveWorkspace_init( &workspace, NULL );
+        allocatedArrays = true;
+    }
+    puzzle_solveWith( &workspace, puzzle, otherSolutions, numOtherSolutions,
+                      maxOtherSolutions, maxUniqueIndexes, maxUniqueSides );
+}
+
+static void solveMeter_start( const SolveBudget* const budget ) {
+    solveMeter = ( SolveMeter ) { .maxNodes = budget->maxNodes,
+                                  .deadline = budget->maxNanoseconds ?
+                                              monotonicNanoseconds() + budget->maxNanoseconds : 0 };
+    //starts the first window
+    solveMeter_check();
+}
+
+//put the meter back to never stopping, and say whether the solve finished
+static SolveVerdict solveMeter_finish( SolveBudgetStats* const stats ) {
+    const SolveMeter used = solveMeter;
+    solveMeter = ( SolveMeter ) { .countdown = UINT64_MAX };
+
+    if ( stats ) {
+        ++stats->numSolves;
+        stats->numNodes += used.numNodes + ( used.stopped ? 0 : used.window - used.countdown );
+        stats->numOutOfNodes += used.outOfNodes;
+        stats->numOutOfTime += used.outOfTime;
+    }
+    return used.stopped ? SOLVE_UNKNOWN : SOLVE_COMPLETE;
+}
+
+SolveVerdict puzzle_findValidSolutionsBudgeted( const Puzzle* const puzzle,
+                                                const SolveBudget* const budget,
+                                                SolveBudgetStats* const stats,
+                                                PuzzleSolution* const otherSolutions,
+                                                uint* const numOtherSolutions,
+                                                const uint maxOtherSolutions,
+                                                uint* const maxUniqueIndexes,
+                                                uint* const maxUniqueSides ) {
+    solveMeter_start( budget );
+    puzzle_findValidSolutions( puzzle, otherSolutions, numOtherSolutions, maxOtherSolutions,
+                               maxUniqueIndexes, maxUniqueSides );
+    return solveMeter_finish( stats );
+}
+
+ErrorCode puzzle_solveInWorkspace( SolveWorkspace* const workspace, const Puzzle* const puzzle,
+                                   const SolveBudget* const budget, SolveBudgetStats* const stats,
+                                   SolveVerdict* const verdict,
+                                   PuzzleSolution* const otherSolutions,
+                                   uint* const numOtherSolutions, const uint maxOtherSolutions,
+                                   uint* const maxUniqueIndexes, uint* const maxUniqueSides ) {
+    const Allocator* const previous = memory_use( workspace->allocator );
+    ErrorTarget target;
+    error_push( &target );
+    if ( setjmp( target.jump ) ) {
+        //the meter may have been mid solve
+        solveMeter = ( SolveMeter ) { .countdown = UINT64_MAX };
+        memory_use( previous );
+        return target.code;
+    }
+    if ( budget ) {
+        solveMeter_start( budget );
+    }
+    puzzle_solveWith( workspace, puzzle, otherSolutions, numOtherSolutions, maxOtherSolutions,
+                      maxUniqueIndexes, maxUniqueSides );
+    *verdict = budget ? solveMeter_finish( stats ) : SOLVE_COMPLETE;
+    error_pop( &target );
+    memory_use( previous );
+    return ERROR_NONE;
+}
+
+void solveBudget_printStats( const SolveBudgetStats* const stats ) {
+    printf( "Solve budget: %" PRIu64 " solves, %" PRIu64 " out of nodes, %" PRIu64
+            " out of time (%.1f%% unknown), %.0f nodes per solve\n", stats->numSolves,
+            stats->numOutOfNodes, stats->numOutOfTime,
+            stats->numSolves ?
+            ( stats->numOutOfNodes + stats->numOutOfTime ) * 100.0 / stats->numSolves : 0.0,
+            stats->numSolves ? stats->numNodes * 1.0 / stats->numSolves : 0.0 );
 }
 
 static void puzzle_setPieces( Puzzle* const puzzle ) {
@@ -853,45 +1376,69 @@ static void puzzle_setPieces2( Puzzle* const puzzle ) {
                                              0, puzzle->connections[20] );
         } else if ( i == 4 ) {
             puzzle->pieces[4] = piece_create( CORNER, i, 0, puzzle->connections[24],
-                                             0, puzzle->connections[15] );
+                                             0, piece_complement( puzzle->connections[15] ) );
         } else if ( i == 20 ) {
-            puzzle->pieces[20] = piece_create( CORNER, i, 0, puzzle->connections[35],
+            puzzle->pieces[20] = piece_create( CORNER, i, 0, piece_complement( puzzle->connections[35] ),
                                               0, puzzle->connections[4] );
         } else if ( i == 24 ) {
-            puzzle->pieces[24] = piece_create( CORNER, i, 0, puzzle->connections[19],
-                                              0, puzzle->connections[39] );
+            puzzle->pieces[24] = piece_create( CORNER, i, 0, piece_complement( puzzle->connections[19] ),
+                                              0, piece_complement( puzzle->connections[39] ) );
         } else if ( i < 4 ) { //top edge
             puzzle->pieces[i] = piece_create( EDGE, i, 0, puzzle->connections[i * 5],
                                              puzzle->connections[i + 20],
-                                             puzzle->connections[( i - 1 ) * 5] );
+                                             piece_complement( puzzle->connections[( i - 1 ) * 5] ) );
         } else if ( i % 5 == 0 ) { //left edge
-            puzzle->pieces[i] = piece_create( EDGE, i, 0, puzzle->connections[i + 15],
+            puzzle->pieces[i] = piece_create( EDGE, i, 0, piece_complement( puzzle->connections[i + 15] ),
                                              puzzle->connections[i / 5],
                                              puzzle->connections[i + 20] );
         } else if ( ( i - 4) % 5 == 0 ) { //right edge
             puzzle->pieces[i] = piece_create( EDGE, i, 0, puzzle->connections[i + 20],
-                                             puzzle->connections[( i + 1 ) / 5 + 14],
-                                             puzzle->connections[i + 15] );
+                                             piece_complement( puzzle->connections[( i + 1 ) / 5 + 14] ),
+                                             piece_complement( puzzle->connections[i + 15] ) );
         } else if ( i > 20 && i < 24 ) { //bottom edge
-            puzzle->pieces[i] = piece_create( EDGE, i, 0, puzzle->connections[( i - 21 ) * 5 + 4],
-                                             puzzle->connections[i + 15],
+            puzzle->pieces[i] = piece_create( EDGE, i, 0, piece_complement( puzzle->connections[( i - 21 ) * 5 + 4] ),
+                                             piece_complement( puzzle->connections[i + 15] ),
                                              puzzle->connections[( i - 20 ) * 5 + 4] );
         } else {
             uint row = i / 5;
             uint col = i % 5;
-            puzzle->pieces[i] = piece_create( CENTER, i, puzzle->connections[i + 15],
+            puzzle->pieces[i] = piece_create( CENTER, i, piece_complement( puzzle->connections[i + 15] ),
                                              puzzle->connections[5 * col + row],
                                              puzzle->connections[i + 20],
-                                             puzzle->connections[5 * ( col - 1 ) + row] );
+                                             piece_complement( puzzle->connections[5 * ( col - 1 ) + row] ) );
         }
     }
+    puzzle->dirtyConnections = ( 1ull << 40 ) - 1;
 }
 
+void puzzle_setConnection( Puzzle* const puzzle, const uint connection, const char value ) {
+    puzzle->connections[connection] = value;
+    const PieceSide* const pieceSides = connectionSides[connection];
+    piece_setSide( &puzzle->pieces[( int ) pieceSides[0].piece], pieceSides[0].side, value );
+    piece_setSide( &puzzle->pieces[( int ) pieceSides[1].piece], pieceSides[1].side,
+                   piece_complement( value ) );
+    puzzle->dirtyConnections |= 1ull << connection;
+}
+
+void puzzle_swapConnections( Puzzle* const puzzle, const uint connection1,
+                             const uint connection2 ) {
+    const char value1 = puzzle->connections[connection1];
+    const char value2 = puzzle->connections[connection2];
+    if ( value1 == value2 ) {
+        return;
+    }
+    puzzle_setConnection( puzzle, connection1, value2 );
+    puzzle_setConnection( puzzle, connection2, value1 );
+}
+
+//connections that only touch center Pieces
+static const uint validCenterConnections[24] = { 21, 22, 23, 1, 6, 11, 16, 2, 7, 12, 17,
+                                                 3, 8, 13, 18, 26, 27, 28, 31, 32, 33,
+                                                 36, 37, 38 };
+
 void puzzle_mutateCenter( Puzzle* const destPuzzle, const Puzzle* const srcPuzzle, const uint minMutations, const uint maxMutations ) {
-    const static uint validCenterConnections[24] = { 21, 22, 23, 1, 6, 11, 16, 2, 7, 12, 17,
-                                                   3, 8, 13, 18, 26, 27, 28, 31, 32, 33,
-                                                   36, 37, 38 };
     memcpy( destPuzzle, srcPuzzle, sizeof( Puzzle ) );
+    destPuzzle->dirtyConnections = 0;
     uint numMutations = rand_intBetween( minMutations, maxMutations + 1 );
     while ( numMutations ) {
         int firstIndex = 0;
@@ -900,9 +1447,7 @@ void puzzle_mutateCenter( Puzzle* const destPuzzle, const Puzzle* const srcPuzzl
             firstIndex = validCenterConnections[rand_index( 24 )];
             secondIndex = validCenterConnections[rand_index( 24 )];
         }
-        char temp = destPuzzle->connections[firstIndex];
-        destPuzzle->connections[firstIndex] = destPuzzle->connections[secondIndex];
-        destPuzzle->connections[secondIndex] = temp;
+        puzzle_swapConnections( destPuzzle, firstIndex, secondIndex );
         --numMutations;
         if ( numMutations == 0 ) {
             if ( memcmp( srcPuzzle->connections, destPuzzle->connections, sizeof( char ) * 40 ) == 0 ) {
@@ -910,7 +1455,6 @@ void puzzle_mutateCenter( Puzzle* const destPuzzle, const Puzzle* const srcPuzzl
             }
         }
     }
-    puzzle_setPieces2( destPuzzle );
 }
 
 void puzzle_shuffle( Puzzle* const puzzle ) {
@@ -919,16 +1463,19 @@ void puzzle_shuffle( Puzzle* const puzzle ) {
     const uint numEach = 2; //need to be at least 2 of each so they can swap with each other
     const int numLeftOver = 40 - numUniqueConnectors * numEach; 
     if ( numLeftOver < 0 ) {
-        fprintf( stderr, "Cannot create a puzzle with %i unique connectors (will not have multiple solutions)\n", numUniqueConnectors );
-        fprintf( stderr, "Max number of unique connections: %i\n", numUniqueConnectors / 2 );
-        exit( 1 );
+        error_raise( ERROR_INVALID_ARGUMENT,
+                     "Cannot create a puzzle with %i unique connectors (will not have multiple solutions)\n"
+                     "Max number of unique connections: %i", numUniqueConnectors, 40 / numEach );
     }
 
     for ( uint i = 0; i < numUniqueConnectors; ++i ) {
         for ( uint j = 0; j < numEach; ++j ) {
             puzzle->connections[i * numEach + j] = i + 1;            
+            //drawn either way so both builds shuffle the same values
             if ( rand_float() < 0.5 ) {
-                //puzzle->connections[i * numEach + j] *= -1;
+#ifdef SIGNED_CONNECTORS
+                puzzle->connections[i * numEach + j] *= -1;
+#endif
             }
         }
     }
@@ -936,7 +1483,9 @@ void puzzle_shuffle( Puzzle* const puzzle ) {
     for ( uint i = 0; i < numLeftOver; ++i ) {
         puzzle->connections[40  - numLeftOver + i] = rand_intBetween( 1, numUniqueConnectors + 1 );
         if ( rand_float() < 0.5 ) {
-            //puzzle->connections[40 - numLeftOver + i] *= -1;
+#ifdef SIGNED_CONNECTORS
+            puzzle->connections[40 - numLeftOver + i] *= -1;
+#endif
         }
     }
 
@@ -945,15 +1494,43 @@ void puzzle_shuffle( Puzzle* const puzzle ) {
     puzzle_setPieces2( puzzle );
 }
 
+void puzzle_init( Puzzle* const puzzle, const uint numUniqueConnectors ) {
+    puzzle->numUniqueConnectors = numUniqueConnectors;
+
+    puzzle_shuffle( puzzle );
+}
+
+void puzzle_initFromConnections( Puzzle* const puzzle, const char connections[40],
+                                 const uint numUniqueConnectors ) {
+    puzzle->numUniqueConnectors = numUniqueConnectors;
+    memcpy( puzzle->connections, connections, sizeof( char ) * 40 );
+    puzzle_setPieces2( puzzle );
+}
+
+bool puzzle_connectionsValid( const char connections[40], const uint numUniqueConnectors ) {
+    if ( numUniqueConnectors == 0 || numUniqueConnectors > PUZZLE_MAX_CONNECTORS ) {
+        return false;
+    }
+    for ( uint i = 0; i < 40; ++i ) {
+#ifdef SIGNED_CONNECTORS
+        const int connector = abs( connections[i] );
+#else
+        const int connector = connections[i];
+#endif
+        if ( connector < 1 || connector > ( int ) numUniqueConnectors ) {
+            return false;
+        }
+    }
+    return true;
+}
+
 Puzzle* puzzle_create( const uint numUniqueConnectors ) {
     Puzzle* puzzle = malloc( sizeof( Puzzle ) );
     if ( !puzzle ) {
         fprintf( stderr, "Could not allocate Puzzle\n" );
         exit( 1 );
     }
-    puzzle->numUniqueConnectors = numUniqueConnectors;
-
-    puzzle_shuffle( puzzle );
+    puzzle_init( puzzle, numUniqueConnectors );
 
     return puzzle;
 }
@@ -961,6 +1538,7 @@ Puzzle* puzzle_create( const uint numUniqueConnectors ) {
 void puzzle_mutate( Puzzle* const destPuzzle, const Puzzle* const srcPuzzle,
                    const uint minMutations, const uint maxMutations ) {
     memcpy( destPuzzle, srcPuzzle, sizeof( Puzzle ) );
+    destPuzzle->dirtyConnections = 0;
     uint numMutations = rand_intBetween( minMutations, maxMutations + 1 );
     while ( numMutations ) {
         int firstIndex = 0;
@@ -969,9 +1547,7 @@ void puzzle_mutate( Puzzle* const destPuzzle, const Puzzle* const srcPuzzle,
             firstIndex = rand_index( 40 );
             secondIndex = rand_index( 40 );
         }
-        char temp = destPuzzle->connections[firstIndex];
-        destPuzzle->connections[firstIndex] = destPuzzle->connections[secondIndex];
-        destPuzzle->connections[secondIndex] = temp;
+        puzzle_swapConnections( destPuzzle, firstIndex, secondIndex );
         --numMutations;
         if ( numMutations == 0 ) {
             if ( memcmp( srcPuzzle->connections, destPuzzle->connections, sizeof( char ) * 40 ) == 0 ) {
@@ -979,100 +1555,325 @@ void puzzle_mutate( Puzzle* const destPuzzle, const Puzzle* const srcPuzzle,
             }
         }
     }
-    puzzle_setPieces2( destPuzzle );
 }
 
-typedef struct PuzzleSum {
-    Puzzle* puzzle;
-    uint sum;
-    uint numUniqueSides;
-    uint numUniqueIndexes;
-} PuzzleSum;
+void compactPuzzle_fromPuzzle( CompactPuzzle* const compact, const Puzzle* const puzzle ) {
+    memcpy( compact->connections, puzzle->connections, sizeof( compact->connections ) );
+}
+
+//past this many changed connections, rebuilding every Piece is cheaper
+#define VIEW_MAX_CHANGED_CONNECTIONS 8
+
+static __thread Puzzle viewPuzzle;
+static __thread bool viewPuzzleSet = false;
+
+const Puzzle* compactPuzzle_view( const CompactPuzzle* const compact,
+                                  const uint numUniqueConnectors ) {
+    uint changed[40];
+    uint numChanged = 0;
+    if ( viewPuzzleSet ) {
+        for ( uint i = 0; i < 40; ++i ) {
+            if ( viewPuzzle.connections[i] != compact->connections[i] ) {
+                changed[numChanged++] = i;
+            }
+        }
+    }
+    viewPuzzle.numUniqueConnectors = numUniqueConnectors;
+    const bool rebuild = !viewPuzzleSet || numChanged > VIEW_MAX_CHANGED_CONNECTIONS;
+    telemetry_add( rebuild ? TELEMETRY_CACHE_MISSES : TELEMETRY_CACHE_HITS, 1 );
+    if ( rebuild ) {
+        puzzle_initFromConnections( &viewPuzzle, compact->connections, numUniqueConnectors );
+        viewPuzzleSet = true;
+    } else {
+        viewPuzzle.dirtyConnections = 0;
+        for ( uint i = 0; i < numChanged; ++i ) {
+            puzzle_setConnection( &viewPuzzle, changed[i], compact->connections[changed[i]] );
+        }
+    }
+    return &viewPuzzle;
+}
+
+void compactPuzzle_generate( CompactPuzzle* const compact, const uint numUniqueConnectors,
+                             const PuzzleGenerator generate ) {
+    viewPuzzle.numUniqueConnectors = numUniqueConnectors;
+    generate( &viewPuzzle );
+    viewPuzzleSet = true;
+    compactPuzzle_fromPuzzle( compact, &viewPuzzle );
+}
+
+//mutate with connections picked from the numConnections in choices
+static void compactPuzzle_mutateFrom( CompactPuzzle* const dest, const CompactPuzzle* const src,
+                                      const uint minMutations, const uint maxMutations,
+                                      const uint* const choices, const uint numConnections ) {
+    *dest = *src;
+    uint numMutations = rand_intBetween( minMutations, maxMutations + 1 );
+    while ( numMutations ) {
+        int firstIndex = 0;
+        int secondIndex = 0;
+        while ( firstIndex == secondIndex ) {
+            firstIndex = choices[rand_index( numConnections )];
+            secondIndex = choices[rand_index( numConnections )];
+        }
+        const char temp = dest->connections[firstIndex];
+        dest->connections[firstIndex] = dest->connections[secondIndex];
+        dest->connections[secondIndex] = temp;
+        --numMutations;
+        if ( numMutations == 0 ) {
+            if ( memcmp( src->connections, dest->connections, sizeof( char ) * 40 ) == 0 ) {
+                numMutations = 1;
+            }
+        }
+    }
+}
+
+void compactPuzzle_mutate( CompactPuzzle* const dest, const CompactPuzzle* const src,
+                           const uint minMutations, const uint maxMutations ) {
+    static const uint allConnections[40] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+        14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+        35, 36, 37, 38, 39 };
+    compactPuzzle_mutateFrom( dest, src, minMutations, maxMutations, allConnections, 40 );
+}
 
-static int puzzleSumSortDescending( const void* p1, const void* p2 ) {
-    PuzzleSum* puzzleSum1 = ( PuzzleSum* ) p1;
-    PuzzleSum* puzzleSum2 = ( PuzzleSum* ) p2;
-    return puzzleSum2->sum - puzzleSum1->sum;
+void compactPuzzle_mutateCenter( CompactPuzzle* const dest, const CompactPuzzle* const src,
+                                 const uint minMutations, const uint maxMutations ) {
+    compactPuzzle_mutateFrom( dest, src, minMutations, maxMutations, validCenterConnections,
+                              24 );
 }
 
-static int puzzleSidesSortDescending( const void* p1, const void* p2 ) {
-    PuzzleSum* puzzleSum1 = ( PuzzleSum* ) p1;
-    PuzzleSum* puzzleSum2 = ( PuzzleSum* ) p2;
-    return puzzleSum2->numUniqueSides - puzzleSum1->numUniqueSides;
+//a connection of dest that can be changed to a connector that is short without
+//making its own connector short, preferring the center ones
+static uint crossover_spareConnection( const CompactPuzzle* const dest, const uint* const counts ) {
+    uint spare[40];
+    uint numSpare = 0;
+    for ( uint i = 0; i < 24; ++i ) {
+        const uint connection = validCenterConnections[i];
+        if ( counts[abs( dest->connections[connection] )] > 2 ) {
+            spare[numSpare++] = connection;
+        }
+    }
+    //only if the edge ring holds every extra copy
+    for ( uint i = 0; i < 40 && numSpare == 0; ++i ) {
+        if ( counts[abs( dest->connections[i] )] > 2 ) {
+            spare[numSpare++] = i;
+        }
+    }
+    return spare[rand_index( numSpare )];
 }
 
-static int puzzleIndexesSortDescending( const void* p1, const void* p2 ) {
-    PuzzleSum* puzzleSum1 = ( PuzzleSum* ) p1;
-    PuzzleSum* puzzleSum2 = ( PuzzleSum* ) p2;
-    return puzzleSum2->numUniqueIndexes - puzzleSum1->numUniqueIndexes;
+void compactPuzzle_crossover( CompactPuzzle* const dest, const CompactPuzzle* const edgeParent,
+                              const CompactPuzzle* const centerParent,
+                              const uint numUniqueConnectors ) {
+    uint counts[PUZZLE_MAX_CONNECTORS + 1] = { 0 };
+    for ( uint i = 0; i < 40; ++i ) {
+        const bool ring = ( PUZZLE_EDGE_RING_CONNECTIONS >> i ) & 1;
+        dest->connections[i] = ( ring ? edgeParent : centerParent )->connections[i];
+        ++counts[abs( dest->connections[i] )];
+    }
+    //40 connections and at most 20 connectors, so while one is short another has spares
+    for ( uint connector = 1; connector <= numUniqueConnectors; ++connector ) {
+        while ( counts[connector] < 2 ) {
+            const uint connection = crossover_spareConnection( dest, counts );
+            --counts[abs( dest->connections[connection] )];
+            dest->connections[connection] = dest->connections[connection] < 0 ?
+                                            -( char ) connector : ( char ) connector;
+            ++counts[connector];
+        }
+    }
 }
 
-void puzzle_findMostUniqueSolution( const uint numUniqueConnections,
-                                   const uint generationSize,
-                                   const uint numGenerations,
-                                   const uint numSurvivors, const uint numChildren,
-                                   const uint minMutations, const uint maxMutations ) {
-    PuzzleSum* generation = malloc( sizeof( PuzzleSum ) * generationSize );
+//which bandit arm made a GA Puzzle, and what the parent it was made from scored
+typedef struct MutationOrigin {
+    uint arm; //MUTATION_BANDIT_NO_ARM for a generated Puzzle
+    uint parentSum;
+} MutationOrigin;
+
+static double threadCpuSeconds() {
+    struct timespec now;
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &now );
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+//Ranking entry for a GA generation, sorting these moves 8 bytes per Puzzle
+//instead of the Puzzle itself
+typedef struct ScoreIndex {
+    uint score;
+    uint index;
+} ScoreIndex;
+
+static int scoreIndexSortDescending( const void* p1, const void* p2 ) {
+    const ScoreIndex* scoreIndex1 = ( ScoreIndex* ) p1;
+    const ScoreIndex* scoreIndex2 = ( ScoreIndex* ) p2;
+    return scoreIndex2->score - scoreIndex1->score;
+}
+
+/*
+ * The population lives in one Arena: a parent and a child buffer of CompactPuzzles
+ * that are swapped every generation, and the scores of the parents as parallel
+ * arrays. Each parent's Pieces are only made (by compactPuzzle_view) to solve it.
+ * Everything that only lives for one generation (the ranking, solution buffer)
+ * comes from a second Arena that is reset at the start of each generation.
+*/
+bool puzzle_findMostUniqueSolution( const GaConfig* const config, ResultRecord* const best ) {
+    const uint generationSize = config->generationSize;
+    const uint maxOtherSolutions = 100;
+    Arena* population = arena_create( ( sizeof( CompactPuzzle ) * 2 + sizeof( uint ) * 3 +
+                                        sizeof( MutationOrigin ) * 2 ) *
+                                      generationSize + ARENA_ALIGNMENT * 7 );
+    CompactPuzzle* parents = arena_alloc( population, sizeof( CompactPuzzle ) * generationSize );
+    CompactPuzzle* children = arena_alloc( population, sizeof( CompactPuzzle ) * generationSize );
+    uint* sums = arena_alloc( population, sizeof( uint ) * generationSize );
+    uint* numUniqueSides = arena_alloc( population, sizeof( uint ) * generationSize );
+    uint* numUniqueIndexes = arena_alloc( population, sizeof( uint ) * generationSize );
+    //kept in step with parents / children, only used with a bandit
+    MutationOrigin* parentOrigins = arena_alloc( population,
+                                                 sizeof( MutationOrigin ) * generationSize );
+    MutationOrigin* childOrigins = arena_alloc( population,
+                                                sizeof( MutationOrigin ) * generationSize );
+
+    Arena* scratch = arena_create( sizeof( ScoreIndex ) * generationSize +
+                                   sizeof( PuzzleSolution ) * maxOtherSolutions +
+                                   ARENA_ALIGNMENT * 2 );
+
     for ( uint i = 0; i < generationSize; ++i ) {
-        generation[i].puzzle = puzzle_create( numUniqueConnections ); 
-        generation[i].sum = 0;
+        compactPuzzle_generate( &parents[i], config->numUniqueConnectors, config->generate );
+        parentOrigins[i] = ( MutationOrigin ) { .arm = MUTATION_BANDIT_NO_ARM };
     }
 
+    const clock_t startClock = clock();
+    const uint64_t deadline = config->maxSeconds > 0 ?
+                              monotonicNanoseconds() +
+                              ( uint64_t ) ( config->maxSeconds * 1e9 ) : 0;
+    bool outOfTime = false;
     uint bestComparison = 0;
     bool foundBestSides = false;
-    for ( uint i = 0; i < numGenerations; ++i ) {
+    bool foundBest = false;
+    uint bestSum = 0;
+    PrefilterStats prefilterStats = { 0 };
+    SolveBudgetStats solveBudgetStats = { 0 };
+    for ( uint i = 0; i < config->numGenerations && !outOfTime; ++i ) {
+        const uint64_t generationStart = monotonicNanoseconds();
         //printf( "Starting Generation: %u/%u\n", i + 1, numGenerations );
+        arena_reset( scratch );
+        ScoreIndex* ranking = arena_alloc( scratch, sizeof( ScoreIndex ) * generationSize );
+        PuzzleSolution* solutions = arena_alloc( scratch, sizeof( PuzzleSolution ) * maxOtherSolutions );
+
         uint bestInGeneration = 0;
-        PuzzleSolution best;
+        PuzzleSolution bestSolution;
         uint totalSum = 0;
+        uint numEvaluated = 0;
         for ( uint j = 0; j < generationSize; ++j ) {
+            if ( deadline && monotonicNanoseconds() >= deadline ) {
+                outOfTime = true;
+                break;
+            }
+            ++numEvaluated;
+            const bool credit = config->bandit && parentOrigins[j].arm != MUTATION_BANDIT_NO_ARM;
+            const double evaluationStart = credit ? threadCpuSeconds() : 0;
             uint maxUniqueIndexes = 0;
             uint maxUniqueSides = 0;
-            uint maxOtherSolutions = 100;
             uint numOtherSolutions = 0;
-            PuzzleSolution solutions[maxOtherSolutions];
-            puzzle_findValidSolutions( generation[j].puzzle, solutions,
-                                      &numOtherSolutions, maxOtherSolutions,
-                                      &maxUniqueIndexes, &maxUniqueSides );
-            if ( numOtherSolutions != 1 ) {
-                generation[j].sum = 0;
-                generation[j].numUniqueSides = 0;
-                generation[j].numUniqueIndexes = 0;
+            SolveVerdict verdict = SOLVE_COMPLETE;
+            const Puzzle* const puzzle = compactPuzzle_view( &parents[j],
+                                                             config->numUniqueConnectors );
+            telemetry_add( TELEMETRY_EVALUATIONS, 1 );
+            if ( !prefilter_mayHaveOtherSolution( puzzle, &prefilterStats ) ) {
+                telemetry_add( TELEMETRY_PREFILTER_REJECTED, 1 );
+            } else if ( config->solveBudget ) {
+                verdict = puzzle_findValidSolutionsBudgeted( puzzle, config->solveBudget,
+                                                             &solveBudgetStats, solutions,
+                                                             &numOtherSolutions,
+                                                             maxOtherSolutions,
+                                                             &maxUniqueIndexes, &maxUniqueSides );
+            } else if ( config->edgeCache ) {
+                const bool hit = edgeRingCache_findValidSolutions( config->edgeCache, puzzle,
+                                                                   solutions,
+                                                                   &numOtherSolutions,
+                                                                   maxOtherSolutions,
+                                                                   &maxUniqueIndexes,
+                                                                   &maxUniqueSides );
+                telemetry_add( hit ? TELEMETRY_EDGE_CACHE_HITS : TELEMETRY_EDGE_CACHE_MISSES, 1 );
+            } else {
+                puzzle_findValidSolutions( puzzle, solutions,
+                                          &numOtherSolutions, maxOtherSolutions,
+                                          &maxUniqueIndexes, &maxUniqueSides );
+            }
+            telemetry_countSolve( numOtherSolutions, verdict == SOLVE_UNKNOWN );
+            //an unfinished solve could still have more other solutions
+            const bool scored = numOtherSolutions == 1 && verdict != SOLVE_UNKNOWN;
+            if ( credit ) {
+                const uint childSum = scored ? maxUniqueSides + maxUniqueIndexes : 0;
+                const uint parentSum = parentOrigins[j].parentSum;
+                mutationBandit_credit( config->bandit, parentOrigins[j].arm,
+                                       childSum > parentSum ? childSum - parentSum : 0,
+                                       threadCpuSeconds() - evaluationStart );
+            }
+            if ( !scored ) {
+                sums[j] = 0;
+                numUniqueSides[j] = 0;
+                numUniqueIndexes[j] = 0;
                 continue;
             }
             uint sum = maxUniqueSides + maxUniqueIndexes;
+            const bool newBest = !foundBest || sum > bestSum;
+            if ( config->resultLog || config->hallOfFame || ( best && newBest ) ) {
+                const ResultRecord record = result_create( puzzle, &solutions[0],
+                                                           maxUniqueSides, maxUniqueIndexes,
+                                                           RESULT_GA, 0, i );
+                if ( config->resultLog ) {
+                    resultLog_append( config->resultLog, &record );
+                }
+                if ( config->hallOfFame ) {
+                    hallOfFame_offer( config->hallOfFame, &record );
+                }
+                if ( best && newBest ) {
+                    *best = record;
+                }
+            }
+            if ( newBest ) {
+                foundBest = true;
+                bestSum = sum;
+                telemetry_offerBest( sum );
+            }
             uint comparison = foundBestSides ? sum : maxUniqueSides;
             if ( comparison > bestInGeneration ) {
                 bestInGeneration = comparison;
-                best = solutions[0];
+                bestSolution = solutions[0];
             }
             totalSum += sum;
 
-            generation[j].sum = sum;
-            generation[j].numUniqueSides = maxUniqueSides;
-            generation[j].numUniqueIndexes = maxUniqueIndexes;
+            sums[j] = sum;
+            numUniqueSides[j] = maxUniqueSides;
+            numUniqueIndexes[j] = maxUniqueIndexes;
+        }
+        if ( outOfTime ) {
+            //the rest of the generation was never scored, so it can't be ranked
+            printf( "Out of time in generation %u/%u after %u Puzzles\n", i + 1,
+                    config->numGenerations, numEvaluated );
+            break;
         }
 
-        if ( foundBestSides ) {
-            qsort( generation, generationSize, sizeof( PuzzleSum ), puzzleSumSortDescending );
-        } else {
-            qsort( generation, generationSize, sizeof( PuzzleSum ), puzzleSidesSortDescending );
+        for ( uint j = 0; j < generationSize; ++j ) {
+            ranking[j] = ( ScoreIndex ) { .score = foundBestSides ? sums[j] : numUniqueSides[j],
+                                          .index = j };
         }
-        uint comparison = foundBestSides ? generation[0].sum : generation[0].numUniqueSides;
-        if ( comparison > bestComparison || generation[0].numUniqueSides == 40 ) {
+        qsort( ranking, generationSize, sizeof( ScoreIndex ), scoreIndexSortDescending );
+
+        const uint top = ranking[0].index;
+        uint comparison = ranking[0].score;
+        if ( comparison > bestComparison || numUniqueSides[top] == 40 ) {
             bestComparison = comparison;
             if ( !foundBestSides && comparison == 40 ) {
                 foundBestSides = true;
             }
-            printf( "Starting Generation: %u/%u\n", i + 1, numGenerations );
-            puzzle_printSolution( &best );
-            printf( "Best Sum of Uniques: %u\n", generation[0].sum );
-            printf( "Unique Sides: %u\n", generation[0].numUniqueSides );
-            printf( "Unique Indexes: %u\n", generation[0].numUniqueIndexes );
+            printf( "Starting Generation: %u/%u\n", i + 1, config->numGenerations );
+            puzzle_printSolution( &bestSolution );
+            printf( "Best Sum of Uniques: %u\n", sums[top] );
+            printf( "Unique Sides: %u\n", numUniqueSides[top] );
+            printf( "Unique Indexes: %u\n", numUniqueIndexes[top] );
             printf( "Average: %.2f\n", totalSum * 1.0 / generationSize ); 
             float last100Average = 0;
             for ( uint i = 0; i < 100; ++i ) {
-                last100Average += generation[i].sum;
+                last100Average += sums[ranking[i].index];
             }
             last100Average /= 100.0;
             printf( "Last 100 Average: %.2f\n", last100Average );
@@ -1080,24 +1881,73 @@ void puzzle_findMostUniqueSolution( const uint numUniqueConnections,
                 if ( j ) {
                     printf( ", " );
                 }
-                printf( "%i", generation[0].puzzle->connections[j] );
+                printf( "%i", parents[top].connections[j] );
             }
             printf( "\n" );
         }
 
-        uint index = numSurvivors;
-        for ( uint j = 0; j < numSurvivors; ++j ) {
-            for ( uint k = 0; k < numChildren; ++k ) {
-                puzzle_mutate( generation[index].puzzle, generation[j].puzzle,
-                              minMutations, maxMutations );
+        if ( config->bandit ) {
+            mutationBandit_endGeneration( config->bandit );
+        }
+        //survivors' slots get fresh generated Puzzles, their children follow them
+        uint index = config->numSurvivors;
+        for ( uint j = 0; j < config->numSurvivors; ++j ) {
+            const uint parent = ranking[j].index;
+            for ( uint k = 0; k < config->numChildren; ++k ) {
+                //only drawn with crossover on, so runs without it keep their draws
+                if ( config->crossoverRate > 0 && config->numSurvivors > 1 &&
+                     rand_float() < config->crossoverRate ) {
+                    uint other = rand_index( config->numSurvivors - 1 );
+                    other += other >= j;
+                    compactPuzzle_crossover( &children[index], &parents[parent],
+                                             &parents[ranking[other].index],
+                                             config->numUniqueConnectors );
+                    //parents with the same centers give back the edge parent
+                    if ( memcmp( &children[index], &parents[parent], sizeof( CompactPuzzle ) ) == 0 ) {
+                        const CompactPuzzle crossed = children[index];
+                        compactPuzzle_mutateCenter( &children[index], &crossed, 1, 1 );
+                    }
+                    childOrigins[index] = ( MutationOrigin ) { .arm = MUTATION_BANDIT_NO_ARM };
+                } else if ( config->bandit ) {
+                    const uint arm = mutationBandit_choose( config->bandit );
+                    mutationBandit_mutate( config->bandit, arm, &children[index],
+                                           &parents[parent] );
+                    childOrigins[index] = ( MutationOrigin ) { .arm = arm,
+                                                               .parentSum = sums[parent] };
+                } else {
+                    compactPuzzle_mutate( &children[index], &parents[parent],
+                                          config->minMutations, config->maxMutations );
+                }
                 ++index;
             }
-            puzzle_shuffle( generation[j].puzzle );
+            compactPuzzle_generate( &children[j], config->numUniqueConnectors, config->generate );
+            childOrigins[j] = ( MutationOrigin ) { .arm = MUTATION_BANDIT_NO_ARM };
         }
         for ( uint j = index; j < generationSize; ++j ) {
-            puzzle_shuffle( generation[j].puzzle );
+            compactPuzzle_generate( &children[j], config->numUniqueConnectors, config->generate );
+            childOrigins[j] = ( MutationOrigin ) { .arm = MUTATION_BANDIT_NO_ARM };
         }
+
+        CompactPuzzle* temp = parents;
+        parents = children;
+        children = temp;
+        MutationOrigin* const tempOrigins = parentOrigins;
+        parentOrigins = childOrigins;
+        childOrigins = tempOrigins;
+        telemetry_recordGeneration( monotonicNanoseconds() - generationStart );
     }
+    prefilter_printStats( &prefilterStats );
+    if ( config->solveBudget ) {
+        solveBudget_printStats( &solveBudgetStats );
+    }
+    if ( config->bandit ) {
+        mutationBandit_print( config->bandit );
+    }
+    printf( "%.2f CPU seconds\n", ( clock() - startClock ) * 1.0 / CLOCKS_PER_SEC );
+
+    arena_free( scratch );
+    arena_free( population );
+    return foundBest;
 }
 
 
@@ -1117,68 +1967,337 @@ void puzzle_free( Puzzle* const puzzle ) {
     free( puzzle );
 }
 
-void puzzle_findValidSolutions2( const Puzzle* const puzzle, DynamicArray* const edgeSolutions,
+void puzzle_findValidSolutions2( const Puzzle* const puzzle, const EdgeSet* const edgeSet,
                                PuzzleSolution* const otherSolutions,
                                uint* const numOtherSolutions, const uint maxOtherSolutions,
                                uint* const maxUniqueIndexes, uint* const maxUniqueSides ) {
-    static DynamicArray* centerSolutions;
-    static bool allocatedArrays = false;
+    static __thread PackedCenterSolutionVec centerSolutions;
+    static __thread TripleIndexVec centerRows;
+    static __thread bool allocatedArrays = false;
     if ( !allocatedArrays ) {
         //terrible idea, no real way to free this after
-        centerSolutions = da_create( 2000, sizeof( CenterSolution ) );
+        packedCenterVec_init( &centerSolutions, 256 );
+        tripleVec_init( &centerRows, 4000 );
+        allocatedArrays = true;
+    }
+
+    *maxUniqueIndexes = 0;
+    *maxUniqueSides = 0;
+    SolutionSearch search = { .otherSolutions = otherSolutions,
+                              .numOtherSolutions = numOtherSolutions,
+                              .maxOtherSolutions = maxOtherSolutions,
+                              .maxUniqueIndexes = maxUniqueIndexes,
+                              .maxUniqueSides = maxUniqueSides,
+                              .centerSolutions = &centerSolutions,
+                              .centerRows = &centerRows };
+    puzzle_solveCenters( puzzle, edgeSet, &search );
+}
+
+//EdgeSolutions per center task of puzzle_findValidSolutionsParallel
+#define PARALLEL_EDGE_CHUNK 64
+
+//one puzzle_findValidSolutionsParallel, shared by all of its tasks
+typedef struct ParallelSolve {
+    const Puzzle* puzzle;
+    SolveControl* control;
+    TripleIndexVec triples; //worked out before any task starts, only read after
+    pthread_mutex_t lock; //guards search
+    SolutionSearch search;
+} ParallelSolve;
+
+typedef struct ArrangementTask {
+    ParallelSolve* solve;
+    uint arrangement;
+    StealPool* pool;
+    uint worker; //running the task, what its center tasks are spawned on
+} ArrangementTask;
+
+typedef struct CenterChunkTask {
+    ParallelSolve* solve;
+    size_t numSolutions;
+    CompactEdgeSolution solutions[PARALLEL_EDGE_CHUNK];
+} CenterChunkTask;
+
+//edge triples of puzzle, in a buffer of the calling thread
+static TripleIndexVec parallel_edgeTriples( const Puzzle* const puzzle ) {
+    static __thread TripleIndexVec triples;
+    static __thread bool allocatedArrays = false;
+    if ( !allocatedArrays ) {
+        tripleVec_init( &triples, 2000 );
+        allocatedArrays = true;
+    }
+    puzzle_calculateEdgeTriples( puzzle, &triples );
+    if ( triples.numElements < 4 ) {
+        printf( "Error in edge solver\n" );
+    }
+    return triples;
+}
+
+//center stage for one EdgeSolution, from whichever thread has it
+static void parallel_solveEdge( ParallelSolve* const solve,
+                                const CompactEdgeSolution* const compact ) {
+    static __thread PackedCenterSolutionVec centerSolutions;
+    static __thread bool allocatedArrays = false;
+    if ( !allocatedArrays ) {
+        packedCenterVec_init( &centerSolutions, 256 );
         allocatedArrays = true;
     }
+    //puzzle_expandEdgeSolution only looks at the triples
+    const EdgeSet edgeSet = { .triples = solve->triples };
+    EdgeSolution edgeSolution;
+    puzzle_expandEdgeSolution( &edgeSet, compact, &edgeSolution );
+    packedCenterVec_clear( &centerSolutions );
+    findValidCentersForEdge( solve->puzzle, &edgeSolution, &centerSolutions, 2 );
+    for ( uint j = 0; j < centerSolutions.numElements; ++j ) {
+        PuzzleSolution solution;
+        puzzle_convertEdgeCenterToSolution( &solution, &edgeSolution,
+                                            *packedCenterVec_at( &centerSolutions, j ) );
+        uint numIndexConnections = 0;
+        uint numSideConnections = 0;
+        puzzle_calculateOriginalConnections( solve->puzzle, &solution,
+                                            &numIndexConnections, &numSideConnections );
+        if ( numIndexConnections == 40 ) {
+            continue;
+        }
+        //checked again under the lock, so nothing is added once the answer is in
+        pthread_mutex_lock( &solve->lock );
+        if ( !atomic_load( &solve->control->cancelled ) &&
+             !search_add( &solve->search, &solution, numIndexConnections,
+                          numSideConnections ) ) {
+            atomic_store( &solve->control->cancelled, true );
+        }
+        pthread_mutex_unlock( &solve->lock );
+    }
+}
 
-    centerSolutions->numElements = 0;
+static void parallel_solveCenterChunk( StealPool* const pool, const uint worker,
+                                       void* const arg ) {
+    CenterChunkTask* const chunk = arg;
+    ParallelSolve* const solve = chunk->solve;
+    for ( size_t i = 0; i < chunk->numSolutions; ++i ) {
+        if ( atomic_load_explicit( &solve->control->cancelled, memory_order_relaxed ) ) {
+            break;
+        }
+        parallel_solveEdge( solve, &chunk->solutions[i] );
+    }
+    free( chunk );
+}
+
+//EdgeBatchConsumer of an ArrangementTask, every batch becomes a center task
+static bool parallel_spawnCenters( const Puzzle* const puzzle, const EdgeSet* const edgeSet,
+                                   void* const arg ) {
+    ArrangementTask* const task = arg;
+    CenterChunkTask* chunk = malloc( sizeof( CenterChunkTask ) );
+    if ( !chunk ) {
+        fprintf( stderr, "Could not allocate center task\n" );
+        exit( 1 );
+    }
+    chunk->solve = task->solve;
+    chunk->numSolutions = edgeSet->solutions.numElements;
+    memcpy( chunk->solutions, edgeSet->solutions.contents,
+            sizeof( CompactEdgeSolution ) * chunk->numSolutions );
+    stealPool_spawn( task->pool, task->worker, parallel_solveCenterChunk, chunk );
+    return !atomic_load_explicit( &task->solve->control->cancelled, memory_order_relaxed );
+}
+
+static void parallel_solveArrangement( StealPool* const pool, const uint worker,
+                                       void* const arg ) {
+    ArrangementTask* const task = arg;
+    task->pool = pool;
+    task->worker = worker;
+    EdgeSet edgeSet = { .triples = task->solve->triples };
+    compactEdgeVec_init( &edgeSet.solutions, PARALLEL_EDGE_CHUNK );
+    const EdgeBatchConsumer consumer = { .consume = parallel_spawnCenters, .arg = task,
+                                         .batchSize = PARALLEL_EDGE_CHUNK };
+    uint edges[4];
+    if ( puzzle_recEdgeSolve( task->solve->puzzle, edges, task->arrangement, &edgeSet, 0,
+                              &consumer ) &&
+         edgeSet.solutions.numElements ) {
+        parallel_spawnCenters( task->solve->puzzle, &edgeSet, task );
+    }
+    compactEdgeVec_free( &edgeSet.solutions );
+    free( task );
+}
+
+static void parallel_solveEdges( StealPool* const pool, const uint worker, void* const arg ) {
+    for ( uint i = 0; i < 6; ++i ) {
+        ArrangementTask* task = malloc( sizeof( ArrangementTask ) );
+        if ( !task ) {
+            fprintf( stderr, "Could not allocate edge task\n" );
+            exit( 1 );
+        }
+        *task = ( ArrangementTask ) { .solve = arg, .arrangement = i };
+        stealPool_spawn( pool, worker, parallel_solveArrangement, task );
+    }
+}
+
+void puzzle_findValidSolutionsParallel( const Puzzle* const puzzle, StealPool* const pool,
+                                        SolveControl* control,
+                                        PuzzleSolution* const otherSolutions,
+                                        uint* const numOtherSolutions,
+                                        const uint maxOtherSolutions,
+                                        uint* const maxUniqueIndexes,
+                                        uint* const maxUniqueSides ) {
+    SolveControl ownControl;
+    if ( !control ) {
+        atomic_init( &ownControl.cancelled, false );
+        control = &ownControl;
+    }
 
     *maxUniqueIndexes = 0;
     *maxUniqueSides = 0;
-    for ( uint i = 0; i < edgeSolutions->numElements; ++i ) {
-        uint temp = centerSolutions->numElements;
-        findValidCentersForEdge( puzzle, ( EdgeSolution* ) da_getElement( edgeSolutions, i ),
-                                 centerSolutions );
-        for  ( uint j = temp; j < centerSolutions->numElements; ++j ) {
-            PuzzleSolution solution;
-            puzzle_convertEdgeCenterToSolution( &solution,
-                                                ( EdgeSolution* ) da_getElement( edgeSolutions, i ),
-                                                ( CenterSolution* ) da_getElement( centerSolutions, j ) );
-            uint numIndexConnections = 0;
-            uint numSideConnections = 0;
-            puzzle_calculateOriginalConnections( puzzle, &solution,
-                                                &numIndexConnections,
-                                                &numSideConnections );
-            if ( numIndexConnections < 40 ) {
-                otherSolutions[*numOtherSolutions] = solution;
-                ++*numOtherSolutions;;
-                if ( ( 40 - numIndexConnections ) > *maxUniqueIndexes ) {
-                    *maxUniqueIndexes = 40 - numIndexConnections;
-                }
-                if ( ( 40 - numSideConnections ) > *maxUniqueSides ) {
-                    *maxUniqueSides = 40 - numSideConnections;
-                }
-                if ( *numOtherSolutions == maxOtherSolutions ) {
-                    fprintf( stderr, "Too many total solutions\n" );
-                    exit( 1 );
-                }
+    ParallelSolve solve = { .puzzle = puzzle,
+                            .control = control,
+                            .triples = parallel_edgeTriples( puzzle ),
+                            .search = { .otherSolutions = otherSolutions,
+                                        .numOtherSolutions = numOtherSolutions,
+                                        .maxOtherSolutions = maxOtherSolutions,
+                                        .maxUniqueIndexes = maxUniqueIndexes,
+                                        .maxUniqueSides = maxUniqueSides } };
+    pthread_mutex_init( &solve.lock, NULL );
+    stealPool_run( pool, parallel_solveEdges, &solve );
+    pthread_mutex_destroy( &solve.lock );
+}
+
+SPSC_DEFINE( EdgeSolutionRing, CompactEdgeSolution, edgeRing )
+
+//EdgeSolutions each center thread can have waiting
+#define PIPELINE_RING_SIZE 1024
+//EdgeSolutions the edge stage collects before pushing them
+#define PIPELINE_BATCH 16
+
+typedef struct Pipeline {
+    ParallelSolve* solve;
+    EdgeSolutionRing* rings; //one per center thread
+    uint numRings;
+    uint nextRing; //only the edge stage touches it
+    atomic_bool edgesDone;
+} Pipeline;
+
+typedef struct PipelineStage {
+    Pipeline* pipeline;
+    EdgeSolutionRing* ring;
+} PipelineStage;
+
+static void* pipeline_solveCenters( void* arg ) {
+    PipelineStage* const stage = arg;
+    Pipeline* const pipeline = stage->pipeline;
+    while ( !atomic_load_explicit( &pipeline->solve->control->cancelled,
+                                   memory_order_relaxed ) ) {
+        //read before popping, once it is set everything has been pushed
+        const bool edgesDone = atomic_load( &pipeline->edgesDone );
+        CompactEdgeSolution compact;
+        if ( edgeRing_pop( stage->ring, &compact ) ) {
+            parallel_solveEdge( pipeline->solve, &compact );
+        } else if ( edgesDone ) {
+            break;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+//EdgeBatchConsumer of the edge stage, deals the batch out to the center threads
+static bool pipeline_pushEdges( const Puzzle* const puzzle, const EdgeSet* const edgeSet,
+                                void* const arg ) {
+    Pipeline* const pipeline = arg;
+    const atomic_bool* const cancelled = &pipeline->solve->control->cancelled;
+    for ( size_t i = 0; i < edgeSet->solutions.numElements; ++i ) {
+        const CompactEdgeSolution compact = *compactEdgeVec_at( &edgeSet->solutions, i );
+        uint numFull = 0;
+        while ( !edgeRing_push( &pipeline->rings[pipeline->nextRing], compact ) ) {
+            //every ring is full, wait for the center threads to catch up
+            if ( atomic_load_explicit( cancelled, memory_order_relaxed ) ) {
+                return false;
             }
-            if ( *numOtherSolutions > 1 ) {
-                return;
+            pipeline->nextRing = ( pipeline->nextRing + 1 ) % pipeline->numRings;
+            if ( ++numFull == pipeline->numRings ) {
+                numFull = 0;
+                sched_yield();
             }
         }
+        pipeline->nextRing = ( pipeline->nextRing + 1 ) % pipeline->numRings;
+    }
+    return !atomic_load_explicit( cancelled, memory_order_relaxed );
+}
+
+void puzzle_findValidSolutionsPipelined( const Puzzle* const puzzle,
+                                         const uint numCenterThreads, SolveControl* control,
+                                         PuzzleSolution* const otherSolutions,
+                                         uint* const numOtherSolutions,
+                                         const uint maxOtherSolutions,
+                                         uint* const maxUniqueIndexes,
+                                         uint* const maxUniqueSides ) {
+    SolveControl ownControl;
+    if ( !control ) {
+        atomic_init( &ownControl.cancelled, false );
+        control = &ownControl;
+    }
+
+    *maxUniqueIndexes = 0;
+    *maxUniqueSides = 0;
+    ParallelSolve solve = { .puzzle = puzzle,
+                            .control = control,
+                            .triples = parallel_edgeTriples( puzzle ),
+                            .search = { .otherSolutions = otherSolutions,
+                                        .numOtherSolutions = numOtherSolutions,
+                                        .maxOtherSolutions = maxOtherSolutions,
+                                        .maxUniqueIndexes = maxUniqueIndexes,
+                                        .maxUniqueSides = maxUniqueSides } };
+    pthread_mutex_init( &solve.lock, NULL );
+
+    Pipeline pipeline = { .solve = &solve, .numRings = numCenterThreads, .nextRing = 0 };
+    atomic_init( &pipeline.edgesDone, false );
+    pipeline.rings = aligned_alloc( SPSC_CACHE_LINE, sizeof( EdgeSolutionRing ) * numCenterThreads );
+    if ( !pipeline.rings || numCenterThreads == 0 ) {
+        fprintf( stderr, "Could not create a pipeline with %u center threads\n", numCenterThreads );
+        exit( 1 );
+    }
+    pthread_t threads[numCenterThreads];
+    PipelineStage stages[numCenterThreads];
+    for ( uint i = 0; i < numCenterThreads; ++i ) {
+        edgeRing_init( &pipeline.rings[i], PIPELINE_RING_SIZE );
+        stages[i] = ( PipelineStage ) { .pipeline = &pipeline, .ring = &pipeline.rings[i] };
+        pthread_create( &threads[i], NULL, pipeline_solveCenters, &stages[i] );
+    }
+
+    //the calling thread is the edge stage
+    EdgeSet edgeSet = { .triples = solve.triples };
+    compactEdgeVec_init( &edgeSet.solutions, PIPELINE_BATCH );
+    const EdgeBatchConsumer consumer = { .consume = pipeline_pushEdges, .arg = &pipeline,
+                                         .batchSize = PIPELINE_BATCH };
+    bool keepGoing = true;
+    for ( uint i = 0; i < 6 && keepGoing; ++i ) {
+        uint edges[4];
+        keepGoing = puzzle_recEdgeSolve( puzzle, edges, i, &edgeSet, 0, &consumer );
     }
+    if ( keepGoing && edgeSet.solutions.numElements ) {
+        pipeline_pushEdges( puzzle, &edgeSet, &pipeline );
+    }
+    atomic_store( &pipeline.edgesDone, true );
+
+    for ( uint i = 0; i < numCenterThreads; ++i ) {
+        pthread_join( threads[i], NULL );
+        edgeRing_free( &pipeline.rings[i] );
+    }
+    free( pipeline.rings );
+    compactEdgeVec_free( &edgeSet.solutions );
+    pthread_mutex_destroy( &solve.lock );
 }
 
-void puzzle_shuffleUntilUniqueEdge( Puzzle* const puzzle, DynamicArray* edgeSolutions ) {
+void puzzle_shuffleUntilUniqueEdge( Puzzle* const puzzle, EdgeSet* edgeSet ) {
     while ( true ) {
         puzzle_shuffle( puzzle );
 
-        edgeSolutions->numElements = 0;
-
-        puzzle_findValidEdges(puzzle, edgeSolutions);
+        puzzle_findValidEdges( puzzle, edgeSet );
 
         bool valid = false;
-        for ( uint i = 0; i < edgeSolutions->numElements; ++i ) {
-            if ( edgeSolutionIsUnique( ( EdgeSolution* ) da_getElement( edgeSolutions, i )) ) {
+        for ( uint i = 0; i < edgeSet->solutions.numElements; ++i ) {
+            EdgeSolution edgeSolution;
+            puzzle_expandEdgeSolution( edgeSet, compactEdgeVec_at( &edgeSet->solutions, i ),
+                                       &edgeSolution );
+            if ( edgeSolutionIsUnique( &edgeSolution ) ) {
                 valid = true;
                 break;
             }
@@ -1201,10 +2320,10 @@ void puzzle_shuffleCenter( Puzzle* const puzzle ) {
         connectionCounts[i] = 0;
     }
     for ( uint i = 0; i < 16; ++i ) {
-        ++connectionCounts[puzzle->connections[validEdgeConnections[i]]];
+        ++connectionCounts[abs( puzzle->connections[validEdgeConnections[i]] )];
     }
 
-    uint tempCenterConnections[24];
+    int tempCenterConnections[24];
     uint numAdded = 0;
     for ( uint i = 1; i < puzzle->numUniqueConnectors + 1; ++i ) {
         for ( int j = 0; j < ( 2 - connectionCounts[i] ); ++j ) {
@@ -1218,17 +2337,289 @@ void puzzle_shuffleCenter( Puzzle* const puzzle ) {
     }
 
     rand_shuffle( tempCenterConnections, 24, sizeof( int ) );
+#ifdef SIGNED_CONNECTORS
+    for ( uint i = 0; i < 24; ++i ) {
+        if ( rand_float() < 0.5 ) {
+            tempCenterConnections[i] *= -1;
+        }
+    }
+#endif
+    //the edge ring connections stay, so only the center sides need setting
     for ( uint i = 0; i < 24; ++i ) {
-        puzzle->connections[validCenterConnections[i]] = tempCenterConnections[i];
+        puzzle_setConnection( puzzle, validCenterConnections[i], tempCenterConnections[i] );
+    }
+}
+
+/*
+ * Connections that have to get the same connector. roots[i] is a connection that
+ * connection i has to match (the lowest one of the group once found), -1 for a fixed
+ * connection. signs[i] is 1 if connection i gets the same value as roots[i], or
+ * piece_complement( 1 ) if it gets the complement (only ever -1 with signed
+ * connectors).
+*/
+typedef struct ConnectionGroups {
+    char roots[40];
+    char signs[40];
+} ConnectionGroups;
+
+static void groups_init( ConnectionGroups* const groups ) {
+    for ( uint i = 0; i < 40; ++i ) {
+        groups->roots[i] = i;
+        groups->signs[i] = 1;
+    }
+}
+
+//root of connection's group, sign is set to how connection relates to it
+static char findGroup( ConnectionGroups* const groups, const char connection,
+                       char* const sign ) {
+    char root = connection;
+    char rootSign = 1;
+    while ( groups->roots[( int ) root] != root ) {
+        rootSign *= groups->signs[( int ) root];
+        root = groups->roots[( int ) root];
+    }
+    groups->roots[( int ) connection] = root;
+    groups->signs[( int ) connection] = rootSign;
+    *sign = rootSign;
+    return root;
+}
+
+/*
+ * Make connection1 get sign * the value of connection2. Returns false if the
+ * groups already say the opposite, which can only happen with signed connectors.
+*/
+static bool joinGroups( ConnectionGroups* const groups, const char connection1,
+                        const char connection2, const char sign ) {
+    char sign1;
+    char sign2;
+    const char root1 = findGroup( groups, connection1, &sign1 );
+    const char root2 = findGroup( groups, connection2, &sign2 );
+    //root1 = sign1 * connection1 = sign1 * sign * connection2 = sign1 * sign * sign2 * root2
+    const char rootSign = sign1 * sign * sign2;
+    if ( root1 == root2 ) {
+        return rootSign == 1;
+    }
+    if ( root1 < root2 ) {
+        groups->roots[( int ) root2] = root1;
+        groups->signs[( int ) root2] = rootSign;
+    } else {
+        groups->roots[( int ) root1] = root2;
+        groups->signs[( int ) root1] = rootSign;
+    }
+    return true;
+}
+
+/*
+ * How the side connection gives piece relates to the connection's value: 1 for the
+ * Piece that gets the value, piece_complement( 1 ) for the one that gets the
+ * complement
+*/
+static char sideSign( const uint connection, const uint piece ) {
+    return connectionSides[connection][0].piece == ( char ) piece ? 1 : piece_complement( 1 );
+}
+
+/*
+ * Give every group of connections one random connector value, and set the Pieces
+ *
+ * Like puzzle_shuffle, every connector value gets used at least twice (counting the
+ * fixed connections) as long as there are enough groups left to do that.
+*/
+static void puzzle_assignGroups( Puzzle* const puzzle, ConnectionGroups* const groups ) {
+    const uint numUniqueConnectors = puzzle->numUniqueConnectors;
+    uint connectionCounts[numUniqueConnectors + 1];
+    memset( connectionCounts, 0, sizeof( uint ) * ( numUniqueConnectors + 1 ) );
+    uint groupSizes[40] = { 0 };
+    char roots[40];
+    uint numRoots = 0;
+    for ( uint i = 0; i < 40; ++i ) {
+        if ( groups->roots[i] == -1 ) {
+            ++connectionCounts[abs( puzzle->connections[i] )];
+            continue;
+        }
+        char sign;
+        const char root = findGroup( groups, i, &sign );
+        if ( root == i ) {
+            roots[numRoots++] = root;
+        }
+        ++groupSizes[( int ) root];
+    }
+    rand_shuffle( roots, numRoots, sizeof( char ) );
+
+    uint nextRoot = 0;
+    for ( uint i = 1; i <= numUniqueConnectors && nextRoot < numRoots; ++i ) {
+        while ( connectionCounts[i] < 2 && nextRoot < numRoots ) {
+            const char root = roots[nextRoot++];
+            puzzle->connections[( int ) root] = i;
+            connectionCounts[i] += groupSizes[( int ) root];
+        }
+    }
+    for ( ; nextRoot < numRoots; ++nextRoot ) {
+        puzzle->connections[( int ) roots[nextRoot]] = rand_intBetween( 1, numUniqueConnectors + 1 );
+    }
+#ifdef SIGNED_CONNECTORS
+    for ( uint i = 0; i < numRoots; ++i ) {
+        if ( rand_float() < 0.5 ) {
+            puzzle->connections[( int ) roots[i]] *= -1;
+        }
+    }
+#endif
+
+    for ( uint i = 0; i < 40; ++i ) {
+        if ( groups->roots[i] != -1 ) {
+            char sign;
+            const char root = findGroup( groups, i, &sign );
+            puzzle->connections[i] = sign * puzzle->connections[( int ) root];
+        }
     }
-    
     puzzle_setPieces2( puzzle );
 }
 
+void puzzle_generateSwappable( Puzzle* const puzzle ) {
+    //per side of the edge ring (top, right, bottom, left) going clockwise: the
+    //connection to the corner before the triple, the one to the corner after it,
+    //and the center side connections of the triple
+    static const char sideOuterConnections[4][2] = { { 0, 15 }, { 24, 39 }, { 19, 4 },
+                                                     { 35, 20 } };
+    static const char sideInnerConnections[4][3] = { { 21, 22, 23 }, { 16, 17, 18 },
+                                                     { 38, 37, 36 }, { 3, 2, 1 } };
+    //the edge Pieces of each side going clockwise, what those connections belong to
+    static const char sideEdgePieces[4][3] = { { 1, 2, 3 }, { 9, 14, 19 }, { 23, 22, 21 },
+                                               { 15, 10, 5 } };
+
+    ConnectionGroups groups;
+    groups_init( &groups );
+
+    //joins never share a connection, so they never contradict each other
+    if ( rand_float() < 0.5 ) {
+        //two sides that look the same to the corners and the center can trade triples
+        const uint first = rand_index( 4 );
+        const uint second = ( first + 1 + rand_index( 3 ) ) % 4;
+        for ( uint i = 0; i < 2; ++i ) {
+            const char connection1 = sideOuterConnections[first][i];
+            const char connection2 = sideOuterConnections[second][i];
+            joinGroups( &groups, connection1, connection2,
+                        sideSign( connection1, sideEdgePieces[first][i * 2] ) *
+                        sideSign( connection2, sideEdgePieces[second][i * 2] ) );
+        }
+        for ( uint i = 0; i < 3; ++i ) {
+            const char connection1 = sideInnerConnections[first][i];
+            const char connection2 = sideInnerConnections[second][i];
+            joinGroups( &groups, connection1, connection2,
+                        sideSign( connection1, sideEdgePieces[first][i] ) *
+                        sideSign( connection2, sideEdgePieces[second][i] ) );
+        }
+    } else {
+        //two center Pieces that don't touch and have the same sides can trade places
+        uint first = 0;
+        uint second = 0;
+        while ( first == second || twoIndexesOriginallyTouched( first, second ) ) {
+            first = centerPieceIndexes[rand_index( 9 )];
+            second = centerPieceIndexes[rand_index( 9 )];
+        }
+        const uint indexes[2] = { first, second };
+        char sides[2][4];
+        for ( uint i = 0; i < 2; ++i ) {
+            const uint row = indexes[i] / 5;
+            const uint col = indexes[i] % 5;
+            sides[i][0] = 20 + ( row - 1 ) * 5 + col;
+            sides[i][1] = col * 5 + row;
+            sides[i][2] = 20 + row * 5 + col;
+            sides[i][3] = ( col - 1 ) * 5 + row;
+        }
+        for ( uint i = 0; i < 4; ++i ) {
+            joinGroups( &groups, sides[0][i], sides[1][i],
+                        sideSign( sides[0][i], first ) * sideSign( sides[1][i], second ) );
+        }
+    }
+
+    puzzle_assignGroups( puzzle, &groups );
+}
+
+//most edge ring connections puzzle_generateUniqueEdge ties to one value
+#define MAX_UNIQUE_EDGE_GROUP 3
+
+void puzzle_generateUniqueEdge( Puzzle* const puzzle, EdgeSet* const edgeSet ) {
+    //edge ring clockwise from the top left corner, and the connection after each
+    static const char ringIndexes[16] = { 0, 1, 2, 3, 4, 9, 14, 19, 24, 23, 22, 21, 20, 15,
+                                          10, 5 };
+    static const char ringConnections[16] = { 0, 5, 10, 15, 24, 29, 34, 39, 19, 14, 9, 4,
+                                              35, 30, 25, 20 };
+    static const char edgeIndexes[12] = { 1, 2, 3, 9, 14, 19, 23, 22, 21, 15, 10, 5 };
+
+    //position of each Piece in ringIndexes
+    char ringPositions[25];
+    for ( uint i = 0; i < 16; ++i ) {
+        ringPositions[( int ) ringIndexes[i]] = i;
+    }
+
+    char corners[3] = { 4, 24, 20 };
+    char edges[12];
+    memcpy( edges, edgeIndexes, sizeof( edges ) );
+    while ( true ) {
+        ConnectionGroups groups;
+        bool valid = false;
+        while ( !valid ) {
+            //sample the other ring: Piece 0 stays in the top left like in the solver,
+            //and no two Pieces that touch in it can have touched originally
+            char ring[16];
+            rand_shuffle( corners, 3, sizeof( char ) );
+            rand_shuffle( edges, 12, sizeof( char ) );
+            ring[0] = 0;
+            for ( uint i = 1; i < 16; ++i ) {
+                ring[i] = i % 4 == 0 ? corners[i / 4 - 1] : edges[i - 1 - i / 4];
+            }
+            valid = true;
+            for ( uint i = 0; i < 16 && valid; ++i ) {
+                valid = !twoIndexesOriginallyTouched( ring[i], ring[( i + 1 ) % 16] );
+            }
+            if ( !valid ) {
+                continue;
+            }
+
+            //every Piece's right side has to connect to the left side of the Piece
+            //after it in the other ring, the center connections are free. With signed
+            //connectors a ring can ask a connection to be its own complement.
+            groups_init( &groups );
+            for ( uint i = 0; i < 16 && valid; ++i ) {
+                const uint position = ringPositions[( int ) ring[i]];
+                const uint nextPosition = ringPositions[( int ) ring[( i + 1 ) % 16]];
+                const char right = ringConnections[position];
+                const char left = ringConnections[( nextPosition + 15 ) % 16];
+                valid = joinGroups( &groups, right, left,
+                                    sideSign( right, ring[i] ) *
+                                    sideSign( left, ring[( i + 1 ) % 16] ) *
+                                    piece_complement( 1 ) );
+            }
+
+            //most rings tie 8+ connections to one value, those Puzzles have so many
+            //edge solutions that puzzle_findValidEdges can't list them
+            uint groupSizes[40] = { 0 };
+            for ( uint i = 0; i < 16 && valid; ++i ) {
+                char sign;
+                valid = ++groupSizes[( int ) findGroup( &groups, ringConnections[i], &sign )] <=
+                        MAX_UNIQUE_EDGE_GROUP;
+            }
+        }
+        puzzle_assignGroups( puzzle, &groups );
+
+        puzzle_findValidEdges( puzzle, edgeSet );
+        for ( uint i = 0; i < edgeSet->solutions.numElements; ++i ) {
+            EdgeSolution edgeSolution;
+            puzzle_expandEdgeSolution( edgeSet, compactEdgeVec_at( &edgeSet->solutions, i ),
+                                       &edgeSolution );
+            if ( edgeSolutionIsUnique( &edgeSolution ) ) {
+                return;
+            }
+        }
+        fprintf( stderr, "Planted edge ring was not found, trying another\n" );
+    }
+}
+
 void puzzle_findSolutionsUniqueEdges() {
     Puzzle* puzzle = puzzle_create( 7 );
-    DynamicArray* edgeSolutions = da_create( 10000, sizeof( EdgeSolution ) );
-    puzzle_shuffleUntilUniqueEdge( puzzle, edgeSolutions );
+    EdgeSet edgeSet;
+    edgeSet_init( &edgeSet, 10000 );
+    puzzle_generateUniqueEdge( puzzle, &edgeSet );
     Puzzle* temp = malloc( sizeof( Puzzle ) );
 
     uint count = 0;
@@ -1236,17 +2627,25 @@ void puzzle_findSolutionsUniqueEdges() {
     uint bestSides = 0;
     uint bestIndexes = 0;
     bool foundBest = false;
+    uint64_t ringStart = monotonicNanoseconds();
+    bool freshRing = true;
     while ( true ) {
         uint maxUniqueIndexes = 0;
         uint maxUniqueSides = 0;
         uint maxOtherSolutions = 100;
         uint numOtherSolutions = 0;
         PuzzleSolution solutions[maxOtherSolutions];
-        puzzle_findValidSolutions2( puzzle, edgeSolutions, solutions,
+        puzzle_findValidSolutions2( puzzle, &edgeSet, solutions,
                                   &numOtherSolutions, maxOtherSolutions,
                                   &maxUniqueIndexes, &maxUniqueSides );
+        //every Puzzle but the first on an edge ring reuses its EdgeSolutions
+        telemetry_add( TELEMETRY_EVALUATIONS, 1 );
+        telemetry_add( freshRing ? TELEMETRY_CACHE_MISSES : TELEMETRY_CACHE_HITS, 1 );
+        freshRing = false;
+        telemetry_countSolve( numOtherSolutions, false );
         if ( numOtherSolutions == 1 ) {
             uint sum = maxUniqueSides + maxUniqueIndexes;
+            telemetry_offerBest( sum );
             if ( sum > bestSum ) {
                 foundBest = true;
                 count = 0;
@@ -1275,7 +2674,65 @@ void puzzle_findSolutionsUniqueEdges() {
         if ( count == 1000 ) {
             foundBest = false;
             count = 0;
-            puzzle_shuffleUntilUniqueEdge( puzzle, edgeSolutions );
+            puzzle_generateUniqueEdge( puzzle, &edgeSet );
+            freshRing = true;
+            //each edge ring counts as a generation
+            const uint64_t now = monotonicNanoseconds();
+            telemetry_recordGeneration( now - ringStart );
+            ringStart = now;
         }
     }
 }
+
+void kernel_calculateValidEdges( const Puzzle* const puzzle, TripleIndexVec* const validEdges ) {
+    puzzle_calculateValidEdges( puzzle, validEdges );
+}
+
+void kernel_calculateValidEdgesStack( const Puzzle* const puzzle,
+                                      TripleIndexVec* const validEdges ) {
+    puzzle_calculateValidEdgesStack( puzzle, validEdges );
+}
+
+void kernel_recEdgeSolve( const Puzzle* const puzzle, EdgeSet* const edgeSet ) {
+    compactEdgeVec_clear( &edgeSet->solutions );
+    for ( uint i = 0; i < 6; ++i ) {
+        uint edges[4];
+        puzzle_recEdgeSolve( puzzle, edges, i, edgeSet, 0, NULL );
+    }
+}
+
+void kernel_calculateValidCenterRows( const Puzzle* const puzzle,
+                                      const EdgeSolution* const edgeSolution,
+                                      TripleIndexVec* const validCenterRows ) {
+    //the neighbor tables aren't looked at by puzzle_calculateValidCenterRows
+    const uint validNeighbors[9][9] = { { 0 } };
+    const uint validNeighborsCount[9] = { 0 };
+    puzzle_calculateValidCenterRows( puzzle, edgeSolution, validCenterRows, validNeighbors,
+                                     validNeighborsCount );
+}
+
+void kernel_recCenterSolve( const Puzzle* const puzzle, const EdgeSolution* const edgeSolution,
+                            const TripleIndexVec* const centerRows,
+                            PackedCenterSolutionVec* const centerSolutions,
+                            const size_t maxCenterSolutions ) {
+    uint centerIndexes[3];
+    puzzle_recCenterSolve( puzzle, centerIndexes, edgeSolution, centerRows, 0, centerSolutions,
+                           maxCenterSolutions, ~( PackedCenterSolution ) 0 );
+}
+
+uint64_t kernel_countCenters( const Puzzle* const puzzle, const EdgeSolution* const edgeSolution,
+                              const TripleIndexVec* const centerRows ) {
+    return puzzle_countCenters( puzzle, edgeSolution, centerRows, false );
+}
+
+void kernel_calculateOriginalConnections( const Puzzle* const puzzle,
+                                          const PuzzleSolution* const solution,
+                                          uint* const numIndexConnections,
+                                          uint* const numSideConnections ) {
+    puzzle_calculateOriginalConnections( puzzle, solution, numIndexConnections,
+                                         numSideConnections );
+}
+
+void kernel_setPieces2( Puzzle* const puzzle ) {
+    puzzle_setPieces2( puzzle );
+}
@@ -1,16 +1,75 @@
 #ifndef PUZZLE_H
 #define PUZZLE_H
 
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdlib.h>
-#include "da.h"
+#include <stdatomic.h>
+#include "error.h"
+#include "memory.h"
 #include "pieces.h"
+#include "steal.h"
+#include "vec.h"
 
 typedef struct PuzzleSolution {
     char indexes[25];
     char rotations[25];
 } PuzzleSolution;
 
+typedef struct TripleIndex {
+    char indexes[3];
+    char rotations[3];
+} TripleIndex;
+
+typedef struct EdgeSolution {
+    char cornerIndexes[4];
+    char topEdgeIndexes[3]; //left to right
+    char leftEdgeIndexes[3]; //top to bottom
+    char rightEdgeIndexes[3]; //top to bottom
+    char bottomEdgeIndexes[3]; //left to right
+} EdgeSolution;
+
+/*
+ * EdgeSolution as the 4 edge triples it uses (top, right, bottom, left), stored as
+ * indexes into the triples of the EdgeSet it belongs to, plus which of the 6 corner
+ * arrangements it was built on. Expanded into a full EdgeSolution only when a
+ * stage needs one.
+*/
+typedef struct CompactEdgeSolution {
+    unsigned short tripleIndexes[4];
+    unsigned char arrangement;
+} CompactEdgeSolution;
+
+/*
+ * The center 3x3 of a solution, 6 bits per cell going left to right, top to bottom.
+ * The low 4 bits of a cell are which center Piece (0 - 8) is there, the high 2
+ * bits are its rotation.
+*/
+typedef uint64_t PackedCenterSolution;
+
+VEC_DEFINE( TripleIndexVec, TripleIndex, tripleVec )
+VEC_DEFINE( CompactEdgeSolutionVec, CompactEdgeSolution, compactEdgeVec )
+VEC_DEFINE( PackedCenterSolutionVec, PackedCenterSolution, packedCenterVec )
+
+/*
+ * Output of the edge stage: the valid edge triples of a Puzzle and the
+ * CompactEdgeSolutions that index into them
+*/
+typedef struct EdgeSet {
+    TripleIndexVec triples;
+    CompactEdgeSolutionVec solutions;
+} EdgeSet;
+
+void edgeSet_init( EdgeSet* const edgeSet, const size_t startingSize );
+void edgeSet_free( EdgeSet* const edgeSet );
+
+/*
+ * Build the full EdgeSolution that a CompactEdgeSolution from edgeSet stands for
+*/
+void puzzle_expandEdgeSolution( const EdgeSet* const edgeSet,
+                                const CompactEdgeSolution* const compact,
+                                EdgeSolution* const edgeSolution );
+
 bool twoIndexesOriginallyTouched( const char index1, const char index2 );
 void puzzle_printSolution( const PuzzleSolution* const solution );
 void puzzle_findSolutionsUniqueEdges();
@@ -31,10 +90,138 @@ typedef struct Puzzle {
                           //[20, 39] horizontal connections, left to right
                           //negative is innie -> outie
     uint numUniqueConnectors; 
+    uint64_t dirtyConnections; //bit per connection changed since the Pieces were last
+                               //looked at, puzzle_setPieces2 marks all 40
 } Puzzle;
 
+//connections between two edge ring Pieces, the only ones the edge stage looks at
+#define PUZZLE_EDGE_RING_CONNECTIONS ( ( 1ull << 0 ) | ( 1ull << 5 ) | ( 1ull << 10 ) |   \
+                                       ( 1ull << 15 ) | ( 1ull << 4 ) | ( 1ull << 9 ) |   \
+                                       ( 1ull << 14 ) | ( 1ull << 19 ) | ( 1ull << 20 ) | \
+                                       ( 1ull << 25 ) | ( 1ull << 30 ) | ( 1ull << 35 ) | \
+                                       ( 1ull << 24 ) | ( 1ull << 29 ) | ( 1ull << 34 ) | \
+                                       ( 1ull << 39 ) )
+
+/*
+ * How the edge stage finds the edge triples that fit between two corners, both
+ * find the same triples in a different order
+*/
+typedef enum EdgeStage {
+    EDGE_STAGE_NESTED, //a loop per edge Piece, the default
+    EDGE_STAGE_STACK, //an explicit stack of partial triples
+    EDGE_NUM_STAGES
+} EdgeStage;
+
+/*
+ * Switch the edge stage of every solve this thread runs from now on, returns the
+ * one it replaces. The parallel and pipelined solves find their triples on the
+ * calling thread, so they follow it too.
+*/
+EdgeStage puzzle_useEdgeStage( const EdgeStage stage );
+
+/*
+ * Fills in the connections of a Puzzle that already has numUniqueConnectors set,
+ * used to pick where the GA's fresh Puzzles come from
+*/
+typedef void ( *PuzzleGenerator )( Puzzle* const puzzle );
+
+//see results.h
+typedef struct ResultLog ResultLog;
+typedef struct HallOfFame HallOfFame;
+typedef struct ResultRecord ResultRecord;
+//see bandit.h
+typedef struct MutationBandit MutationBandit;
+//see edgecache.h
+typedef struct EdgeRingCache EdgeRingCache;
+
+/*
+ * Set one connection and update only the two Piece sides it feeds, marking it in
+ * dirtyConnections
+*/
+void puzzle_setConnection( Puzzle* const puzzle, const uint connection, const char value );
+
+/*
+ * Swap two connections, updating only the (up to 4) Pieces they feed instead of
+ * rebuilding all 25. Both are marked in dirtyConnections if the values differ.
+*/
+void puzzle_swapConnections( Puzzle* const puzzle, const uint connection1,
+                             const uint connection2 );
+
 void puzzle_mutateCenter( Puzzle* const destPuzzle, const Puzzle* const srcPuzzle, const uint minMutations, const uint maxMutations );
-void puzzle_shuffleUntilUniqueEdge( Puzzle* const puzzle, DynamicArray* edgeSolutions );
+
+/*
+ * A Puzzle as only its connections. The Pieces are fully set by the connections
+ * (puzzle_setPieces2), so anything that stores or copies lots of Puzzles (the GA
+ * population) keeps these, 40 bytes instead of the ~650 of a Puzzle, and gets the
+ * Pieces from compactPuzzle_view when it needs to solve one.
+ *
+ * numUniqueConnectors isn't kept, it is the same for every Puzzle of a population.
+*/
+typedef struct CompactPuzzle {
+    char connections[40];
+} CompactPuzzle;
+
+void compactPuzzle_fromPuzzle( CompactPuzzle* const compact, const Puzzle* const puzzle );
+
+/*
+ * compact with its Pieces, in a Puzzle that belongs to the calling thread and is
+ * good until that thread's next view. Only the Pieces of connections that differ
+ * from the last view are redone when there are few of them.
+*/
+const Puzzle* compactPuzzle_view( const CompactPuzzle* const compact,
+                                  const uint numUniqueConnectors );
+
+/*
+ * Fill compact from generate, which works on the calling thread's view Puzzle
+*/
+void compactPuzzle_generate( CompactPuzzle* const compact, const uint numUniqueConnectors,
+                             const PuzzleGenerator generate );
+
+/*
+ * Same as puzzle_mutate / puzzle_mutateCenter (and the same random draws), only
+ * copying and swapping connections
+*/
+void compactPuzzle_mutate( CompactPuzzle* const dest, const CompactPuzzle* const src,
+                           const uint minMutations, const uint maxMutations );
+void compactPuzzle_mutateCenter( CompactPuzzle* const dest, const CompactPuzzle* const src,
+                                 const uint minMutations, const uint maxMutations );
+
+/*
+ * Child with edgeParent's 16 edge ring connections (PUZZLE_EDGE_RING_CONNECTIONS)
+ * and centerParent's other 24
+ *
+ * Every connector still shows up at least twice after, as puzzle_shuffle makes
+ * them: one that ended up short takes over random center connections whose
+ * connector has more than two, so the edge ring is left as edgeParent had it.
+*/
+void compactPuzzle_crossover( CompactPuzzle* const dest, const CompactPuzzle* const edgeParent,
+                              const CompactPuzzle* const centerParent,
+                              const uint numUniqueConnectors );
+void puzzle_shuffleUntilUniqueEdge( Puzzle* const puzzle, EdgeSet* edgeSet );
+
+/*
+ * Same result as puzzle_shuffleUntilUniqueEdge, a Puzzle with an EdgeSolution where
+ * no two Pieces touch that originally touched, with edgeSet holding its EdgeSolutions
+ *
+ * Instead of shuffling whole Puzzles until one has such a ring, the other ring is
+ * picked first (only an order of Pieces, no solving), then the edge ring
+ * connections are tied together so it fits, and the rest is filled in randomly.
+ * Costs one puzzle_findValidEdges to fill in edgeSet.
+*/
+void puzzle_generateUniqueEdge( Puzzle* const puzzle, EdgeSet* const edgeSet );
+
+/*
+ * Find every EdgeSolution of the Puzzle, replacing whatever was in edgeSet
+*/
+void puzzle_findValidEdges( const Puzzle* const puzzle, EdgeSet* const edgeSet );
+
+/*
+ * puzzle_findValidEdges, giving up once there are more than maxSolutions
+ * EdgeSolutions (or the solve budget runs out). Returns false if it gave up,
+ * edgeSet only holds some of them then.
+*/
+bool puzzle_findValidEdgesUpTo( const Puzzle* const puzzle, EdgeSet* const edgeSet,
+                                const size_t maxSolutions );
 
 /*
  * Create a Puzzle that contains numUniqueConnectors amount of different connections
@@ -48,6 +235,28 @@ void puzzle_shuffleUntilUniqueEdge( Puzzle* const puzzle, DynamicArray* edgeSolu
 */
 Puzzle* puzzle_create( const uint numUniqueConnectors );
 
+/*
+ * Same as puzzle_create, but sets up a Puzzle the caller already has memory for
+ *
+ * Used when Puzzles live in bulk storage (an Arena, an array) instead of each
+ * being malloc'd on its own.
+*/
+void puzzle_init( Puzzle* const puzzle, const uint numUniqueConnectors );
+
+/*
+ * Set up a Puzzle from an existing connections array instead of shuffling one
+*/
+void puzzle_initFromConnections( Puzzle* const puzzle, const char connections[40],
+                                 const uint numUniqueConnectors );
+
+/*
+ * Whether connections from outside (a library caller, a daemon client) can be
+ * solved: numUniqueConnectors in [1, PUZZLE_MAX_CONNECTORS], every connection a
+ * connector in [1, numUniqueConnectors], either sign with SIGNED_CONNECTORS
+*/
+#define PUZZLE_MAX_CONNECTORS 31
+bool puzzle_connectionsValid( const char connections[40], const uint numUniqueConnectors );
+
 /*
  * Change the connections between Pieces with the given Puzzle
  *
@@ -60,6 +269,17 @@ Puzzle* puzzle_create( const uint numUniqueConnectors );
 */
 void puzzle_shuffle( Puzzle* const puzzle );
 
+/*
+ * Same as puzzle_shuffle, but the connections are built so the Puzzle always has
+ * at least one other solution
+ *
+ * Either two sides of the edge ring get the same connectors toward the corners and
+ * the center, so their edge triples can trade places, or two center Pieces that
+ * don't touch get the same 4 sides, so they can trade places. Only one of the two
+ * is planted, both would already be 3 other solutions. Everything else is random.
+*/
+void puzzle_generateSwappable( Puzzle* const puzzle );
+
 /*
  * Print the Puzzle layout
 */
@@ -96,11 +316,196 @@ void puzzle_findValidSolutions( const Puzzle* const puzzle,
                                 uint* const numOtherSolutions, const uint maxOtherSolutions,
                                 uint* const maxUniqueIndexes, uint* const maxUniqueSides );
 
-void puzzle_findMostUniqueSolution( const uint numUniqueConnections,
-                                    const uint generationSize,
-                                    const uint numGenerations,
-                                    const uint numSurvivors, const uint numChildren,
-                                    const uint minMutations, const uint maxMutations );
+/*
+ * Same as puzzle_findValidSolutions, but for a Puzzle whose EdgeSolutions are
+ * already in edgeSet, only the center stage is run
+ *
+ * Swapping connections that aren't on the edge ring doesn't change the
+ * EdgeSolutions, so an edgeSet from puzzle_findValidEdges stays good across them.
+*/
+void puzzle_findValidSolutions2( const Puzzle* const puzzle, const EdgeSet* const edgeSet,
+                                 PuzzleSolution* const otherSolutions,
+                                 uint* const numOtherSolutions, const uint maxOtherSolutions,
+                                 uint* const maxUniqueIndexes, uint* const maxUniqueSides );
+
+/*
+ * How many center layouts the center stage would find for edgeSolution with no cap,
+ * worked out without listing them (the original centers are left out for the
+ * original edges, same as the center stage)
+ *
+ * Counts Piece + rotation layouts, so a layout that only turns a Piece whose sides
+ * are all the same counts on its own. Only the few EdgeSolutions whose layouts need
+ * to be looked at have to go through the center stage.
+*/
+uint64_t puzzle_countCentersForEdge( const Puzzle* const puzzle,
+                                     const EdgeSolution* const edgeSolution );
+
+/*
+ * Shared by every thread working on one puzzle_findValidSolutionsParallel /
+ * Pipelined. The solve sets cancelled itself once it finds a second other
+ * solution, and the caller can set it from another thread to give up on the solve.
+*/
+typedef struct SolveControl {
+    atomic_bool cancelled;
+} SolveControl;
+
+/*
+ * Same answer as puzzle_findValidSolutions for one Puzzle, but split over the
+ * workers of pool: one task per corner arrangement finds the EdgeSolutions, and
+ * hands them out as tasks of a few dozen for the center stage. Idle workers
+ * steal whichever are queued.
+ *
+ * This is for solving one hard Puzzle quickly (low numUniqueConnectors, where
+ * there can be hundreds of thousands of EdgeSolutions). When there are many
+ * Puzzles, solving them on separate threads is faster.
+ *
+ * control can be NULL. Which two solutions are kept when there is more than one
+ * other solution depends on the timing.
+*/
+void puzzle_findValidSolutionsParallel( const Puzzle* const puzzle, StealPool* const pool,
+                                        SolveControl* control,
+                                        PuzzleSolution* const otherSolutions,
+                                        uint* const numOtherSolutions,
+                                        const uint maxOtherSolutions,
+                                        uint* const maxUniqueIndexes,
+                                        uint* const maxUniqueSides );
+
+/*
+ * Same answer as puzzle_findValidSolutions, with the two stages running at once:
+ * the calling thread finds EdgeSolutions and deals them out over lock-free rings to
+ * numCenterThreads threads running the center stage. When every ring is full the
+ * edge stage waits, and a cancel (including the early exit on a second other
+ * solution) stops both stages.
+ *
+ * control can be NULL. The threads only live for the call.
+*/
+void puzzle_findValidSolutionsPipelined( const Puzzle* const puzzle,
+                                         const uint numCenterThreads, SolveControl* control,
+                                         PuzzleSolution* const otherSolutions,
+                                         uint* const numOtherSolutions,
+                                         const uint maxOtherSolutions,
+                                         uint* const maxUniqueIndexes,
+                                         uint* const maxUniqueSides );
+
+/*
+ * Limits for one solve, 0 is no limit. A node is one candidate tried by the edge or
+ * center search (puzzle_recEdgeSolve / puzzle_recCenterSolve), about 10 ns.
+*/
+typedef struct SolveBudget {
+    uint64_t maxNodes;
+    uint64_t maxNanoseconds;
+} SolveBudget;
+
+typedef enum SolveVerdict {
+    SOLVE_COMPLETE, //the solve ran to the end (or stopped on a second other solution)
+    SOLVE_UNKNOWN //the budget ran out first, only what was found by then is filled in
+} SolveVerdict;
+
+/*
+ * How many budgeted solves ran, how many nodes they took between them, and how
+ * many ran out of nodes or out of time
+*/
+typedef struct SolveBudgetStats {
+    uint64_t numSolves;
+    uint64_t numNodes;
+    uint64_t numOutOfNodes;
+    uint64_t numOutOfTime;
+} SolveBudgetStats;
+
+/*
+ * puzzle_findValidSolutions, giving up once budget is used up
+ *
+ * The searches only count down a thread local counter per node, the node count
+ * and the clock are looked at every 1024 nodes, so the time limit is overshot by
+ * at most about that many nodes. stats can be NULL.
+*/
+SolveVerdict puzzle_findValidSolutionsBudgeted( const Puzzle* const puzzle,
+                                                const SolveBudget* const budget,
+                                                SolveBudgetStats* const stats,
+                                                PuzzleSolution* const otherSolutions,
+                                                uint* const numOtherSolutions,
+                                                const uint maxOtherSolutions,
+                                                uint* const maxUniqueIndexes,
+                                                uint* const maxUniqueSides );
+
+void solveBudget_printStats( const SolveBudgetStats* const stats );
+
+/*
+ * The buffers one solve works in, and the allocator they come from (NULL for
+ * malloc). puzzle_findValidSolutions keeps one per thread, a caller that wants to
+ * own the memory keeps its own.
+*/
+typedef struct SolveWorkspace {
+    EdgeSet edgeSet;
+    PackedCenterSolutionVec centerSolutions;
+    TripleIndexVec centerRows;
+    const Allocator* allocator;
+} SolveWorkspace;
+
+//error_raise's ERROR_OUT_OF_MEMORY if the buffers can't be allocated
+void solveWorkspace_init( SolveWorkspace* const workspace, const Allocator* const allocator );
+void solveWorkspace_free( SolveWorkspace* const workspace );
+
+/*
+ * puzzle_findValidSolutions(Budgeted) in workspace's buffers, returning an error
+ * instead of exiting: ERROR_OUT_OF_MEMORY, or ERROR_TOO_MANY_SOLUTIONS when
+ * maxOtherSolutions fills up. On an error the outputs are only partly filled in.
+ *
+ * budget can be NULL for no limit, then verdict is always SOLVE_COMPLETE and
+ * stats is left alone. One workspace can only be used by one thread at a time.
+*/
+ErrorCode puzzle_solveInWorkspace( SolveWorkspace* const workspace, const Puzzle* const puzzle,
+                                   const SolveBudget* const budget, SolveBudgetStats* const stats,
+                                   SolveVerdict* const verdict,
+                                   PuzzleSolution* const otherSolutions,
+                                   uint* const numOtherSolutions, const uint maxOtherSolutions,
+                                   uint* const maxUniqueIndexes, uint* const maxUniqueSides );
+
+/*
+ * Settings for puzzle_findMostUniqueSolution. Every generation has generationSize
+ * Puzzles with numUniqueConnectors; the best numSurvivors each get numChildren
+ * children and the rest of the next generation comes from generate.
+ *
+ * Every Puzzle that scores goes to resultLog and is offered to hallOfFame, either
+ * can be NULL.
+ *
+ * With a solveBudget (can be NULL), a Puzzle whose solve runs out of it scores 0.
+ * With maxSeconds (0 for none) of wall clock time, the run stops as soon as that
+ * is up, even in the middle of a generation.
+ *
+ * Children are made with compactPuzzle_mutate and [minMutations, maxMutations]
+ * swaps, or with a bandit (can be NULL, see bandit.h) it picks the operator and
+ * number of swaps for each child and learns from how they score. crossoverRate of
+ * the children are instead a compactPuzzle_crossover of their survivor's edge ring
+ * and another survivor's centers (0 for none).
+ *
+ * Unbudgeted solves take their EdgeSolutions from edgeCache (can be NULL) when the
+ * Puzzle's edge ring is in it, which doesn't change any score.
+*/
+typedef struct GaConfig {
+    uint numUniqueConnectors;
+    uint generationSize;
+    uint numGenerations;
+    uint numSurvivors;
+    uint numChildren;
+    uint minMutations;
+    uint maxMutations;
+    double crossoverRate;
+    PuzzleGenerator generate;
+    ResultLog* resultLog;
+    HallOfFame* hallOfFame;
+    const SolveBudget* solveBudget;
+    double maxSeconds;
+    MutationBandit* bandit;
+    EdgeRingCache* edgeCache;
+} GaConfig;
+
+/*
+ * Genetic search for the Puzzle with exactly one other solution that has the most
+ * unique sides + indexes. best (can be NULL) gets the best scoring Puzzle seen,
+ * returns false if none scored.
+*/
+bool puzzle_findMostUniqueSolution( const GaConfig* const config, ResultRecord* const best );
 
 /*
  * Free the given Puzzle
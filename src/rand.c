@@ -62,3 +62,19 @@ void rand_shuffle( void *array, size_t numElements, ssize_t elementSize ) {
         memcpy( &array[randIndex * elementSize], temp, elementSize );
     }
 }
+
+size_t rand_indexR( unsigned int* const seed, size_t size ) {
+    if ( ( size - 1 ) == RAND_MAX ) {
+        return rand_r( seed );
+    }
+    int end = RAND_MAX / size;
+    end *= size;
+
+    int r;
+    while ( ( r = rand_r( seed ) ) >= end );
+    return r % size;
+}
+
+float rand_floatR( unsigned int* const seed ) {
+    return ( 1.0 * rand_r( seed ) ) / ( 1.0 * RAND_MAX );
+}
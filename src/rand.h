@@ -10,5 +10,12 @@ float rand_float();
 float rand_floatBetween( float lowerBound, float upperBound );
 void rand_shuffle( void *array, size_t numElements, ssize_t elementSize );
 
+/*
+ * Same as rand_index/rand_float, but from rand_r with the caller's seed, so
+ * threads each get their own repeatable stream
+*/
+size_t rand_indexR( unsigned int* const seed, size_t size );
+float rand_floatR( unsigned int* const seed );
+
 
 #endif
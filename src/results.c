@@ -0,0 +1,376 @@
+#include "results.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+_Static_assert( sizeof( ResultRecord ) == 100, "ResultRecord has padding, the log format changed" );
+
+#define RESULT_LOG_MAGIC "JRL1"
+#define RESULT_LOG_CAPACITY 4096
+//records the flusher hands to one fwrite
+#define RESULT_LOG_BATCH 256
+
+typedef struct ResultLogHeader {
+    char magic[4];
+    uint32_t recordSize;
+} ResultLogHeader;
+
+static const char* sourceNames[] = { [RESULT_GA] = "ga", [RESULT_ANNEAL] = "anneal",
+                                     [RESULT_CLUSTER] = "cluster" };
+//what iteration counts for each source
+static const char* iterationNames[] = { [RESULT_GA] = "generation", [RESULT_ANNEAL] = "move",
+                                        [RESULT_CLUSTER] = "unit" };
+
+ResultRecord result_create( const Puzzle* const puzzle, const PuzzleSolution* const otherSolution,
+                            const uint uniqueSides, const uint uniqueIndexes,
+                            const ResultSource source, const uint worker,
+                            const uint iteration ) {
+    ResultRecord record = { .iteration = iteration,
+                            .worker = worker,
+                            .source = source,
+                            .numUniqueConnectors = puzzle->numUniqueConnectors,
+                            .uniqueSides = uniqueSides,
+                            .uniqueIndexes = uniqueIndexes,
+                            .otherSolution = *otherSolution };
+    memcpy( record.connections, puzzle->connections, sizeof( record.connections ) );
+    return record;
+}
+
+__inline__ uint result_score( const ResultRecord* const record ) {
+    return record->uniqueSides + record->uniqueIndexes;
+}
+
+//take the next record off the ring if there is one, only the flusher calls this
+static bool resultLog_pop( ResultLog* const log, ResultRecord* const record ) {
+    ResultLogSlot* const slot = &log->slots[log->tail & ( log->capacity - 1 )];
+    if ( atomic_load_explicit( &slot->sequence, memory_order_acquire ) != log->tail + 1 ) {
+        return false;
+    }
+    *record = slot->record;
+    atomic_store_explicit( &slot->sequence, log->tail + log->capacity, memory_order_release );
+    ++log->tail;
+    return true;
+}
+
+static void* resultLog_flush( void* arg ) {
+    ResultLog* const log = arg;
+    ResultRecord batch[RESULT_LOG_BATCH];
+    while ( true ) {
+        //read stop first, so nothing appended before it was set can be missed
+        const bool stopping = atomic_load( &log->stop );
+        uint numPopped = 0;
+        while ( numPopped < RESULT_LOG_BATCH && resultLog_pop( log, &batch[numPopped] ) ) {
+            ++numPopped;
+        }
+        if ( numPopped ) {
+            if ( fwrite( batch, sizeof( ResultRecord ), numPopped, log->file ) != numPopped ) {
+                fprintf( stderr, "Could not write result log\n" );
+                exit( 1 );
+            }
+            log->numWritten += numPopped;
+            continue;
+        }
+        if ( stopping ) {
+            return NULL;
+        }
+        const struct timespec wait = { .tv_sec = 0, .tv_nsec = 1000000 };
+        nanosleep( &wait, NULL );
+    }
+}
+
+ResultLog* resultLog_open( const char* const path ) {
+    ResultLog* log = calloc( 1, sizeof( ResultLog ) );
+    if ( !log ) {
+        fprintf( stderr, "Could not allocate result log\n" );
+        exit( 1 );
+    }
+    log->file = fopen( path, "wb" );
+    if ( !log->file ) {
+        fprintf( stderr, "Could not open result log %s\n", path );
+        exit( 1 );
+    }
+    ResultLogHeader header = { .recordSize = sizeof( ResultRecord ) };
+    memcpy( header.magic, RESULT_LOG_MAGIC, sizeof( header.magic ) );
+    if ( fwrite( &header, sizeof( header ), 1, log->file ) != 1 ) {
+        fprintf( stderr, "Could not write result log %s\n", path );
+        exit( 1 );
+    }
+
+    log->capacity = RESULT_LOG_CAPACITY;
+    log->slots = malloc( sizeof( ResultLogSlot ) * log->capacity );
+    if ( !log->slots ) {
+        fprintf( stderr, "Could not allocate result log\n" );
+        exit( 1 );
+    }
+    //a slot can be appended to when its sequence is the head, and flushed when it
+    //is one past the tail
+    for ( size_t i = 0; i < log->capacity; ++i ) {
+        atomic_init( &log->slots[i].sequence, i );
+    }
+    atomic_init( &log->head, 0 );
+    atomic_init( &log->stop, false );
+    atomic_init( &log->numDropped, 0 );
+    pthread_create( &log->flusher, NULL, resultLog_flush, log );
+    return log;
+}
+
+bool resultLog_append( ResultLog* const log, const ResultRecord* const record ) {
+    size_t position = atomic_load_explicit( &log->head, memory_order_relaxed );
+    ResultLogSlot* slot;
+    while ( true ) {
+        slot = &log->slots[position & ( log->capacity - 1 )];
+        const size_t sequence = atomic_load_explicit( &slot->sequence, memory_order_acquire );
+        if ( sequence == position ) {
+            if ( atomic_compare_exchange_weak_explicit( &log->head, &position, position + 1,
+                                                        memory_order_relaxed,
+                                                        memory_order_relaxed ) ) {
+                break;
+            }
+        } else if ( ( intptr_t ) ( sequence - position ) < 0 ) {
+            //the flusher hasn't freed this slot since the last lap
+            atomic_fetch_add_explicit( &log->numDropped, 1, memory_order_relaxed );
+            return false;
+        } else {
+            position = atomic_load_explicit( &log->head, memory_order_relaxed );
+        }
+    }
+    slot->record = *record;
+    atomic_store_explicit( &slot->sequence, position + 1, memory_order_release );
+    return true;
+}
+
+void resultLog_close( ResultLog* const log ) {
+    if ( !log ) {
+        return;
+    }
+    atomic_store( &log->stop, true );
+    pthread_join( log->flusher, NULL );
+    fclose( log->file );
+    printf( "Result log: %" PRIu64 " records written, %" PRIu64 " dropped\n", log->numWritten,
+            ( uint64_t ) atomic_load( &log->numDropped ) );
+    free( log->slots );
+    free( log );
+}
+
+static void printConnections( const char connections[40] ) {
+    for ( uint j = 0; j < 40; ++j ) {
+        if ( j ) {
+            printf( ", " );
+        }
+        printf( "%i", connections[j] );
+    }
+    printf( "\n" );
+}
+
+static void printRecord( const ResultRecord* const record ) {
+    printf( "%s %u, %s %u: %u (%u sides + %u indexes), %u unique connectors\n",
+            sourceNames[record->source],
+            record->worker, iterationNames[record->source],
+            record->iteration, result_score( record ), record->uniqueSides,
+            record->uniqueIndexes, record->numUniqueConnectors );
+    printConnections( record->connections );
+    puzzle_printSolution( &record->otherSolution );
+}
+
+static void printRecordCsv( const ResultRecord* const record ) {
+    printf( "%s,%u,%u,%u,%u,%u,%u,", sourceNames[record->source], record->worker,
+            record->iteration, record->numUniqueConnectors, result_score( record ),
+            record->uniqueSides, record->uniqueIndexes );
+    for ( uint j = 0; j < 40; ++j ) {
+        printf( j ? " %i" : "%i", record->connections[j] );
+    }
+    printf( "," );
+    for ( uint j = 0; j < 25; ++j ) {
+        printf( j ? " %i" : "%i", record->otherSolution.indexes[j] );
+    }
+    printf( "," );
+    for ( uint j = 0; j < 25; ++j ) {
+        printf( j ? " %i" : "%i", record->otherSolution.rotations[j] );
+    }
+    printf( "\n" );
+}
+
+void resultLog_print( const char* const path, const bool csv ) {
+    FILE* file = fopen( path, "rb" );
+    if ( !file ) {
+        fprintf( stderr, "Could not open result log %s\n", path );
+        exit( 1 );
+    }
+    ResultLogHeader header;
+    if ( fread( &header, sizeof( header ), 1, file ) != 1 ||
+         memcmp( header.magic, RESULT_LOG_MAGIC, sizeof( header.magic ) ) != 0 ||
+         header.recordSize != sizeof( ResultRecord ) ) {
+        fprintf( stderr, "%s is not a result log from this build\n", path );
+        exit( 1 );
+    }
+
+    if ( csv ) {
+        printf( "source,worker,iteration,numUniqueConnectors,score,uniqueSides,uniqueIndexes,"
+                "connections,otherIndexes,otherRotations\n" );
+    }
+    ResultRecord record;
+    while ( fread( &record, sizeof( record ), 1, file ) == 1 ) {
+        if ( csv ) {
+            printRecordCsv( &record );
+        } else {
+            printRecord( &record );
+        }
+    }
+    fclose( file );
+}
+
+//key layout: score in the top 16 bits, then the busy bit, then the fingerprint
+#define HALL_SCORE_SHIFT 48
+#define HALL_BUSY ( ( ( uint64_t ) 1 ) << 47 )
+#define HALL_FINGERPRINT_MASK ( HALL_BUSY - 1 )
+
+static uint keyScore( const uint64_t key ) {
+    return key >> HALL_SCORE_SHIFT;
+}
+
+//FNV-1a of the connections
+static uint64_t fingerprint( const char connections[40] ) {
+    uint64_t hash = 14695981039346656037ull;
+    for ( uint i = 0; i < 40; ++i ) {
+        hash ^= ( unsigned char ) connections[i];
+        hash *= 1099511628211ull;
+    }
+    return hash & HALL_FINGERPRINT_MASK;
+}
+
+void hallOfFame_init( HallOfFame* const hallOfFame, const uint size ) {
+    hallOfFame->size = size;
+    hallOfFame->slots = malloc( sizeof( HallOfFameSlot ) * size );
+    if ( !hallOfFame->slots ) {
+        fprintf( stderr, "Could not allocate hall of fame\n" );
+        exit( 1 );
+    }
+    for ( uint i = 0; i < size; ++i ) {
+        atomic_init( &hallOfFame->slots[i].key, 0 );
+    }
+    atomic_init( &hallOfFame->minScore, 0 );
+}
+
+void hallOfFame_free( HallOfFame* const hallOfFame ) {
+    free( hallOfFame->slots );
+    hallOfFame->slots = NULL;
+}
+
+//published slots only ever get better, so raising minScore to the lowest key seen
+//is safe. A busy slot can still go back to the key it had, so nothing is raised then
+static void hallOfFame_raiseMinScore( HallOfFame* const hallOfFame ) {
+    uint lowest = UINT32_MAX;
+    for ( uint i = 0; i < hallOfFame->size; ++i ) {
+        const uint64_t key = atomic_load( &hallOfFame->slots[i].key );
+        if ( key & HALL_BUSY ) {
+            return;
+        }
+        const uint score = keyScore( key );
+        if ( score < lowest ) {
+            lowest = score;
+        }
+    }
+    uint minScore = atomic_load( &hallOfFame->minScore );
+    while ( lowest > minScore &&
+            !atomic_compare_exchange_weak( &hallOfFame->minScore, &minScore, lowest ) ) {
+    }
+}
+
+bool hallOfFame_offer( HallOfFame* const hallOfFame, const ResultRecord* const record ) {
+    const uint score = result_score( record );
+    if ( score <= atomic_load_explicit( &hallOfFame->minScore, memory_order_relaxed ) ) {
+        return false;
+    }
+    const uint64_t recordFingerprint = fingerprint( record->connections );
+    const uint64_t key = ( ( uint64_t ) score << HALL_SCORE_SHIFT ) | recordFingerprint;
+
+    uint slot;
+    uint64_t evictedKey;
+    while ( true ) {
+        //find the lowest slot nobody is writing, unless the record is already held
+        uint lowest = hallOfFame->size;
+        uint64_t lowestKey = UINT64_MAX;
+        for ( uint i = 0; i < hallOfFame->size; ++i ) {
+            const uint64_t slotKey = atomic_load_explicit( &hallOfFame->slots[i].key,
+                                                           memory_order_acquire );
+            if ( slotKey && ( slotKey & HALL_FINGERPRINT_MASK ) == recordFingerprint ) {
+                return false;
+            }
+            if ( !( slotKey & HALL_BUSY ) && keyScore( slotKey ) < keyScore( lowestKey ) ) {
+                lowest = i;
+                lowestKey = slotKey;
+            }
+        }
+        if ( lowest == hallOfFame->size ) {
+            //every slot is mid write, which is only ever a memcpy
+            continue;
+        }
+        if ( keyScore( lowestKey ) >= score ) {
+            hallOfFame_raiseMinScore( hallOfFame );
+            return false;
+        }
+        if ( atomic_compare_exchange_weak( &hallOfFame->slots[lowest].key, &lowestKey,
+                                           key | HALL_BUSY ) ) {
+            slot = lowest;
+            evictedKey = lowestKey;
+            break;
+        }
+    }
+
+    //two threads offering the same Puzzle at once can both get past the check
+    //above. Both have claimed a slot before looking again, so at least one sees the
+    //other's key. One that sees the record held gives way and puts the evicted key
+    //back, its record hasn't been overwritten yet. When both are still busy the
+    //later slot gives way, the earlier one waits for it to finish or give way
+    for ( uint i = 0; i < hallOfFame->size; ++i ) {
+        if ( i == slot ) {
+            continue;
+        }
+        uint64_t slotKey = atomic_load( &hallOfFame->slots[i].key );
+        while ( i > slot && ( slotKey & HALL_BUSY ) &&
+                ( slotKey & HALL_FINGERPRINT_MASK ) == recordFingerprint ) {
+            slotKey = atomic_load( &hallOfFame->slots[i].key );
+        }
+        if ( slotKey && ( slotKey & HALL_FINGERPRINT_MASK ) == recordFingerprint ) {
+            atomic_store( &hallOfFame->slots[slot].key, evictedKey );
+            return false;
+        }
+    }
+    hallOfFame->slots[slot].record = *record;
+    atomic_store_explicit( &hallOfFame->slots[slot].key, key, memory_order_release );
+    hallOfFame_raiseMinScore( hallOfFame );
+    return true;
+}
+
+static int recordSortDescending( const void* p1, const void* p2 ) {
+    return result_score( p2 ) - result_score( p1 );
+}
+
+uint hallOfFame_sorted( const HallOfFame* const hallOfFame, ResultRecord* const records ) {
+    uint numRecords = 0;
+    for ( uint i = 0; i < hallOfFame->size; ++i ) {
+        if ( atomic_load( &hallOfFame->slots[i].key ) ) {
+            records[numRecords++] = hallOfFame->slots[i].record;
+        }
+    }
+    qsort( records, numRecords, sizeof( ResultRecord ), recordSortDescending );
+    return numRecords;
+}
+
+void hallOfFame_print( const HallOfFame* const hallOfFame ) {
+    ResultRecord* records = malloc( sizeof( ResultRecord ) * hallOfFame->size );
+    if ( !records ) {
+        fprintf( stderr, "Could not allocate hall of fame\n" );
+        exit( 1 );
+    }
+    const uint numRecords = hallOfFame_sorted( hallOfFame, records );
+    printf( "--------Top %u of %u--------\n", numRecords, hallOfFame->size );
+    for ( uint i = 0; i < numRecords; ++i ) {
+        printf( "%u. %u (%u sides + %u indexes), %s %u, %s %u\n", i + 1,
+                result_score( &records[i] ), records[i].uniqueSides, records[i].uniqueIndexes,
+                sourceNames[records[i].source], records[i].worker,
+                iterationNames[records[i].source], records[i].iteration );
+        printConnections( records[i].connections );
+    }
+    free( records );
+}
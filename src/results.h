@@ -0,0 +1,136 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "puzzle.h"
+
+typedef enum ResultSource {
+    RESULT_GA,
+    RESULT_ANNEAL,
+    RESULT_CLUSTER
+} ResultSource;
+
+/*
+ * One Puzzle with exactly one other solution, as written to a result log
+ *
+ * iteration is the GA generation, anneal move or cluster unit it was found on,
+ * worker the anneal chain or the coordinator's slot for the worker process (0
+ * for the GA). Records go to the file as is, so fields are ordered to leave no
+ * padding.
+*/
+typedef struct ResultRecord {
+    uint32_t iteration;
+    uint16_t worker;
+    uint8_t source;
+    uint8_t numUniqueConnectors;
+    uint8_t uniqueSides;
+    uint8_t uniqueIndexes;
+    char connections[40];
+    PuzzleSolution otherSolution;
+} ResultRecord;
+
+/*
+ * Fill in a ResultRecord, score is uniqueSides + uniqueIndexes
+*/
+ResultRecord result_create( const Puzzle* const puzzle, const PuzzleSolution* const otherSolution,
+                            const uint uniqueSides, const uint uniqueIndexes,
+                            const ResultSource source, const uint worker,
+                            const uint iteration );
+
+uint result_score( const ResultRecord* const record );
+
+/*
+ * Binary log of ResultRecords, written by a background thread
+ *
+ * resultLog_append only copies the record into a bounded ring, so solver threads
+ * never wait on the file. If the flusher falls so far behind that the ring is
+ * full, the record is dropped and counted instead.
+*/
+typedef struct ResultLogSlot {
+    atomic_size_t sequence;
+    ResultRecord record;
+} ResultLogSlot;
+
+typedef struct ResultLog {
+    FILE* file;
+    ResultLogSlot* slots;
+    size_t capacity; //power of 2
+    atomic_size_t head; //next slot to append to
+    size_t tail; //next slot to flush, only the flusher touches it
+    atomic_bool stop;
+    pthread_t flusher;
+    atomic_uint_fast64_t numDropped;
+    uint64_t numWritten;
+} ResultLog;
+
+/*
+ * Create path (replacing whatever was there) and start its flusher, exits if
+ * the file can't be written
+*/
+ResultLog* resultLog_open( const char* const path );
+
+/*
+ * Queue record for writing, returns false if it was dropped. Safe to call
+ * from any number of threads at once.
+*/
+bool resultLog_append( ResultLog* const log, const ResultRecord* const record );
+
+/*
+ * Flush everything queued, stop the flusher and close the file. Prints how many
+ * records were written and dropped.
+*/
+void resultLog_close( ResultLog* const log );
+
+/*
+ * Print every record of the log at path, as text (like the GA prints its best)
+ * or as CSV with one row per record. Exits if path isn't a result log.
+*/
+void resultLog_print( const char* const path, const bool csv );
+
+/*
+ * The best size records offered to it, never holding the same connections twice
+ *
+ * Each slot's key packs its score, a busy bit and a fingerprint of its
+ * connections, so a record is claimed, deduplicated and published with compare
+ * and swaps on the key alone. An offer that loses a race for a slot tries again
+ * against the new keys, and most offers are turned away by minScore without
+ * touching the slots at all. hallOfFame_offer only waits when another thread is
+ * offering the same connections into a later slot at the same time.
+*/
+typedef struct HallOfFameSlot {
+    atomic_uint_fast64_t key;
+    ResultRecord record;
+} HallOfFameSlot;
+
+typedef struct HallOfFame {
+    HallOfFameSlot* slots;
+    uint size;
+    atomic_uint minScore; //every slot scores at least this
+} HallOfFame;
+
+void hallOfFame_init( HallOfFame* const hallOfFame, const uint size );
+void hallOfFame_free( HallOfFame* const hallOfFame );
+
+/*
+ * Keep record if it beats the lowest scoring slot and isn't already held,
+ * returns whether it was kept
+*/
+bool hallOfFame_offer( HallOfFame* const hallOfFame, const ResultRecord* const record );
+
+/*
+ * Copy out the held records, best first, returns how many there are. Only call
+ * once no thread is offering anymore.
+*/
+uint hallOfFame_sorted( const HallOfFame* const hallOfFame, ResultRecord* const records );
+
+/*
+ * Print the held records, best first, as text
+*/
+void hallOfFame_print( const HallOfFame* const hallOfFame );
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Lock-free ring buffer between exactly one producer thread and one consumer thread
+ *
+ * SPSC_DEFINE( Name, Type, prefix ) generates a Name struct holding up to capacity
+ * Type elements and static inline functions named prefix_xxx, the same way
+ * VEC_DEFINE does.
+ *
+ * Generated functions:
+ *  - prefix_init( ring, capacity ): allocate room, capacity is rounded up to a power of 2
+ *  - prefix_push( ring, element ): producer only, false if the ring is full
+ *  - prefix_pop( ring, element ): consumer only, false if the ring is empty
+ *  - prefix_free( ring )
+ *
+ * head and tail are on their own cache lines, and each side keeps a copy of the
+ * other's index that it only reloads when the ring looks full (or empty), so the
+ * two threads don't pass a cache line back and forth on every element.
+*/
+#define SPSC_CACHE_LINE 64
+
+#define SPSC_DEFINE( Name, Type, prefix )                                              \
+typedef struct Name {                                                                  \
+    _Alignas( SPSC_CACHE_LINE ) atomic_size_t head; /*next to pop*/                    \
+    size_t cachedTail;                                                                 \
+    _Alignas( SPSC_CACHE_LINE ) atomic_size_t tail; /*next to push*/                   \
+    size_t cachedHead;                                                                 \
+    _Alignas( SPSC_CACHE_LINE ) Type* contents;                                        \
+    size_t mask;                                                                       \
+} Name;                                                                                \
+                                                                                       \
+static inline void prefix##_init( Name* const ring, const size_t capacity ) {          \
+    size_t size = 1;                                                                   \
+    while ( size < capacity ) {                                                        \
+        size *= 2;                                                                     \
+    }                                                                                  \
+    ring->contents = malloc( size * sizeof( Type ) );                                  \
+    if ( !ring->contents ) {                                                           \
+        fprintf( stderr, "Could not allocate ring of %lu elements of size %lu\n",      \
+                 size, sizeof( Type ) );                                               \
+        exit( 1 );                                                                     \
+    }                                                                                  \
+    ring->mask = size - 1;                                                             \
+    atomic_init( &ring->head, 0 );                                                     \
+    atomic_init( &ring->tail, 0 );                                                     \
+    ring->cachedHead = 0;                                                              \
+    ring->cachedTail = 0;                                                              \
+}                                                                                      \
+                                                                                       \
+static inline bool prefix##_push( Name* const ring, const Type element ) {             \
+    const size_t tail = atomic_load_explicit( &ring->tail, memory_order_relaxed );     \
+    if ( tail - ring->cachedHead > ring->mask ) {                                      \
+        ring->cachedHead = atomic_load_explicit( &ring->head, memory_order_acquire );  \
+        if ( tail - ring->cachedHead > ring->mask ) {                                  \
+            return false;                                                              \
+        }                                                                              \
+    }                                                                                  \
+    ring->contents[tail & ring->mask] = element;                                       \
+    atomic_store_explicit( &ring->tail, tail + 1, memory_order_release );              \
+    return true;                                                                       \
+}                                                                                      \
+                                                                                       \
+static inline bool prefix##_pop( Name* const ring, Type* const element ) {             \
+    const size_t head = atomic_load_explicit( &ring->head, memory_order_relaxed );     \
+    if ( head == ring->cachedTail ) {                                                  \
+        ring->cachedTail = atomic_load_explicit( &ring->tail, memory_order_acquire );  \
+        if ( head == ring->cachedTail ) {                                              \
+            return false;                                                              \
+        }                                                                              \
+    }                                                                                  \
+    *element = ring->contents[head & ring->mask];                                      \
+    atomic_store_explicit( &ring->head, head + 1, memory_order_release );              \
+    return true;                                                                       \
+}                                                                                      \
+                                                                                       \
+static inline void prefix##_free( Name* const ring ) {                                 \
+    free( ring->contents );                                                            \
+    ring->contents = NULL;                                                             \
+}
+
+#endif
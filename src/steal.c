@@ -0,0 +1,203 @@
+#include "steal.h"
+#include <sched.h>
+#include <stdio.h>
+
+#define STEAL_DEQUE_CAPACITY 8192
+
+typedef struct StealWorker {
+    StealPool* pool;
+    uint index;
+} StealWorker;
+
+static void deque_init( StealDeque* const deque ) {
+    atomic_init( &deque->top, 0 );
+    atomic_init( &deque->bottom, 0 );
+    deque->capacity = STEAL_DEQUE_CAPACITY;
+    deque->tasks = malloc( sizeof( *deque->tasks ) * deque->capacity );
+    if ( !deque->tasks ) {
+        fprintf( stderr, "Could not allocate work stealing deque\n" );
+        exit( 1 );
+    }
+}
+
+//owner only, returns false if the deque is full
+static bool deque_push( StealDeque* const deque, StealTask* const task ) {
+    const int64_t bottom = atomic_load_explicit( &deque->bottom, memory_order_relaxed );
+    const int64_t top = atomic_load_explicit( &deque->top, memory_order_acquire );
+    if ( bottom - top >= deque->capacity ) {
+        return false;
+    }
+    atomic_store_explicit( &deque->tasks[bottom % deque->capacity], task, memory_order_relaxed );
+    //a thief that sees the new bottom sees the task (and what it points to)
+    atomic_store_explicit( &deque->bottom, bottom + 1, memory_order_release );
+    return true;
+}
+
+//owner only, newest task first
+static StealTask* deque_take( StealDeque* const deque ) {
+    const int64_t bottom = atomic_load_explicit( &deque->bottom, memory_order_relaxed ) - 1;
+    atomic_store_explicit( &deque->bottom, bottom, memory_order_relaxed );
+    atomic_thread_fence( memory_order_seq_cst );
+    int64_t top = atomic_load_explicit( &deque->top, memory_order_relaxed );
+    if ( top > bottom ) {
+        atomic_store_explicit( &deque->bottom, bottom + 1, memory_order_relaxed );
+        return NULL;
+    }
+    StealTask* task = atomic_load_explicit( &deque->tasks[bottom % deque->capacity],
+                                            memory_order_relaxed );
+    if ( top == bottom ) {
+        //last task, a thief could be going for it too
+        if ( !atomic_compare_exchange_strong_explicit( &deque->top, &top, top + 1,
+                                                       memory_order_seq_cst,
+                                                       memory_order_relaxed ) ) {
+            task = NULL;
+        }
+        atomic_store_explicit( &deque->bottom, bottom + 1, memory_order_relaxed );
+    }
+    return task;
+}
+
+//any worker, oldest task first. NULL if empty or another thief got there first
+static StealTask* deque_steal( StealDeque* const deque ) {
+    int64_t top = atomic_load_explicit( &deque->top, memory_order_acquire );
+    atomic_thread_fence( memory_order_seq_cst );
+    const int64_t bottom = atomic_load_explicit( &deque->bottom, memory_order_acquire );
+    if ( top >= bottom ) {
+        return NULL;
+    }
+    StealTask* task = atomic_load_explicit( &deque->tasks[top % deque->capacity],
+                                            memory_order_relaxed );
+    if ( !atomic_compare_exchange_strong_explicit( &deque->top, &top, top + 1,
+                                                   memory_order_seq_cst,
+                                                   memory_order_relaxed ) ) {
+        return NULL;
+    }
+    return task;
+}
+
+static void stealPool_execute( StealPool* const pool, const uint worker, StealTask* const task ) {
+    task->run( pool, worker, task->arg );
+    free( task );
+    atomic_fetch_sub( &pool->numPending, 1 );
+}
+
+//own deque first, then go around the others
+static StealTask* stealPool_find( StealPool* const pool, const uint worker ) {
+    StealTask* task = deque_take( &pool->deques[worker] );
+    for ( uint i = 1; !task && i < pool->numWorkers; ++i ) {
+        task = deque_steal( &pool->deques[( worker + i ) % pool->numWorkers] );
+    }
+    return task;
+}
+
+static void* stealPool_work( void* arg ) {
+    StealWorker* const self = arg;
+    StealPool* const pool = self->pool;
+    while ( true ) {
+        StealTask* const task = stealPool_find( pool, self->index );
+        if ( task ) {
+            stealPool_execute( pool, self->index, task );
+            continue;
+        }
+        if ( atomic_load( &pool->numPending ) ) {
+            //tasks are running that may spawn more
+            sched_yield();
+            continue;
+        }
+        pthread_mutex_lock( &pool->lock );
+        atomic_fetch_add( &pool->numSleeping, 1 );
+        while ( !pool->shutdown && atomic_load( &pool->numPending ) == 0 ) {
+            pthread_cond_wait( &pool->wake, &pool->lock );
+        }
+        atomic_fetch_sub( &pool->numSleeping, 1 );
+        const bool shutdown = pool->shutdown;
+        pthread_mutex_unlock( &pool->lock );
+        if ( shutdown ) {
+            free( self );
+            return NULL;
+        }
+    }
+}
+
+StealPool* stealPool_create( const uint numWorkers ) {
+    StealPool* pool = calloc( 1, sizeof( StealPool ) );
+    if ( !pool || numWorkers == 0 ) {
+        fprintf( stderr, "Could not create a work stealing pool of %u workers\n", numWorkers );
+        exit( 1 );
+    }
+    pool->numWorkers = numWorkers;
+    pool->deques = malloc( sizeof( StealDeque ) * numWorkers );
+    pool->threads = malloc( sizeof( pthread_t ) * numWorkers );
+    if ( !pool->deques || !pool->threads ) {
+        fprintf( stderr, "Could not create a work stealing pool of %u workers\n", numWorkers );
+        exit( 1 );
+    }
+    for ( uint i = 0; i < numWorkers; ++i ) {
+        deque_init( &pool->deques[i] );
+    }
+    atomic_init( &pool->numPending, 0 );
+    atomic_init( &pool->numSleeping, 0 );
+    pthread_mutex_init( &pool->lock, NULL );
+    pthread_cond_init( &pool->wake, NULL );
+    for ( uint i = 1; i < numWorkers; ++i ) {
+        StealWorker* worker = malloc( sizeof( StealWorker ) );
+        if ( !worker ) {
+            fprintf( stderr, "Could not create a work stealing pool of %u workers\n", numWorkers );
+            exit( 1 );
+        }
+        *worker = ( StealWorker ) { .pool = pool, .index = i };
+        pthread_create( &pool->threads[i], NULL, stealPool_work, worker );
+    }
+    return pool;
+}
+
+void stealPool_spawn( StealPool* const pool, const uint worker, const StealTaskFunction run,
+                      void* const arg ) {
+    StealTask* task = malloc( sizeof( StealTask ) );
+    if ( !task ) {
+        fprintf( stderr, "Could not allocate a task\n" );
+        exit( 1 );
+    }
+    *task = ( StealTask ) { .run = run, .arg = arg };
+    atomic_fetch_add( &pool->numPending, 1 );
+    if ( !deque_push( &pool->deques[worker], task ) ) {
+        stealPool_execute( pool, worker, task );
+        return;
+    }
+    //a sleeper counts itself before checking numPending, so one of the two sees the other
+    if ( atomic_load( &pool->numSleeping ) ) {
+        pthread_mutex_lock( &pool->lock );
+        pthread_cond_broadcast( &pool->wake );
+        pthread_mutex_unlock( &pool->lock );
+    }
+}
+
+void stealPool_run( StealPool* const pool, const StealTaskFunction run, void* const arg ) {
+    stealPool_spawn( pool, 0, run, arg );
+    while ( atomic_load( &pool->numPending ) ) {
+        StealTask* const task = stealPool_find( pool, 0 );
+        if ( task ) {
+            stealPool_execute( pool, 0, task );
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+void stealPool_free( StealPool* const pool ) {
+    pthread_mutex_lock( &pool->lock );
+    pool->shutdown = true;
+    pthread_cond_broadcast( &pool->wake );
+    pthread_mutex_unlock( &pool->lock );
+    for ( uint i = 1; i < pool->numWorkers; ++i ) {
+        pthread_join( pool->threads[i], NULL );
+    }
+    for ( uint i = 0; i < pool->numWorkers; ++i ) {
+        free( pool->deques[i].tasks );
+    }
+    pthread_mutex_destroy( &pool->lock );
+    pthread_cond_destroy( &pool->wake );
+    free( pool->deques );
+    free( pool->threads );
+    free( pool );
+}
@@ -0,0 +1,67 @@
+#ifndef STEAL_H
+#define STEAL_H
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef struct StealPool StealPool;
+
+/*
+ * A task gets the pool and the index of the worker running it, which is what it
+ * spawns more tasks with
+*/
+typedef void ( *StealTaskFunction )( StealPool* const pool, const uint worker, void* const arg );
+
+typedef struct StealTask {
+    StealTaskFunction run;
+    void* arg;
+} StealTask;
+
+/*
+ * Chase-Lev deque: the owning worker pushes and takes at the bottom, every other
+ * worker steals from the top. Fixed size, a push that doesn't fit runs the task
+ * right away instead.
+*/
+typedef struct StealDeque {
+    atomic_int_fast64_t top;
+    atomic_int_fast64_t bottom;
+    _Atomic( StealTask* )* tasks;
+    int64_t capacity;
+} StealDeque;
+
+struct StealPool {
+    uint numWorkers;
+    StealDeque* deques; //one per worker
+    pthread_t* threads; //numWorkers - 1, worker 0 is whoever calls stealPool_run
+    atomic_size_t numPending; //spawned and not finished yet
+    atomic_uint numSleeping;
+    bool shutdown;
+    pthread_mutex_t lock; //for sleeping until there is work
+    pthread_cond_t wake;
+};
+
+/*
+ * Start a pool of numWorkers workers, counting the thread that calls stealPool_run,
+ * so numWorkers - 1 threads are made. The threads sleep while no run is going.
+*/
+StealPool* stealPool_create( const uint numWorkers );
+
+/*
+ * Run task and everything it spawns, returns once they are all done. The calling
+ * thread works as worker 0 until then. Only one run at a time.
+*/
+void stealPool_run( StealPool* const pool, const StealTaskFunction run, void* const arg );
+
+/*
+ * Queue a task from inside a running task, worker is the one the spawning task
+ * was given. Idle workers steal it if worker doesn't get to it first.
+*/
+void stealPool_spawn( StealPool* const pool, const uint worker, const StealTaskFunction run,
+                      void* const arg );
+
+void stealPool_free( StealPool* const pool );
+
+#endif
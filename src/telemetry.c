@@ -0,0 +1,216 @@
+#include "telemetry.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TELEMETRY_SOCKET_PREFIX "unix:"
+
+atomic_bool telemetryEnabled = false;
+__thread TelemetryBlock* telemetryBlock = NULL;
+
+//blocks are never freed, a thread that exits keeps its counts in the totals
+static _Atomic( TelemetryBlock* ) blocks = NULL;
+static atomic_uint_fast64_t lastGenerationNanoseconds = 0;
+static atomic_uint bestScore = 0;
+
+typedef struct TelemetryExporter {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool stop;
+    uint intervalMilliseconds;
+    const char* destination;
+    FILE* file; //NULL when exporting to a socket
+    int socket; //-1 when not connected
+    struct timespec startTime;
+    TelemetrySnapshot last;
+    double lastSeconds;
+} TelemetryExporter;
+
+static TelemetryExporter exporter;
+
+TelemetryBlock* telemetry_register() {
+    TelemetryBlock* const block = aligned_alloc( _Alignof( TelemetryBlock ),
+                                                 sizeof( TelemetryBlock ) );
+    if ( !block ) {
+        fprintf( stderr, "Could not allocate telemetry counters\n" );
+        exit( 1 );
+    }
+    for ( uint i = 0; i < TELEMETRY_NUM_COUNTERS; ++i ) {
+        atomic_init( &block->counters[i], 0 );
+    }
+    block->next = atomic_load( &blocks );
+    while ( !atomic_compare_exchange_weak( &blocks, &block->next, block ) ) {
+    }
+    telemetryBlock = block;
+    return block;
+}
+
+void telemetry_recordGeneration( const uint64_t nanoseconds ) {
+    telemetry_add( TELEMETRY_GENERATIONS, 1 );
+    telemetry_add( TELEMETRY_GENERATION_NANOSECONDS, nanoseconds );
+    atomic_store_explicit( &lastGenerationNanoseconds, nanoseconds, memory_order_relaxed );
+}
+
+void telemetry_offerBest( const uint score ) {
+    uint best = atomic_load_explicit( &bestScore, memory_order_relaxed );
+    while ( score > best &&
+            !atomic_compare_exchange_weak( &bestScore, &best, score ) ) {
+    }
+}
+
+void telemetry_snapshot( TelemetrySnapshot* const snapshot ) {
+    memset( snapshot, 0, sizeof( *snapshot ) );
+    for ( TelemetryBlock* block = atomic_load( &blocks ); block; block = block->next ) {
+        for ( uint i = 0; i < TELEMETRY_NUM_COUNTERS; ++i ) {
+            snapshot->counters[i] += atomic_load_explicit( &block->counters[i],
+                                                           memory_order_relaxed );
+        }
+    }
+    snapshot->lastGenerationNanoseconds = atomic_load_explicit( &lastGenerationNanoseconds,
+                                                                memory_order_relaxed );
+    snapshot->bestScore = atomic_load_explicit( &bestScore, memory_order_relaxed );
+}
+
+static double secondsSince( const struct timespec* const start ) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec - start->tv_sec + ( now.tv_nsec - start->tv_nsec ) / 1e9;
+}
+
+static double ratio( const uint64_t part, const uint64_t whole ) {
+    return whole ? part * 1.0 / whole : 0.0;
+}
+
+static int telemetry_connect( const char* const path ) {
+    struct sockaddr_un address;
+    memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    if ( strlen( path ) >= sizeof( address.sun_path ) ) {
+        return -1;
+    }
+    strcpy( address.sun_path, path );
+    const int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd >= 0 && connect( fd, ( struct sockaddr* ) &address, sizeof( address ) ) != 0 ) {
+        close( fd );
+        return -1;
+    }
+    return fd;
+}
+
+static void telemetry_write( const char* const line, const size_t length ) {
+    if ( exporter.file ) {
+        fwrite( line, 1, length, exporter.file );
+        fflush( exporter.file );
+        return;
+    }
+    //whoever was listening may have gone away, try again on the next line
+    if ( exporter.socket < 0 ) {
+        exporter.socket = telemetry_connect( exporter.destination +
+                                             strlen( TELEMETRY_SOCKET_PREFIX ) );
+    }
+    if ( exporter.socket >= 0 &&
+         send( exporter.socket, line, length, MSG_NOSIGNAL ) != ( ssize_t ) length ) {
+        close( exporter.socket );
+        exporter.socket = -1;
+    }
+}
+
+static void telemetry_export() {
+    TelemetrySnapshot now;
+    telemetry_snapshot( &now );
+    const double seconds = secondsSince( &exporter.startTime );
+    const uint64_t* const counters = now.counters;
+    const uint64_t evaluations = counters[TELEMETRY_EVALUATIONS];
+    const uint64_t generations = counters[TELEMETRY_GENERATIONS];
+    char line[512];
+    const double interval = seconds - exporter.lastSeconds;
+    const double evaluationsPerSecond =
+        interval > 0 ? ( evaluations - exporter.last.counters[TELEMETRY_EVALUATIONS] ) / interval : 0.0;
+    const int length = snprintf(
+        line, sizeof( line ),
+        "seconds=%.1f evaluations=%" PRIu64 " evaluations_per_second=%.1f"
+        " prefilter_rejected=%.3f cache_hit_rate=%.3f edge_cache_hit_rate=%.3f"
+        " solutions_0=%" PRIu64
+        " solutions_1=%" PRIu64 " solutions_many=%" PRIu64 " solutions_unknown=%" PRIu64
+        " generations=%" PRIu64 " generation_ms_last=%.1f generation_ms_mean=%.1f best=%u\n",
+        seconds, evaluations, evaluationsPerSecond,
+        ratio( counters[TELEMETRY_PREFILTER_REJECTED], evaluations ),
+        ratio( counters[TELEMETRY_CACHE_HITS],
+               counters[TELEMETRY_CACHE_HITS] + counters[TELEMETRY_CACHE_MISSES] ),
+        ratio( counters[TELEMETRY_EDGE_CACHE_HITS],
+               counters[TELEMETRY_EDGE_CACHE_HITS] + counters[TELEMETRY_EDGE_CACHE_MISSES] ),
+        counters[TELEMETRY_SOLUTIONS_0], counters[TELEMETRY_SOLUTIONS_1],
+        counters[TELEMETRY_SOLUTIONS_MANY], counters[TELEMETRY_SOLUTIONS_UNKNOWN],
+        generations, now.lastGenerationNanoseconds / 1e6,
+        ratio( counters[TELEMETRY_GENERATION_NANOSECONDS], generations ) / 1e6,
+        now.bestScore );
+    telemetry_write( line, length );
+    exporter.last = now;
+    exporter.lastSeconds = seconds;
+}
+
+static void* telemetry_run( void* arg ) {
+    pthread_mutex_lock( &exporter.lock );
+    while ( !exporter.stop ) {
+        struct timespec wakeTime;
+        clock_gettime( CLOCK_REALTIME, &wakeTime );
+        wakeTime.tv_sec += exporter.intervalMilliseconds / 1000;
+        wakeTime.tv_nsec += ( exporter.intervalMilliseconds % 1000 ) * 1000000l;
+        if ( wakeTime.tv_nsec >= 1000000000l ) {
+            ++wakeTime.tv_sec;
+            wakeTime.tv_nsec -= 1000000000l;
+        }
+        while ( !exporter.stop &&
+                pthread_cond_timedwait( &exporter.wake, &exporter.lock, &wakeTime ) != ETIMEDOUT ) {
+        }
+        telemetry_export();
+    }
+    pthread_mutex_unlock( &exporter.lock );
+    return NULL;
+}
+
+void telemetry_start( const char* const destination, const uint intervalMilliseconds ) {
+    exporter = ( TelemetryExporter ) { .intervalMilliseconds = intervalMilliseconds,
+                                       .destination = destination,
+                                       .socket = -1 };
+    if ( strncmp( destination, TELEMETRY_SOCKET_PREFIX, strlen( TELEMETRY_SOCKET_PREFIX ) ) == 0 ) {
+        exporter.socket = telemetry_connect( destination + strlen( TELEMETRY_SOCKET_PREFIX ) );
+        if ( exporter.socket < 0 ) {
+            fprintf( stderr, "Could not connect to %s: %s\n", destination, strerror( errno ) );
+            exit( 1 );
+        }
+    } else {
+        exporter.file = fopen( destination, "a" );
+        if ( !exporter.file ) {
+            fprintf( stderr, "Could not open %s: %s\n", destination, strerror( errno ) );
+            exit( 1 );
+        }
+    }
+    clock_gettime( CLOCK_MONOTONIC, &exporter.startTime );
+    pthread_mutex_init( &exporter.lock, NULL );
+    pthread_cond_init( &exporter.wake, NULL );
+    atomic_store( &telemetryEnabled, true );
+    pthread_create( &exporter.thread, NULL, telemetry_run, NULL );
+}
+
+void telemetry_stop() {
+    pthread_mutex_lock( &exporter.lock );
+    exporter.stop = true;
+    pthread_cond_signal( &exporter.wake );
+    pthread_mutex_unlock( &exporter.lock );
+    pthread_join( exporter.thread, NULL );
+    if ( exporter.file ) {
+        fclose( exporter.file );
+    }
+    if ( exporter.socket >= 0 ) {
+        close( exporter.socket );
+    }
+    pthread_mutex_destroy( &exporter.lock );
+    pthread_cond_destroy( &exporter.wake );
+}
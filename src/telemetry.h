@@ -0,0 +1,92 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+ * Live counters for long searches
+ *
+ * Every thread counts into its own block, so counting is a plain add on a cache
+ * line no other thread writes. Blocks are only summed when a snapshot is taken.
+ * Until telemetry_start is called every count is a single relaxed load and a
+ * branch.
+*/
+typedef enum TelemetryCounter {
+    TELEMETRY_EVALUATIONS, //Puzzles scored
+    TELEMETRY_PREFILTER_REJECTED,
+    TELEMETRY_CACHE_HITS, //work reused instead of redone (EdgeSolutions, Puzzle views)
+    TELEMETRY_CACHE_MISSES,
+    TELEMETRY_EDGE_CACHE_HITS, //lookups in a shared EdgeRingCache, counted apart from the above
+    TELEMETRY_EDGE_CACHE_MISSES,
+    TELEMETRY_SOLUTIONS_0, //solves that ended on each number of other solutions
+    TELEMETRY_SOLUTIONS_1,
+    TELEMETRY_SOLUTIONS_MANY,
+    TELEMETRY_SOLUTIONS_UNKNOWN, //out of budget
+    TELEMETRY_GENERATIONS,
+    TELEMETRY_GENERATION_NANOSECONDS,
+    TELEMETRY_NUM_COUNTERS
+} TelemetryCounter;
+
+typedef struct TelemetryBlock {
+    _Alignas( 64 ) atomic_uint_fast64_t counters[TELEMETRY_NUM_COUNTERS];
+    struct TelemetryBlock* next;
+} TelemetryBlock;
+
+typedef struct TelemetrySnapshot {
+    uint64_t counters[TELEMETRY_NUM_COUNTERS];
+    uint64_t lastGenerationNanoseconds;
+    uint bestScore;
+} TelemetrySnapshot;
+
+extern atomic_bool telemetryEnabled;
+extern __thread TelemetryBlock* telemetryBlock;
+
+//give the calling thread its block
+TelemetryBlock* telemetry_register();
+
+static inline void telemetry_add( const TelemetryCounter counter, const uint64_t amount ) {
+    if ( !atomic_load_explicit( &telemetryEnabled, memory_order_relaxed ) ) {
+        return;
+    }
+    TelemetryBlock* const block = telemetryBlock ? telemetryBlock : telemetry_register();
+    //only this thread writes the block, so no read-modify-write is needed
+    atomic_store_explicit( &block->counters[counter],
+                           atomic_load_explicit( &block->counters[counter],
+                                                 memory_order_relaxed ) + amount,
+                           memory_order_relaxed );
+}
+
+//count a solve by how many other solutions it ended on
+static inline void telemetry_countSolve( const uint numOtherSolutions, const bool unknown ) {
+    telemetry_add( unknown ? TELEMETRY_SOLUTIONS_UNKNOWN :
+                   numOtherSolutions == 0 ? TELEMETRY_SOLUTIONS_0 :
+                   numOtherSolutions == 1 ? TELEMETRY_SOLUTIONS_1 : TELEMETRY_SOLUTIONS_MANY, 1 );
+}
+
+void telemetry_recordGeneration( const uint64_t nanoseconds );
+
+//raise the best score reported, if score beats it
+void telemetry_offerBest( const uint score );
+
+/*
+ * Sum every thread's block, safe to call while they count
+*/
+void telemetry_snapshot( TelemetrySnapshot* const snapshot );
+
+/*
+ * Start counting, and a thread that writes a line of key=value pairs every
+ * intervalMilliseconds to destination: a file (appended to) or unix:<path>, a
+ * Unix domain socket something is listening on. Exits if destination can't be
+ * opened.
+*/
+void telemetry_start( const char* const destination, const uint intervalMilliseconds );
+
+/*
+ * Write a last line, stop the thread and close destination. Counting stays on.
+*/
+void telemetry_stop();
+
+#endif
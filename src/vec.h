@@ -0,0 +1,90 @@
+#ifndef VEC_H
+#define VEC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "error.h"
+#include "memory.h"
+
+/*
+ * Type-specialized replacement for DynamicArray
+ *
+ * VEC_DEFINE( Name, Type, prefix ) generates a Name struct holding Type elements
+ * and a set of static inline functions named prefix_xxx. The element size is
+ * known at compile time, so adding and getting an element is a plain assignment
+ * instead of a size-generic memcpy.
+ *
+ * Generated functions:
+ *  - prefix_init( vec, startingSize ): allocate room for startingSize elements
+ *  - prefix_reserve( vec, size ): make sure there is room for size elements
+ *  - prefix_clear( vec ): drop all elements, keeping the allocation
+ *  - prefix_add( vec, element ): append a copy of element
+ *  - prefix_emplace( vec ): append an uninitialized element, return a pointer to it
+ *  - prefix_at( vec, index ): pointer to the element at index, NOT bounds checked
+ *  - prefix_free( vec ): free the contents, vec can be init'd again after
+ *
+ * Vecs live by value (on the stack, in a struct, or as a static), there is no
+ * create function that mallocs the Vec itself. Growth doubles the size, same as
+ * the DynamicArray defaults. Contents come from the thread's memory_use
+ * allocator, and running out of memory is an error_raise.
+*/
+#define VEC_DEFINE( Name, Type, prefix )                                               \
+typedef struct Name {                                                                  \
+    Type* contents;                                                                    \
+    size_t size;                                                                       \
+    size_t numElements;                                                                \
+} Name;                                                                                \
+                                                                                       \
+static inline void prefix##_reserve( Name* const vec, const size_t size ) {            \
+    if ( size <= vec->size ) {                                                         \
+        return;                                                                        \
+    }                                                                                  \
+    Type* contents = memory_reallocate( vec->contents, vec->size * sizeof( Type ),     \
+                                        size * sizeof( Type ) );                       \
+    if ( !contents ) {                                                                 \
+        error_raise( ERROR_OUT_OF_MEMORY, "Could not resize to %lu elements "          \
+                     "of size %lu", size, sizeof( Type ) );                            \
+    }                                                                                  \
+    vec->contents = contents;                                                          \
+    vec->size = size;                                                                  \
+}                                                                                      \
+                                                                                       \
+static inline void prefix##_init( Name* const vec, const size_t startingSize ) {       \
+    vec->contents = NULL;                                                              \
+    vec->size = 0;                                                                     \
+    vec->numElements = 0;                                                              \
+    prefix##_reserve( vec, startingSize ? startingSize : 1 );                          \
+}                                                                                      \
+                                                                                       \
+static inline void prefix##_clear( Name* const vec ) {                                 \
+    vec->numElements = 0;                                                              \
+}                                                                                      \
+                                                                                       \
+__attribute__(( noinline, cold, unused ))                                              \
+static void prefix##_grow( Name* const vec ) {                                         \
+    prefix##_reserve( vec, vec->size * 2 );                                            \
+}                                                                                      \
+                                                                                       \
+static inline Type* prefix##_emplace( Name* const vec ) {                              \
+    if ( __builtin_expect( vec->numElements == vec->size, 0 ) ) {                      \
+        prefix##_grow( vec );                                                          \
+    }                                                                                  \
+    return &vec->contents[vec->numElements++];                                         \
+}                                                                                      \
+                                                                                       \
+static inline void prefix##_add( Name* const vec, const Type element ) {               \
+    *prefix##_emplace( vec ) = element;                                                \
+}                                                                                      \
+                                                                                       \
+static inline Type* prefix##_at( const Name* const vec, const size_t index ) {         \
+    return &vec->contents[index];                                                      \
+}                                                                                      \
+                                                                                       \
+static inline void prefix##_free( Name* const vec ) {                                  \
+    memory_reallocate( vec->contents, vec->size * sizeof( Type ), 0 );                 \
+    vec->contents = NULL;                                                              \
+    vec->size = 0;                                                                     \
+    vec->numElements = 0;                                                              \
+}
+
+#endif